@@ -0,0 +1,145 @@
+/**
+ * @file obu.cpp
+ * @brief AV1 OBU header and RTP aggregation header.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "obu.h"
+#include <string.h>
+
+void av1_aggregation_header_set(av1_aggregation_header_t* h, uint8_t v)
+{
+	h->z = (v & 0x80) >> 7;
+	h->y = (v & 0x40) >> 6;
+	h->w = (v & 0x30) >> 4;
+	h->n = (v & 0x08) >> 3;
+}
+
+uint8_t av1_aggregation_header_get(const av1_aggregation_header_t* h)
+{
+	uint8_t v = 0;
+	v |= h->z << 7;
+	v |= h->y << 6;
+	v |= h->w << 4;
+	v |= h->n << 3;
+	return v;
+}
+
+int av1_leb128_read(const uint8_t* buf, int size, uint32_t* value)
+{
+	uint64_t v = 0;
+	for (int i = 0; i < size && i < 8; i++)
+	{
+		v |= (uint64_t)(buf[i] & 0x7f) << (i * 7);
+		if ((buf[i] & 0x80) == 0)
+		{
+			if (v > 0xffffffff)
+			{
+				return 0;
+			}
+			*value = (uint32_t)v;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+int av1_leb128_write(uint8_t* buf, uint32_t value)
+{
+	int i = 0;
+	do
+	{
+		uint8_t b = value & 0x7f;
+		value >>= 7;
+		if (value)
+		{
+			b |= 0x80;
+		}
+		buf[i++] = b;
+	} while (value);
+	return i;
+}
+
+int av1_leb128_size(uint32_t value)
+{
+	int i = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		i++;
+	}
+	return i;
+}
+
+int av1_obu_parse(av1_obu_t* obu, const uint8_t* buf, int size)
+{
+	memset(obu, 0, sizeof(av1_obu_t));
+	if (size < 1 || (buf[0] & 0x80))
+	{
+		return 0;
+	}
+
+	obu->type = (buf[0] & 0x78) >> 3;
+	obu->has_extension = (buf[0] & 0x04) >> 2;
+	obu->has_size = (buf[0] & 0x02) >> 1;
+	obu->header = buf;
+	obu->header_size = 1;
+
+	if (obu->has_extension)
+	{
+		if (size < 2)
+		{
+			return 0;
+		}
+		obu->tid = (buf[1] & 0xe0) >> 5;
+		obu->sid = (buf[1] & 0x18) >> 3;
+		obu->header_size = 2;
+	}
+
+	int pos = obu->header_size;
+	if (obu->has_size)
+	{
+		uint32_t obu_size = 0;
+		int n = av1_leb128_read(buf + pos, size - pos, &obu_size);
+		if (n == 0 || obu_size > (uint32_t)(size - pos - n))
+		{
+			return 0;
+		}
+		pos += n;
+		obu->payload = buf + pos;
+		obu->payload_size = (int)obu_size;
+	}
+	else
+	{
+		obu->payload = buf + pos;
+		obu->payload_size = size - pos;
+	}
+
+	return pos + obu->payload_size;
+}
+
+bool av1_sequence_header_reduced_still_picture(const uint8_t* payload, int size)
+{
+	// seq_profile(3) still_picture(1) reduced_still_picture_header(1)
+	return size > 0 && (payload[0] & 0x08) != 0;
+}
+
+bool av1_frame_header_is_keyframe(const uint8_t* payload, int size, bool reduced_still_picture_header)
+{
+	if (reduced_still_picture_header)
+	{
+		return true;
+	}
+	if (size < 1)
+	{
+		return false;
+	}
+
+	// show_existing_frame(1) frame_type(2), KEY_FRAME is 0.
+	if (payload[0] & 0x80)
+	{
+		return false;
+	}
+	return ((payload[0] >> 5) & 0x03) == 0;
+}
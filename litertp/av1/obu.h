@@ -0,0 +1,93 @@
+/**
+ * @file obu.h
+ * @brief AV1 OBU header and RTP aggregation header.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define AV1_OBU_SEQUENCE_HEADER 1
+#define AV1_OBU_TEMPORAL_DELIMITER 2
+#define AV1_OBU_FRAME_HEADER 3
+#define AV1_OBU_TILE_GROUP 4
+#define AV1_OBU_METADATA 5
+#define AV1_OBU_FRAME 6
+#define AV1_OBU_TILE_LIST 8
+#define AV1_OBU_PADDING 15
+
+/// <summary>
+/// 
+///  0 1 2 3 4 5 6 7
+/// +-+-+-+-+-+-+-+-+
+/// |Z|Y| W |N|-|-|-|
+/// +-+-+-+-+-+-+-+-+
+/// 
+/// Z: the first OBU element is the continuation of the previous packet.
+/// Y: the last OBU element will continue in the next packet.
+/// W: count of OBU elements, 0 means every element has a length field.
+/// N: first packet of a coded video sequence.
+/// </summary>
+typedef struct _av1_aggregation_header_t
+{
+	uint8_t z : 1;
+	uint8_t y : 1;
+	uint8_t w : 2;
+	uint8_t n : 1;
+}av1_aggregation_header_t;
+
+/// <summary>
+/// 
+///  0 1 2 3 4 5 6 7
+/// +-+-+-+-+-+-+-+-+
+/// |F| type  |X|S|-|
+/// +-+-+-+-+-+-+-+-+
+/// |  TID|SID|  -  |  (X=1)
+/// +-+-+-+-+-+-+-+-+
+/// </summary>
+typedef struct _av1_obu_t
+{
+	uint8_t type;
+	uint8_t has_extension;
+	uint8_t has_size;
+	uint8_t tid;
+	uint8_t sid;
+
+	const uint8_t* header;  //obu header (with extension)
+	int header_size;
+	const uint8_t* payload;  //obu payload without the size field
+	int payload_size;
+}av1_obu_t;
+
+
+void av1_aggregation_header_set(av1_aggregation_header_t* h, uint8_t v);
+
+uint8_t av1_aggregation_header_get(const av1_aggregation_header_t* h);
+
+//Returns bytes read, 0 if failed.
+int av1_leb128_read(const uint8_t* buf, int size, uint32_t* value);
+
+//Returns bytes written, buf needs 5 bytes at most.
+int av1_leb128_write(uint8_t* buf, uint32_t value);
+
+int av1_leb128_size(uint32_t value);
+
+/// <summary>
+/// Parse an OBU at buf, without size field the OBU is the rest of the buffer.
+/// Returns the total size of this OBU, 0 if failed.
+/// </summary>
+int av1_obu_parse(av1_obu_t* obu, const uint8_t* buf, int size);
+
+/// <summary>
+/// Whether a sequence header OBU payload sets reduced_still_picture_header, then every frame is a key frame.
+/// </summary>
+bool av1_sequence_header_reduced_still_picture(const uint8_t* payload, int size);
+
+/// <summary>
+/// Whether a frame or frame header OBU payload starts a KEY_FRAME, a shown existing frame is not.
+/// Only the first bits are read, so the first fragment of the OBU is enough.
+/// </summary>
+bool av1_frame_header_is_keyframe(const uint8_t* payload, int size, bool reduced_still_picture_header);
@@ -30,7 +30,7 @@ namespace litertp
 	bool cert::create_cert()
 	{
 #ifdef LITERTP_SSL
-		static const int num_bits = 1024;
+		static const int num_bits = 2048;
 		BIGNUM* bne = BN_new();
 		BN_set_word(bne, RSA_F4);
 		RSA* rsa_key = RSA_new();
@@ -69,6 +69,7 @@ namespace litertp
 		}
 
 		expire_at_ = time_util::cur_time()+ ONE_YEAR * 9;
+		fingerprint_ = make_fingerprint();
 		return true;
 #else
 		return false;
@@ -88,12 +89,18 @@ namespace litertp
 			EVP_PKEY_free(key_);
 			key_ = nullptr;
 		}
+		fingerprint_.clear();
 #else
 		expire_at_ = 0;
 #endif
 	}
 
 	std::string cert::fingerprint()const
+	{
+		return fingerprint_;
+	}
+
+	std::string cert::make_fingerprint()const
 	{
 #ifdef LITERTP_SSL
 		assert(cert_);
@@ -35,8 +35,11 @@ namespace litertp
 
 		bool export_cert(const std::string& file);
 		bool export_key(const std::string& file);
+	private:
+		std::string make_fingerprint()const;
 	private:
 		long expire_at_ = 0;
+		std::string fingerprint_;
 
 #ifdef LITERTP_SSL
 		X509* cert_ = nullptr;
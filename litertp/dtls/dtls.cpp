@@ -16,9 +16,9 @@
 
 namespace litertp
 {
-	dtls::dtls(cert_ptr cert)
+	dtls::dtls(dtls_context_ptr context)
 	{
-		cert_ = cert;
+		context_ = context;
 	}
 
 	dtls::~dtls()
@@ -26,49 +26,17 @@ namespace litertp
 		close();
 	}
 
-#ifdef LITERTP_SSL
-	static int dtls_verify_callback(int preverify_ok, X509_STORE_CTX* ctx) {
-		/* We just use the verify_callback to request a certificate from the client */
-		return 1;
-	}
-#endif
-
 	bool dtls::open()
 	{
 		std::unique_lock<std::recursive_mutex> lk(mutex_);
 
 #ifdef LITERTP_SSL
-		SSL_load_error_strings();
-		if(!SSL_library_init()){
-			close();
-			return false;
-		}
-
-		ctx_ = SSL_CTX_new(DTLS_method());
-		if(!ctx_) {
+		// The context is shared, only the session is made here.
+		ssl_ = SSL_new(context_->handle());
+		if (!ssl_) {
 			close();
 			return false;
 		}
-		SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, dtls_verify_callback);
-		SSL_CTX_set_tlsext_use_srtp(ctx_, "SRTP_AES128_CM_SHA1_32:SRTP_AES128_CM_SHA1_80");
-
-
-		SSL_CTX_use_certificate(ctx_, cert_->handle());
-		SSL_CTX_use_PrivateKey(ctx_, cert_->key());
-		if (!SSL_CTX_check_private_key(ctx_))
-		{
-			close();
-			return false;
-		}
-
-		SSL_CTX_set_read_ahead(ctx_, 1);
-		SSL_CTX_set_ecdh_auto(ctx_, true);
-
-
-		SSL_CTX_set_cipher_list(ctx_, "HIGH:!aNULL:!MD5:!RC4");
-		
-
-		ssl_ = SSL_new(ctx_);
 
 
 		//SSL_set_ex_data(ssl_, 0, dtls);
@@ -81,14 +49,6 @@ namespace litertp
 		BIO_set_mem_eof_return(wbio, -1);
 		SSL_set_bio(ssl_, rbio, wbio);
 
-
-		EC_KEY* ecdh = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
-		if (ecdh)
-		{
-			SSL_set_options(ssl_, SSL_OP_SINGLE_ECDH_USE);
-			SSL_set_tmp_ecdh(ssl_, ecdh);
-			EC_KEY_free(ecdh);
-		}
 		established_ = false;
 		return true;
 #else
@@ -106,11 +66,6 @@ namespace litertp
 			SSL_free(ssl_);
 			ssl_ = nullptr;
 		}
-
-		if (ctx_) {
-			SSL_CTX_free(ctx_);
-			ctx_ = nullptr;
-		}
 #endif
 		established_ = false;
 	}
@@ -233,11 +188,43 @@ namespace litertp
 #endif
 	}
 
+	int dtls::get_timeout()
+	{
+		std::unique_lock<std::recursive_mutex> lk(mutex_);
+#ifdef LITERTP_SSL
+		if (!ssl_ || SSL_is_init_finished(ssl_))
+		{
+			return -1;
+		}
+		timeval tv = { 0 };
+		if (!DTLSv1_get_timeout(ssl_, &tv))
+		{
+			return -1;
+		}
+		return (int)(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+#else
+		return -1;
+#endif
+	}
+
+	std::string dtls::handle_timeout()
+	{
+		std::unique_lock<std::recursive_mutex> lk(mutex_);
+#ifdef LITERTP_SSL
+		if (!ssl_ || DTLSv1_handle_timeout(ssl_) <= 0)
+		{
+			return "";
+		}
+		return flush();
+#else
+		return "";
+#endif
+	}
 
 	std::string dtls::fingerprint()
 	{
 		std::unique_lock<std::recursive_mutex> lk(mutex_);
-		return cert_->fingerprint();
+		return context_->get_cert()->fingerprint();
 	}
 
 	bool dtls::is_init_finished() {
@@ -262,38 +249,36 @@ namespace litertp
 		std::unique_lock<std::recursive_mutex> lk(mutex_);
 
 #ifdef LITERTP_SSL
-		const char* label = "EXTRACTOR-dtls_srtp";
-		unsigned char material[SRTP_MASTER_LENGTH *2] = { 0 };
-		if (!SSL_export_keying_material(ssl_, material, sizeof(material), label, strlen(label), NULL, 0, 0))
-		{
+		auto profile=SSL_get_selected_srtp_profile(ssl_);
+		if (!profile) {
 			return false;
 		}
 
-		info->key_length = SRTP_MASTER_LENGTH;
-		int offset = 0;
-		memcpy(info->client_key, material+ offset, SRTP_MASTER_KEY_LENGTH);
-		offset += SRTP_MASTER_KEY_LENGTH;
-		memcpy(info->server_key, material +offset, SRTP_MASTER_KEY_LENGTH);
-		offset += SRTP_MASTER_KEY_LENGTH;
-		memcpy(info->client_key+SRTP_MASTER_KEY_LENGTH, material +offset, SRTP_MASTER_SALT_LENGTH);
-		offset += SRTP_MASTER_SALT_LENGTH;
-		memcpy(info->server_key+SRTP_MASTER_KEY_LENGTH, material +offset, SRTP_MASTER_SALT_LENGTH);
-
-		auto profile=SSL_get_selected_srtp_profile(ssl_);
-		if (!profile) {
+		// Key and salt lengths depend on the profile, gcm uses a 12 bytes salt.
+		int key_length = (int)srtp_profile_get_master_key_length((srtp_profile_t)profile->id);
+		int salt_length = (int)srtp_profile_get_master_salt_length((srtp_profile_t)profile->id);
+		if (key_length <= 0 || key_length > SRTP_MAX_MASTER_KEY_LENGTH || salt_length <= 0 || salt_length > SRTP_MAX_MASTER_SALT_LENGTH)
+		{
 			return false;
 		}
 
-		/*
-		switch (profile->id) {
-		case SRTP_AES128_CM_SHA1_80:
-			memcpy(&info->profile, "SRTP_AES128_CM_SHA1_80", strlen("SRTP_AES128_CM_SHA1_80"));
-			break;
-		case SRTP_AES128_CM_SHA1_32:
-			memcpy(&info->profile, "SRTP_AES128_CM_SHA1_32", strlen("SRTP_AES128_CM_SHA1_32"));
-			break;
+		const char* label = "EXTRACTOR-dtls_srtp";
+		unsigned char material[SRTP_MAX_MASTER_LENGTH * 2] = { 0 };
+		if (!SSL_export_keying_material(ssl_, material, (key_length + salt_length) * 2, label, strlen(label), NULL, 0, 0))
+		{
+			return false;
 		}
-		*/
+
+		info->key_length = key_length + salt_length;
+		int offset = 0;
+		memcpy(info->client_key, material+ offset, key_length);
+		offset += key_length;
+		memcpy(info->server_key, material +offset, key_length);
+		offset += key_length;
+		memcpy(info->client_key+key_length, material +offset, salt_length);
+		offset += salt_length;
+		memcpy(info->server_key+key_length, material +offset, salt_length);
+
 		info->profile_id = profile->id;
 #else
 		return false;
@@ -8,7 +8,7 @@
 #pragma once
 
 
-#include "cert.h"
+#include "dtls_context.h"
 
 #include <string>
 #include <mutex>
@@ -22,14 +22,18 @@
 #define SRTP_MASTER_KEY_LENGTH 16
 #define SRTP_MASTER_SALT_LENGTH 14
 #define SRTP_MASTER_LENGTH (SRTP_MASTER_KEY_LENGTH + SRTP_MASTER_SALT_LENGTH)
+//aes 256 gcm has the longest key, aes cm the longest salt.
+#define SRTP_MAX_MASTER_KEY_LENGTH 32
+#define SRTP_MAX_MASTER_SALT_LENGTH 14
+#define SRTP_MAX_MASTER_LENGTH (SRTP_MAX_MASTER_KEY_LENGTH + SRTP_MAX_MASTER_SALT_LENGTH)
 
 namespace litertp
 {
 
 
 	typedef struct dtls_info_t {
-		unsigned char client_key[SRTP_MASTER_KEY_LENGTH + SRTP_MASTER_SALT_LENGTH];
-		unsigned char server_key[SRTP_MASTER_KEY_LENGTH + SRTP_MASTER_SALT_LENGTH];
+		unsigned char client_key[SRTP_MAX_MASTER_LENGTH];
+		unsigned char server_key[SRTP_MAX_MASTER_LENGTH];
 		//unsigned char profile[PROFILE_STRING_LENGTH];
 		unsigned long profile_id;
 		int key_length;
@@ -39,7 +43,7 @@ namespace litertp
 	class dtls
 	{
 	public:
-		dtls(cert_ptr cert);
+		dtls(dtls_context_ptr context);
 		~dtls();
 
 		bool open();
@@ -52,6 +56,11 @@ namespace litertp
 		std::string accept(const uint8_t* data,size_t size);
 		std::string connect();
 
+		//Milliseconds until a handshake message should be sent again, -1 if none is pending.
+		int get_timeout();
+		//Records sent again when the timer expired.
+		std::string handle_timeout();
+
 		std::string fingerprint();
 		bool export_key_material(dtls_info_t* info);
 		bool is_init_finished();
@@ -61,10 +70,9 @@ namespace litertp
 		std::recursive_mutex mutex_;
 
 #ifdef LITERTP_SSL
-		SSL_CTX* ctx_ = nullptr;
 		SSL* ssl_ = nullptr;
 #endif
-		cert_ptr cert_;
+		dtls_context_ptr context_;
 		bool established_ = false;
 	};
 
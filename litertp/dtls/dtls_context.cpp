@@ -0,0 +1,99 @@
+/**
+ * @file dtls_context.cpp
+ * @brief SSL_CTX shared by dtls sessions of the same certificate.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "dtls_context.h"
+
+namespace litertp
+{
+	dtls_context::dtls_context(cert_ptr cert)
+	{
+		cert_ = cert;
+	}
+
+	dtls_context::~dtls_context()
+	{
+		close();
+	}
+
+#ifdef LITERTP_SSL
+	static int dtls_verify_callback(int preverify_ok, X509_STORE_CTX* ctx) {
+		/* We just use the verify_callback to request a certificate from the client */
+		return 1;
+	}
+#endif
+
+	std::string dtls_context::srtp_profiles()
+	{
+		std::string profiles;
+#ifdef LITERTP_SSL
+		// Gcm first, encryption and authentication are one pass over the packet.
+		// libsrtp only supports gcm when it is built with openssl.
+		srtp_crypto_policy_t policy;
+		if (srtp_crypto_policy_set_from_profile_for_rtp(&policy, srtp_profile_aead_aes_128_gcm) == srtp_err_status_ok)
+		{
+			profiles += "SRTP_AEAD_AES_128_GCM:";
+		}
+		if (srtp_crypto_policy_set_from_profile_for_rtp(&policy, srtp_profile_aead_aes_256_gcm) == srtp_err_status_ok)
+		{
+			profiles += "SRTP_AEAD_AES_256_GCM:";
+		}
+		profiles += "SRTP_AES128_CM_SHA1_80:SRTP_AES128_CM_SHA1_32";
+#endif
+		return profiles;
+	}
+
+	bool dtls_context::open()
+	{
+#ifdef LITERTP_SSL
+		ctx_ = SSL_CTX_new(DTLS_method());
+		if (!ctx_) {
+			close();
+			return false;
+		}
+		SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, dtls_verify_callback);
+		SSL_CTX_set_tlsext_use_srtp(ctx_, srtp_profiles().c_str());
+
+
+		SSL_CTX_use_certificate(ctx_, cert_->handle());
+		SSL_CTX_use_PrivateKey(ctx_, cert_->key());
+		if (!SSL_CTX_check_private_key(ctx_))
+		{
+			close();
+			return false;
+		}
+
+		SSL_CTX_set_read_ahead(ctx_, 1);
+		SSL_CTX_set_ecdh_auto(ctx_, true);
+
+
+		SSL_CTX_set_cipher_list(ctx_, "HIGH:!aNULL:!MD5:!RC4");
+
+		// Inherited by each SSL made from this context.
+		EC_KEY* ecdh = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+		if (ecdh)
+		{
+			SSL_CTX_set_options(ctx_, SSL_OP_SINGLE_ECDH_USE);
+			SSL_CTX_set_tmp_ecdh(ctx_, ecdh);
+			EC_KEY_free(ecdh);
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void dtls_context::close()
+	{
+#ifdef LITERTP_SSL
+		if (ctx_) {
+			SSL_CTX_free(ctx_);
+			ctx_ = nullptr;
+		}
+#endif
+	}
+}
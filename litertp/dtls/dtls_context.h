@@ -0,0 +1,46 @@
+/**
+ * @file dtls_context.h
+ * @brief SSL_CTX shared by dtls sessions of the same certificate.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+
+#include "cert.h"
+
+#include <string>
+
+#ifdef LITERTP_SSL
+#include <openssl/ssl3.h>
+#include <srtp2/srtp.h>
+#endif
+
+namespace litertp
+{
+	class dtls_context
+	{
+	public:
+		dtls_context(cert_ptr cert);
+		~dtls_context();
+
+		bool open();
+		void close();
+
+		cert_ptr get_cert() const { return cert_; }
+		//Srtp profiles offered or accepted, in preference order.
+		static std::string srtp_profiles();
+#ifdef LITERTP_SSL
+		SSL_CTX* handle() { return ctx_; }
+#endif
+
+	private:
+#ifdef LITERTP_SSL
+		SSL_CTX* ctx_ = nullptr;
+#endif
+		cert_ptr cert_;
+	};
+
+	typedef std::shared_ptr<dtls_context> dtls_context_ptr;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file srtp_context.cpp
+ * @brief Srtp sessions of one direction, one per ssrc.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "srtp_context.h"
+
+#include <string.h>
+
+//Limit sessions kept, inbound ones are only kept once a packet is authenticated.
+#define SRTP_MAX_STREAMS 256
+
+namespace litertp
+{
+#ifdef LITERTP_SSL
+	srtp_context::stream::stream(uint32_t generation)
+		:generation_(generation)
+	{
+	}
+
+	srtp_context::stream::~stream()
+	{
+		if (srtp_)
+		{
+			srtp_dealloc(srtp_);
+			srtp_ = nullptr;
+		}
+	}
+
+	srtp_context::srtp_context(bool inbound)
+	{
+		inbound_ = inbound;
+	}
+
+	srtp_context::~srtp_context()
+	{
+		clear();
+	}
+
+	bool srtp_context::set_keys(srtp_profile_t profile, const unsigned char* key, int key_length)
+	{
+		if (key_length <= 0 || key_length > SRTP_MAX_MASTER_LENGTH)
+		{
+			return false;
+		}
+
+		auto keys = new srtp_keys_t();
+		memset(&keys->policy, 0, sizeof(keys->policy));
+		memset(keys->key, 0, sizeof(keys->key));
+		memcpy(keys->key, key, key_length);
+
+		if (srtp_crypto_policy_set_from_profile_for_rtp(&keys->policy.rtp, profile) != srtp_err_status_ok
+			|| srtp_crypto_policy_set_from_profile_for_rtcp(&keys->policy.rtcp, profile) != srtp_err_status_ok)
+		{
+			delete keys;
+			return false;
+		}
+		keys->policy.ssrc.type = inbound_ ? ssrc_any_inbound : ssrc_any_outbound;
+		keys->policy.key = keys->key;
+		if (!inbound_)
+		{
+			keys->policy.allow_repeat_tx = 1; // for retransmissions 
+		}
+		// No mki is used, the trailer is only the auth tag.
+		keys->trailer = keys->policy.rtp.auth_tag_len;
+
+		std::unique_lock<std::mutex> lk(streams_mutex_);
+		keys->generation = ++generation_;
+		keys_.store(keys);
+		stream_map_.clear();
+		streams_.clear();
+		return true;
+	}
+
+	void srtp_context::clear()
+	{
+		std::unique_lock<std::mutex> lk(streams_mutex_);
+		keys_.store(nullptr);
+		stream_map_.clear();
+		streams_.clear();
+	}
+
+	bool srtp_context::is_active() const
+	{
+		published<srtp_keys_t>::reader keys(keys_);
+		return keys.get() != nullptr;
+	}
+
+	int srtp_context::trailer_size() const
+	{
+		published<srtp_keys_t>::reader keys(keys_);
+		return keys ? keys->trailer : 0;
+	}
+
+	uint32_t srtp_context::generation() const
+	{
+		published<srtp_keys_t>::reader keys(keys_);
+		return keys ? keys->generation : 0;
+	}
+
+	bool srtp_context::current_keys(int* trailer, uint32_t* generation) const
+	{
+		published<srtp_keys_t>::reader keys(keys_);
+		if (!keys)
+		{
+			return false;
+		}
+		*trailer = keys->trailer;
+		*generation = keys->generation;
+		return true;
+	}
+
+	srtp_context::stream_ptr srtp_context::get_stream(uint32_t ssrc, bool* uncommitted)
+	{
+		*uncommitted = false;
+		stream_ptr s;
+		{
+			published<srtp_keys_t>::reader keys(keys_);
+			if (!keys)
+			{
+				return nullptr;
+			}
+			if (streams_.find(ssrc, s) && s->generation_ == keys->generation)
+			{
+				return s;
+			}
+		}
+
+		std::unique_lock<std::mutex> lk(streams_mutex_);
+		published<srtp_keys_t>::reader keys(keys_);
+		if (!keys)
+		{
+			return nullptr;
+		}
+		auto itr = stream_map_.find(ssrc);
+		if (itr != stream_map_.end() && itr->second->generation_ == keys->generation)
+		{
+			return itr->second;
+		}
+		if (stream_map_.size() >= SRTP_MAX_STREAMS)
+		{
+			return nullptr;
+		}
+
+		s = std::make_shared<stream>(keys->generation);
+		if (srtp_create(&s->srtp_, &keys->policy) != srtp_err_status_ok)
+		{
+			s->srtp_ = nullptr;
+			return nullptr;
+		}
+
+		// Any ssrc can be sprayed by a peer, the session is used once and kept if the packet is genuine.
+		if (inbound_)
+		{
+			*uncommitted = true;
+			return s;
+		}
+
+		stream_map_[ssrc] = s;
+		std::vector<std::pair<uint32_t, stream_ptr>> items(stream_map_.begin(), stream_map_.end());
+		streams_.assign(items);
+		return s;
+	}
+
+	void srtp_context::commit_stream(uint32_t ssrc, stream_ptr s)
+	{
+		std::unique_lock<std::mutex> lk(streams_mutex_);
+		published<srtp_keys_t>::reader keys(keys_);
+		if (!keys || s->generation_ != keys->generation || stream_map_.size() >= SRTP_MAX_STREAMS)
+		{
+			return;
+		}
+		// A racing packet of the same ssrc may have committed its own session first.
+		if (!stream_map_.insert(std::make_pair(ssrc, s)).second)
+		{
+			return;
+		}
+
+		std::vector<std::pair<uint32_t, stream_ptr>> items(stream_map_.begin(), stream_map_.end());
+		streams_.assign(items);
+	}
+
+	static bool read_ssrc(const void* data, int size, int offset, uint32_t& ssrc)
+	{
+		if (size < offset + 4)
+		{
+			return false;
+		}
+		const uint8_t* p = (const uint8_t*)data + offset;
+		ssrc = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+		return true;
+	}
+
+	srtp_err_status_t srtp_context::protect(void* rtp, int* size)
+	{
+		uint32_t generation = 0;
+		return protect(rtp, size, &generation);
+	}
+
+	srtp_err_status_t srtp_context::protect(void* rtp, int* size, uint32_t* generation)
+	{
+		uint32_t ssrc = 0;
+		if (!read_ssrc(rtp, *size, 8, ssrc))
+		{
+			return srtp_err_status_fail;
+		}
+		bool uncommitted = false;
+		auto s = get_stream(ssrc, &uncommitted);
+		if (!s)
+		{
+			return srtp_err_status_fail;
+		}
+		*generation = s->generation_;
+		std::unique_lock<std::mutex> lk(s->mutex_);
+		return srtp_protect(s->srtp_, rtp, size);
+	}
+
+	srtp_err_status_t srtp_context::unprotect(void* srtp, int* size)
+	{
+		uint32_t ssrc = 0;
+		if (!read_ssrc(srtp, *size, 8, ssrc))
+		{
+			return srtp_err_status_fail;
+		}
+		bool uncommitted = false;
+		auto s = get_stream(ssrc, &uncommitted);
+		if (!s)
+		{
+			return srtp_err_status_fail;
+		}
+		srtp_err_status_t ret;
+		{
+			std::unique_lock<std::mutex> lk(s->mutex_);
+			ret = srtp_unprotect(s->srtp_, srtp, size);
+		}
+		if (uncommitted && ret == srtp_err_status_ok)
+		{
+			commit_stream(ssrc, s);
+		}
+		return ret;
+	}
+
+	srtp_err_status_t srtp_context::protect_rtcp(void* rtcp, int* size)
+	{
+		uint32_t ssrc = 0;
+		if (!read_ssrc(rtcp, *size, 4, ssrc))
+		{
+			return srtp_err_status_fail;
+		}
+		bool uncommitted = false;
+		auto s = get_stream(ssrc, &uncommitted);
+		if (!s)
+		{
+			return srtp_err_status_fail;
+		}
+		std::unique_lock<std::mutex> lk(s->mutex_);
+		return srtp_protect_rtcp(s->srtp_, rtcp, size);
+	}
+
+	srtp_err_status_t srtp_context::unprotect_rtcp(void* srtcp, int* size)
+	{
+		uint32_t ssrc = 0;
+		if (!read_ssrc(srtcp, *size, 4, ssrc))
+		{
+			return srtp_err_status_fail;
+		}
+		bool uncommitted = false;
+		auto s = get_stream(ssrc, &uncommitted);
+		if (!s)
+		{
+			return srtp_err_status_fail;
+		}
+		srtp_err_status_t ret;
+		{
+			std::unique_lock<std::mutex> lk(s->mutex_);
+			ret = srtp_unprotect_rtcp(s->srtp_, srtcp, size);
+		}
+		if (uncommitted && ret == srtp_err_status_ok)
+		{
+			commit_stream(ssrc, s);
+		}
+		return ret;
+	}
+
+	int srtp_context::protect(void* const* rtps, int* sizes, int count, srtp_err_status_t* results, uint32_t* generations)
+	{
+		return run_batch(true, rtps, sizes, count, results, generations);
+	}
+
+	int srtp_context::unprotect(void* const* srtps, int* sizes, int count, srtp_err_status_t* results)
+	{
+		return run_batch(false, srtps, sizes, count, results, nullptr);
+	}
+
+	int srtp_context::run_batch(bool protect, void* const* packets, int* sizes, int count, srtp_err_status_t* results, uint32_t* generations)
+	{
+		int done = 0;
+		stream_ptr s;
+		bool uncommitted = false;
+		uint32_t locked_ssrc = 0;
+		std::unique_lock<std::mutex> lk;
+		for (int i = 0; i < count; i++)
+		{
+			uint32_t ssrc = 0;
+			if (!read_ssrc(packets[i], sizes[i], 8, ssrc))
+			{
+				results[i] = srtp_err_status_fail;
+				continue;
+			}
+
+			// Usually a batch is of one stream, it is looked up and locked once.
+			if (!s || ssrc != locked_ssrc)
+			{
+				if (lk.owns_lock())
+				{
+					lk.unlock();
+				}
+				s = get_stream(ssrc, &uncommitted);
+				if (!s)
+				{
+					results[i] = srtp_err_status_fail;
+					continue;
+				}
+				lk = std::unique_lock<std::mutex>(s->mutex_);
+				locked_ssrc = ssrc;
+			}
+
+			if (generations)
+			{
+				generations[i] = s->generation_;
+			}
+			results[i] = protect ? srtp_protect(s->srtp_, packets[i], &sizes[i]) : srtp_unprotect(s->srtp_, packets[i], &sizes[i]);
+			if (results[i] == srtp_err_status_ok)
+			{
+				done++;
+				if (uncommitted)
+				{
+					commit_stream(ssrc, s);
+					uncommitted = false;
+				}
+			}
+		}
+		return done;
+	}
+#endif
+}
@@ -0,0 +1,92 @@
+/**
+ * @file srtp_context.h
+ * @brief Srtp sessions of one direction, one per ssrc.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+#include "dtls.h"
+#include "../util/lookup_table.hpp"
+#include "../util/published.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace litertp
+{
+#ifdef LITERTP_SSL
+	class srtp_context
+	{
+		typedef struct _srtp_keys_t
+		{
+			srtp_policy_t policy;
+			unsigned char key[SRTP_MAX_MASTER_LENGTH];
+			uint32_t generation;
+			int trailer;
+		}srtp_keys_t;
+
+		//A libsrtp session is not thread safe, each ssrc has its own one and lock,
+		//so streams are protected in parallel.
+		class stream
+		{
+		public:
+			stream(uint32_t generation);
+			~stream();
+
+			std::mutex mutex_;
+			srtp_t srtp_ = nullptr;
+			//Generation of the keys the session is made with.
+			const uint32_t generation_;
+		};
+
+		typedef std::shared_ptr<stream> stream_ptr;
+
+	public:
+		srtp_context(bool inbound);
+		~srtp_context();
+
+		//Replace the keys, sessions made with old keys are dropped, packets in flight finish with them.
+		bool set_keys(srtp_profile_t profile, const unsigned char* key, int key_length);
+		void clear();
+		bool is_active() const;
+		//Bytes srtp appends to a rtp packet with the current keys.
+		int trailer_size() const;
+		//Generation of the current keys, 0 if none.
+		uint32_t generation() const;
+		//Both of the above from one read of the keys, for the packet path. Returns false if there is no keys.
+		bool current_keys(int* trailer, uint32_t* generation) const;
+
+		srtp_err_status_t protect(void* rtp, int* size);
+		//generation is set to the generation of keys used, it changes with each set_keys.
+		srtp_err_status_t protect(void* rtp, int* size, uint32_t* generation);
+		srtp_err_status_t unprotect(void* srtp, int* size);
+		srtp_err_status_t protect_rtcp(void* rtcp, int* size);
+		srtp_err_status_t unprotect_rtcp(void* srtcp, int* size);
+
+		//Protect rtp packets back to back, consecutive packets of one ssrc share the lookup and lock.
+		//results and generations are set for each packet, return the count of packets protected.
+		int protect(void* const* rtps, int* sizes, int count, srtp_err_status_t* results, uint32_t* generations = nullptr);
+		int unprotect(void* const* srtps, int* sizes, int count, srtp_err_status_t* results);
+
+	private:
+		//A new inbound session is not kept until a packet is authenticated with it, see commit_stream.
+		stream_ptr get_stream(uint32_t ssrc, bool* uncommitted);
+		void commit_stream(uint32_t ssrc, stream_ptr s);
+		int run_batch(bool protect, void* const* packets, int* sizes, int count, srtp_err_status_t* results, uint32_t* generations);
+
+	private:
+		bool inbound_;
+		published<srtp_keys_t> keys_;
+		uint32_t generation_ = 0;
+
+		lookup_table<stream_ptr> streams_;
+
+		//Only taken to make the session of a new ssrc.
+		std::mutex streams_mutex_;
+		std::map<uint32_t, stream_ptr> stream_map_;
+	};
+#endif
+}
@@ -0,0 +1,103 @@
+/**
+ * @file srtp_test.hpp
+ * @brief Throughput of srtp protect and unprotect for each profile.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "dtls.h"
+
+#ifdef LITERTP_SSL
+
+static void test_srtp_profile(srtp_profile_t profile, const char* name, int payload_size, int count)
+{
+	unsigned char key[SRTP_MAX_MASTER_LENGTH];
+	for (int i = 0; i < (int)sizeof(key); i++)
+	{
+		key[i] = (unsigned char)(i * 7 + 1);
+	}
+
+	srtp_policy_t policy_out;
+	memset(&policy_out, 0, sizeof(policy_out));
+	srtp_crypto_policy_set_from_profile_for_rtp(&policy_out.rtp, profile);
+	srtp_crypto_policy_set_from_profile_for_rtcp(&policy_out.rtcp, profile);
+	policy_out.ssrc.type = ssrc_any_outbound;
+	policy_out.key = key;
+	policy_out.allow_repeat_tx = 1;
+
+	srtp_policy_t policy_in = policy_out;
+	policy_in.ssrc.type = ssrc_any_inbound;
+
+	srtp_t out = nullptr;
+	srtp_t in = nullptr;
+	if (srtp_create(&out, &policy_out) != srtp_err_status_ok || srtp_create(&in, &policy_in) != srtp_err_status_ok)
+	{
+		printf("%-24s not supported\n", name);
+		if (out) srtp_dealloc(out);
+		if (in) srtp_dealloc(in);
+		return;
+	}
+
+	uint8_t packet[2048] = { 0 };
+	uint8_t buf[2048];
+	packet[0] = 0x80;
+	packet[1] = 96;
+	packet[8] = 0x12;
+	packet[9] = 0x34;
+
+	double protect_us = 0;
+	double unprotect_us = 0;
+	int failed = 0;
+	for (int i = 0; i < count; i++)
+	{
+		uint16_t seq = (uint16_t)i;
+		packet[2] = seq >> 8;
+		packet[3] = seq & 0xFF;
+		int size = 12 + payload_size;
+		memcpy(buf, packet, size);
+
+		auto t0 = std::chrono::steady_clock::now();
+		if (srtp_protect(out, buf, &size) != srtp_err_status_ok)
+		{
+			failed++;
+			continue;
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		if (srtp_unprotect(in, buf, &size) != srtp_err_status_ok)
+		{
+			failed++;
+		}
+		auto t2 = std::chrono::steady_clock::now();
+
+		protect_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+		unprotect_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+	}
+
+	double mb = (double)payload_size * count / (1024 * 1024);
+	printf("%-24s protect %8.1f MB/s  unprotect %8.1f MB/s  failed %d\n", name,
+		protect_us > 0 ? mb / (protect_us / 1000000) : 0,
+		unprotect_us > 0 ? mb / (unprotect_us / 1000000) : 0,
+		failed);
+
+	srtp_dealloc(out);
+	srtp_dealloc(in);
+}
+
+// srtp_init must be called before, litertp_global_init does.
+void test_srtp_profiles(int payload_size = 1200, int count = 100000)
+{
+	test_srtp_profile(srtp_profile_aead_aes_128_gcm, "SRTP_AEAD_AES_128_GCM", payload_size, count);
+	test_srtp_profile(srtp_profile_aead_aes_256_gcm, "SRTP_AEAD_AES_256_GCM", payload_size, count);
+	test_srtp_profile(srtp_profile_aes128_cm_sha1_80, "SRTP_AES128_CM_SHA1_80", payload_size, count);
+	test_srtp_profile(srtp_profile_aes128_cm_sha1_32, "SRTP_AES128_CM_SHA1_32", payload_size, count);
+}
+
+#endif
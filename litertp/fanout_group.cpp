@@ -0,0 +1,155 @@
+/**
+ * @file fanout_group.cpp
+ * @brief Send one encoded stream to many media streams.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "fanout_group.h"
+
+#include "receivers/receiver_video_h264.h"
+#include "receivers/receiver_video_h265.h"
+#include "receivers/receiver_video_vp8.h"
+#include "receivers/receiver_video_vp9.h"
+#include "receivers/receiver_video_av1.h"
+
+namespace litertp
+{
+	fanout_group::fanout_group(media_type_t mt, const sdp_format& fmt)
+	{
+		media_type_ = mt;
+		format_ = fmt;
+
+		// The packetizer never sends, its packets are the shared templates of all members.
+		packetizer_ = media_stream::make_sender(0, mt, fmt);
+		packetizer_->send_rtp_packets_event_.add(s_send_rtp_packets_event, this);
+	}
+
+	fanout_group::~fanout_group()
+	{
+		packetizer_->send_rtp_packets_event_.remove(s_send_rtp_packets_event, this);
+		clear_streams();
+	}
+
+	bool fanout_group::add_stream(media_stream_ptr stream)
+	{
+		if (!stream || stream->media_type() != media_type_)
+		{
+			return false;
+		}
+
+		{
+			std::unique_lock<std::shared_mutex>lk(streams_mutex_);
+			for (auto itr = streams_.begin(); itr != streams_.end();)
+			{
+				auto s = itr->lock();
+				if (s == stream)
+				{
+					return true;
+				}
+				if (!s)
+				{
+					itr = streams_.erase(itr);
+				}
+				else
+				{
+					itr++;
+				}
+			}
+			streams_.push_back(stream);
+		}
+
+		litertp_on_keyframe_required_.invoke(stream->get_local_ssrc(), 0);
+		return true;
+	}
+
+	bool fanout_group::remove_stream(media_stream_ptr stream)
+	{
+		bool found = false;
+		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
+		for (auto itr = streams_.begin(); itr != streams_.end();)
+		{
+			auto s = itr->lock();
+			if (!s || s == stream)
+			{
+				found = found || s == stream;
+				itr = streams_.erase(itr);
+			}
+			else
+			{
+				itr++;
+			}
+		}
+		return found;
+	}
+
+	void fanout_group::clear_streams()
+	{
+		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
+		streams_.clear();
+	}
+
+	size_t fanout_group::stream_count()
+	{
+		std::shared_lock<std::shared_mutex>lk(streams_mutex_);
+		return streams_.size();
+	}
+
+	bool fanout_group::send_frame(const uint8_t* frame, uint32_t size, uint32_t duration)
+	{
+		std::unique_lock<std::mutex>lk(packetizer_mutex_);
+		return packetizer_->send_frame(frame, size, duration);
+	}
+
+	bool fanout_group::send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+	{
+		std::unique_lock<std::mutex>lk(packetizer_mutex_);
+		return packetizer_->send_nals(nals, sizes, count, duration);
+	}
+
+	void fanout_group::s_send_rtp_packets_event(void* ctx, const std::vector<packet_ptr>& packets)
+	{
+		fanout_group* p = (fanout_group*)ctx;
+		for (auto& packet : packets)
+		{
+			p->on_send_rtp_packet(packet);
+		}
+	}
+
+	void fanout_group::on_send_rtp_packet(packet_ptr packet)
+	{
+		bool keyframe = is_keyframe(packet);
+
+		std::shared_lock<std::shared_mutex>lk(streams_mutex_);
+		for (auto& itr : streams_)
+		{
+			auto stream = itr.lock();
+			if (stream)
+			{
+				// Each member rewrites the header only, the payload is shared with the template packet.
+				stream->forward_rtp_packet(format_, packet, keyframe);
+			}
+		}
+	}
+
+	bool fanout_group::is_keyframe(packet_ptr packet)
+	{
+		const uint8_t* payload = packet->payload();
+		int payload_size = (int)packet->payload_size();
+		switch (format_.codec_)
+		{
+		case codec_type_h264:
+			return receiver_video_h264::is_keyframe(payload, payload_size);
+		case codec_type_h265:
+			return receiver_video_h265::is_keyframe(payload, payload_size);
+		case codec_type_vp8:
+			return receiver_video_vp8::is_keyframe(payload, payload_size);
+		case codec_type_vp9:
+			return receiver_video_vp9::is_keyframe(payload, payload_size);
+		case codec_type_av1:
+			return receiver_video_av1::is_keyframe(payload, payload_size);
+		default:
+			return media_type_ != media_type_video;
+		}
+	}
+}
@@ -0,0 +1,56 @@
+/**
+ * @file fanout_group.h
+ * @brief Send one encoded stream to many media streams.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+#include "media_stream.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace litertp
+{
+	//A frame is packetized once, then each member stream sends the same payloads
+	//with its own ssrc, seq and timestamp, only the header is built and srtp is done per stream.
+	class fanout_group
+	{
+	public:
+		fanout_group(media_type_t mt, const sdp_format& fmt);
+		~fanout_group();
+
+		//A new member starts at the next keyframe, litertp_on_keyframe_required_ is raised to ask for one.
+		bool add_stream(media_stream_ptr stream);
+		bool remove_stream(media_stream_ptr stream);
+		void clear_streams();
+		size_t stream_count();
+
+		bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration);
+		bool send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+
+		media_type_t media_type()const { return media_type_; }
+		const sdp_format& format()const { return format_; }
+	private:
+		static void s_send_rtp_packets_event(void* ctx, const std::vector<packet_ptr>& packets);
+		void on_send_rtp_packet(packet_ptr packet);
+		bool is_keyframe(packet_ptr packet);
+
+	public:
+		sys::callback<litertp_on_keyframe_required> litertp_on_keyframe_required_;
+	private:
+		media_type_t media_type_;
+		sdp_format format_;
+
+		std::mutex packetizer_mutex_;
+		sender_ptr packetizer_;
+
+		std::shared_mutex streams_mutex_;
+		std::vector<std::weak_ptr<media_stream>> streams_;
+	};
+
+	typedef std::shared_ptr<fanout_group> fanout_group_ptr;
+}
@@ -11,6 +11,8 @@
 
 #include <sys2/socket.h>
 
+#include <algorithm>
+
 namespace litertp
 {
 	global::global()
@@ -31,6 +33,13 @@ namespace litertp
 		}
 
 #ifdef LITERTP_SSL
+		SSL_load_error_strings();
+		if (!SSL_library_init())
+		{
+			cleanup();
+			return false;
+		}
+
 		srtp_err_status_t srtp = srtp_init();
 		if (srtp != srtp_err_status_ok)
 		{
@@ -45,6 +54,18 @@ namespace litertp
 			return false;
 		}
 
+		{
+			// A few workers are enough, each one runs a whole handshake step of a transport.
+			int threads = (int)std::thread::hardware_concurrency() / 2;
+			threads = std::max(1, std::min(threads, 4));
+			std::unique_lock<std::mutex> lk(crypto_pool_mutex_);
+			if (!crypto_pool_)
+			{
+				crypto_pool_ = new sys::thread_pool(threads);
+				crypto_pool_->init();
+			}
+		}
+
 		//cert_->export_cert("E:\\cacert.pem");
 		//cert_->export_key("E:\\privkey.pem");
 #endif
@@ -53,10 +74,28 @@ namespace litertp
 
 	void global::cleanup()
 	{
+		// Workers may still use sockets and srtp, they are stopped first.
+		// Shut down without crypto_pool_mutex_, a running task may post the next one inline.
+		sys::thread_pool* pool = nullptr;
+		{
+			std::unique_lock<std::mutex> lk(crypto_pool_mutex_);
+			pool = crypto_pool_;
+			crypto_pool_ = nullptr;
+		}
+		if (pool)
+		{
+			pool->shutdown();
+			delete pool;
+		}
+
 		sys::socket::global_cleanup();
 
 #ifdef LITERTP_SSL
 		srtp_shutdown();
+		if (dtls_context_)
+		{
+			dtls_context_.reset();
+		}
 		if (cert_)
 		{
 			cert_.reset();
@@ -83,15 +122,40 @@ namespace litertp
 #endif
 	}
 
-	dtls_ptr global::get_dtls()
+	dtls_context_ptr global::get_dtls_context()
 	{
 #ifdef LITERTP_SSL
+		std::unique_lock<std::recursive_mutex> lk(cert_mutex_);
 		cert_ptr cert = get_cert();
 		if (!cert)
 		{
 			return nullptr;
 		}
-		dtls_ptr dtls = std::make_shared<litertp::dtls>(cert);
+		if (!dtls_context_ || dtls_context_->get_cert() != cert)
+		{
+			// Sessions made before keep the old context until they are closed.
+			auto context = std::make_shared<dtls_context>(cert);
+			if (!context->open())
+			{
+				return nullptr;
+			}
+			dtls_context_ = context;
+		}
+		return dtls_context_;
+#else
+		return nullptr;
+#endif
+	}
+
+	dtls_ptr global::get_dtls()
+	{
+#ifdef LITERTP_SSL
+		dtls_context_ptr context = get_dtls_context();
+		if (!context)
+		{
+			return nullptr;
+		}
+		dtls_ptr dtls = std::make_shared<litertp::dtls>(context);
 		if (!dtls->open())
 		{
 			return nullptr;
@@ -103,5 +167,18 @@ namespace litertp
 #endif
 	}
 
+	void global::post_crypto_task(std::function<void()> task)
+	{
+		{
+			std::unique_lock<std::mutex> lk(crypto_pool_mutex_);
+			if (crypto_pool_)
+			{
+				crypto_pool_->submit(task);
+				return;
+			}
+		}
+		task();
+	}
+
 	global g_instance;
 }
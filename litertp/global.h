@@ -10,7 +10,10 @@
 
 #include "dtls/dtls.h"
 
+#include <sys2/thread_pool.hpp>
+
 #include <mutex>
+#include <functional>
 
 namespace litertp
 {
@@ -24,12 +27,21 @@ namespace litertp
 		void cleanup();
 
 		cert_ptr get_cert();
+		//Shared by all dtls sessions, made again when the certificate is renewed.
+		dtls_context_ptr get_dtls_context();
 		dtls_ptr get_dtls();
 
+		//Run the task on the crypto workers, dtls handshakes are kept off the receive threads.
+		//The task runs inline if the workers are not started.
+		void post_crypto_task(std::function<void()> task);
+
 	private:
+		std::mutex crypto_pool_mutex_;
+		sys::thread_pool* crypto_pool_ = nullptr;
 #ifdef LITERTP_SSL
 		std::recursive_mutex cert_mutex_;
 		cert_ptr cert_;
+		dtls_context_ptr dtls_context_;
 #endif
 	};
 
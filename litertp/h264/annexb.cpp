@@ -0,0 +1,242 @@
+/**
+ * @file annexb.cpp
+ * @brief Annex-B start code scanner.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "annexb.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ANNEXB_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(ANNEXB_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ANNEXB_TARGET(t) __attribute__((target(t)))
+#else
+#define ANNEXB_TARGET(t)
+#endif
+
+#ifdef ANNEXB_X86
+static inline int annexb_ctz(uint32_t v)
+{
+#ifdef _MSC_VER
+	unsigned long idx = 0;
+	_BitScanForward(&idx, v);
+	return (int)idx;
+#else
+	return __builtin_ctz(v);
+#endif
+}
+#endif
+
+const uint8_t* annexb_find_start_code_c(const uint8_t* begin, const uint8_t* end)
+{
+	const uint8_t* p = begin;
+	while (end - p >= 3)
+	{
+		// Test the third byte first, most bytes of a slice are greater than 1,
+		// so we can usually skip 3 bytes at once.
+		if (p[2] > 1)
+		{
+			p += 3;
+		}
+		else if (p[1] != 0)
+		{
+			p += 2;
+		}
+		else if (p[0] != 0 || p[2] != 1)
+		{
+			p++;
+		}
+		else
+		{
+			return p;
+		}
+	}
+	return end;
+}
+
+#ifdef ANNEXB_X86
+
+ANNEXB_TARGET("sse2")
+const uint8_t* annexb_find_start_code_sse2(const uint8_t* begin, const uint8_t* end)
+{
+	const uint8_t* p = begin;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+
+	// Each step compares 16 candidates, reading up to p+17.
+	while (end - p >= 18)
+	{
+		__m128i v0 = _mm_loadu_si128((const __m128i*)p);
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(p + 1));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(p + 2));
+
+		__m128i m = _mm_and_si128(_mm_cmpeq_epi8(v0, zero), _mm_cmpeq_epi8(v1, zero));
+		m = _mm_and_si128(m, _mm_cmpeq_epi8(v2, one));
+
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+		if (mask)
+		{
+			return p + annexb_ctz(mask);
+		}
+		p += 16;
+	}
+
+	return annexb_find_start_code_c(p, end);
+}
+
+ANNEXB_TARGET("avx2")
+const uint8_t* annexb_find_start_code_avx2(const uint8_t* begin, const uint8_t* end)
+{
+	const uint8_t* p = begin;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+
+	// Each step compares 32 candidates, reading up to p+33.
+	while (end - p >= 34)
+	{
+		__m256i v0 = _mm256_loadu_si256((const __m256i*)p);
+		__m256i v1 = _mm256_loadu_si256((const __m256i*)(p + 1));
+		__m256i v2 = _mm256_loadu_si256((const __m256i*)(p + 2));
+
+		__m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(v0, zero), _mm256_cmpeq_epi8(v1, zero));
+		m = _mm256_and_si256(m, _mm256_cmpeq_epi8(v2, one));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+		if (mask)
+		{
+			return p + annexb_ctz(mask);
+		}
+		p += 32;
+	}
+
+	return annexb_find_start_code_sse2(p, end);
+}
+
+static annexb_scanner_t annexb_detect_scanner()
+{
+#ifdef _MSC_VER
+	int info[4] = { 0 };
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x06) == 0x06)
+	{
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+		{
+			return annexb_scanner_avx2;
+		}
+	}
+	return sse2 ? annexb_scanner_sse2 : annexb_scanner_c;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return annexb_scanner_avx2;
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		return annexb_scanner_sse2;
+	}
+	return annexb_scanner_c;
+#endif
+}
+
+#else
+
+const uint8_t* annexb_find_start_code_sse2(const uint8_t* begin, const uint8_t* end)
+{
+	return annexb_find_start_code_c(begin, end);
+}
+
+const uint8_t* annexb_find_start_code_avx2(const uint8_t* begin, const uint8_t* end)
+{
+	return annexb_find_start_code_c(begin, end);
+}
+
+static annexb_scanner_t annexb_detect_scanner()
+{
+	return annexb_scanner_c;
+}
+
+#endif
+
+annexb_scanner_t annexb_get_scanner()
+{
+	static const annexb_scanner_t scanner = annexb_detect_scanner();
+	return scanner;
+}
+
+annexb_find_start_code_fn annexb_get_scanner_fn(annexb_scanner_t scanner)
+{
+	switch (scanner)
+	{
+	case annexb_scanner_avx2:
+		return annexb_find_start_code_avx2;
+	case annexb_scanner_sse2:
+		return annexb_find_start_code_sse2;
+	default:
+		return annexb_find_start_code_c;
+	}
+}
+
+const uint8_t* annexb_find_start_code(const uint8_t* begin, const uint8_t* end)
+{
+	static const annexb_find_start_code_fn fn = annexb_get_scanner_fn(annexb_get_scanner());
+	return fn(begin, end);
+}
+
+bool annexb_find_next_nal(const uint8_t* buffer, int size, int& offset, int& nal_start, int& nal_size, bool& islast)
+{
+	const uint8_t* end = buffer + size;
+
+	nal_start = 0;
+	nal_size = 0;
+	islast = false;
+
+	while (offset < size)
+	{
+		// A buffer without start code is treated as a single nal.
+		const uint8_t* sc = annexb_find_start_code(buffer + offset, end);
+		int start = (sc == end) ? offset : (int)(sc - buffer) + 3;
+		if (start >= size)
+		{
+			offset = size;
+			return false;
+		}
+
+		const uint8_t* next = annexb_find_start_code(buffer + start, end);
+		int stop = (int)(next - buffer);
+		if (next != end)
+		{
+			// Strip the leading zero of a 4 bytes start code and trailing_zero_8bits.
+			while (stop > start && buffer[stop - 1] == 0)
+			{
+				stop--;
+			}
+		}
+
+		offset = (int)(next - buffer);
+		if (stop > start)
+		{
+			nal_start = start;
+			nal_size = stop - start;
+			islast = (next == end);
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file annexb.h
+ * @brief Annex-B start code scanner.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum annexb_scanner_t
+{
+	annexb_scanner_c = 0,
+	annexb_scanner_sse2 = 1,
+	annexb_scanner_avx2 = 2,
+}annexb_scanner_t;
+
+typedef const uint8_t* (*annexb_find_start_code_fn)(const uint8_t* begin, const uint8_t* end);
+
+/// <summary>
+/// Find the first 00 00 01 sequence in [begin,end).
+/// Returns the address of the first 00 byte, or end if not found.
+/// The best implementation for current cpu is selected at first call.
+/// </summary>
+const uint8_t* annexb_find_start_code(const uint8_t* begin, const uint8_t* end);
+
+const uint8_t* annexb_find_start_code_c(const uint8_t* begin, const uint8_t* end);
+const uint8_t* annexb_find_start_code_sse2(const uint8_t* begin, const uint8_t* end);
+const uint8_t* annexb_find_start_code_avx2(const uint8_t* begin, const uint8_t* end);
+
+annexb_scanner_t annexb_get_scanner();
+annexb_find_start_code_fn annexb_get_scanner_fn(annexb_scanner_t scanner);
+
+/// <summary>
+/// Parse next nal from an Annex-B access unit.
+/// On return nal_start/nal_size is the nal without start code, offset is moved to the next start code.
+/// </summary>
+bool annexb_find_next_nal(const uint8_t* buffer, int size, int& offset, int& nal_start, int& nal_size, bool& islast);
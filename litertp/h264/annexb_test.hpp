@@ -0,0 +1,197 @@
+/**
+ * @file annexb_test.hpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "annexb.h"
+#include "../senders/sender_video_h264.h"
+
+
+// The byte by byte scanner used by sender_video_h264 before.
+static bool test_annexb_legacy_find_next_nal(const uint8_t* buffer, int size, int& offset, int& nal_start, int& nal_size, bool& islast)
+{
+	int zeroes = 0;
+	int cur_pos = offset;
+	nal_start = 0;
+	nal_size = 0;
+	islast = false;
+	for (int i = offset; i < size; i++)
+	{
+		if (buffer[i] == 0x00)
+		{
+			zeroes++;
+		}
+		else if (buffer[i] == 0x01 && zeroes >= 2)
+		{
+			int nal_start2 = i + 1;
+			if (nal_start > 0)
+			{
+				int end_pos = nal_start2 - (zeroes == 2 ? 3 : 4);
+				nal_size = end_pos - cur_pos;
+				islast = cur_pos + nal_size == size;
+				offset = end_pos;
+				return true;
+			}
+			else
+			{
+				nal_start = nal_start2;
+			}
+			cur_pos = nal_start;
+		}
+		else
+		{
+			zeroes = 0;
+		}
+	}
+
+	if (cur_pos < size)
+	{
+		nal_start = cur_pos;
+		nal_size = size - nal_start;
+		offset = size;
+		islast = true;
+		return true;
+	}
+	return false;
+}
+
+// Build an access unit like a 4K IDR: sps,pps,sei and a few large slices with random payload.
+static std::vector<uint8_t> test_annexb_make_frame(size_t slice_size, int slices)
+{
+	std::vector<uint8_t> frame;
+	const uint8_t sps[] = { 0,0,0,1,0x67,0x64,0x00,0x33,0xac };
+	const uint8_t pps[] = { 0,0,0,1,0x68,0xee,0x3c,0xb0 };
+	const uint8_t sei[] = { 0,0,1,0x06,0x05,0x10,0xb4 };
+	frame.insert(frame.end(), sps, sps + sizeof(sps));
+	frame.insert(frame.end(), pps, pps + sizeof(pps));
+	frame.insert(frame.end(), sei, sei + sizeof(sei));
+
+	srand(1);
+	for (int s = 0; s < slices; s++)
+	{
+		const uint8_t sc[] = { 0,0,0,1,0x65 };
+		frame.insert(frame.end(), sc, sc + sizeof(sc));
+		for (size_t i = 0; i < slice_size; i++)
+		{
+			uint8_t b = (uint8_t)rand();
+			// keep the emulation prevention rule, no 00 00 0x in payload.
+			size_t n = frame.size();
+			if (b <= 3 && frame[n - 1] == 0 && frame[n - 2] == 0)
+			{
+				frame.push_back(3);
+			}
+			frame.push_back(b);
+		}
+		if (frame.back() == 0)
+		{
+			frame.back() = 0x80;
+		}
+	}
+	return frame;
+}
+
+template<class Fn>
+static double test_annexb_bench(const std::vector<uint8_t>& frame, int loops, int& nals, Fn fn)
+{
+	auto begin = std::chrono::steady_clock::now();
+	nals = 0;
+	for (int l = 0; l < loops; l++)
+	{
+		int offset = 0, nal_start = 0, nal_size = 0;
+		bool islast = false;
+		while (fn(frame.data(), (int)frame.size(), offset, nal_start, nal_size, islast))
+		{
+			nals++;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	double sec = std::chrono::duration<double>(end - begin).count();
+	return (double)frame.size() * loops / sec / (1024 * 1024);
+}
+
+void test_annexb_scan()
+{
+	auto frame = test_annexb_make_frame(256 * 1024, 8);
+	const int loops = 200;
+
+	// every scanner must find the same start codes.
+	const annexb_scanner_t scanners[] = { annexb_scanner_c,annexb_scanner_sse2,annexb_scanner_avx2 };
+	const char* names[] = { "c","sse2","avx2" };
+	for (auto scanner : scanners)
+	{
+		if (scanner > annexb_get_scanner())
+		{
+			break;
+		}
+		auto fn = annexb_get_scanner_fn(scanner);
+		const uint8_t* p = frame.data();
+		const uint8_t* end = p + frame.size();
+		const uint8_t* ref = annexb_find_start_code_c(p, end);
+		while (p < end)
+		{
+			const uint8_t* q = fn(p, end);
+			if (q != ref)
+			{
+				printf("annexb %s mismatch at %d\n", names[scanner], (int)(q - frame.data()));
+				break;
+			}
+			if (q == end)
+			{
+				break;
+			}
+			p = q + 3;
+			ref = annexb_find_start_code_c(p, end);
+		}
+	}
+
+	int nals = 0;
+	double mbps = test_annexb_bench(frame, loops, nals, test_annexb_legacy_find_next_nal);
+	printf("annexb legacy: %.1f MB/s nals=%d\n", mbps, nals / loops);
+
+	mbps = test_annexb_bench(frame, loops, nals, annexb_find_next_nal);
+	printf("annexb %s: %.1f MB/s nals=%d\n", names[annexb_get_scanner()], mbps, nals / loops);
+}
+
+static void test_h264_collect_packets(void* ctx, const std::vector<litertp::packet_ptr>& packets)
+{
+	auto collected = (std::vector<litertp::packet_ptr>*)ctx;
+	collected->insert(collected->end(), packets.begin(), packets.end());
+}
+
+// An access unit ending with a start code still ends with the marker bit, and the STAP-A
+// made of its small nals is sent before send_frame returns.
+static bool test_h264_trailing_start_code()
+{
+	litertp::sdp_format fmt(96, codec_type_h264, 90000);
+	fmt.fmtp_.insert("packetization-mode=1");
+	litertp::sender_video_h264 sender(1234, media_type_video, fmt);
+	std::vector<litertp::packet_ptr> packets;
+	sender.send_rtp_packets_event_.add(test_h264_collect_packets, &packets);
+
+	std::vector<uint8_t> frame = { 0,0,0,1,0x67,0x64,0x00,0x33, 0,0,0,1,0x68,0xee,0x3c,0xb0, 0,0,0,1,0x65,0x88,0x84,0x21, 0,0,0,1 };
+	sender.send_frame(frame.data(), (uint32_t)frame.size(), 3000);
+	// The buffer is reused, nothing of the first frame may be read after this.
+	memset(frame.data(), 0xff, frame.size());
+	bool first = packets.size() == 1 && packets[0]->handle_->header->m == 1 && packets[0]->payload_size() == 1 + 3 * 6;
+	uint32_t ts = packets.empty() ? 0 : packets[0]->handle_->header->ts;
+
+	std::vector<uint8_t> frame2 = { 0,0,0,1,0x41,0x9a,0x02,0x03 };
+	sender.send_frame(frame2.data(), (uint32_t)frame2.size(), 3000);
+	bool second = packets.size() == 2 && packets[1]->handle_->header->m == 1 && packets[1]->payload_size() == 4
+		&& packets[1]->handle_->header->ts == ts + 3000;
+
+	printf("h264 trailing start code: first %d, second %d\n", first, second);
+	return first && second;
+}
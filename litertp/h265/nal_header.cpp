@@ -0,0 +1,51 @@
+/**
+ * @file nal_header.cpp
+ * @brief H.265 nal unit header and RTP payload header (RFC 7798).
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "nal_header.h"
+
+void h265_nal_header_set(h265_nal_header_t* nal, const uint8_t* v)
+{
+	nal->f = (v[0] & 0x80) >> 7;
+	nal->t = (v[0] & 0x7e) >> 1;
+	nal->layer_id = ((v[0] & 0x01) << 5) | ((v[1] & 0xf8) >> 3);
+	nal->tid = v[1] & 0x07;
+}
+
+void h265_nal_header_get(const h265_nal_header_t* nal, uint8_t* v)
+{
+	v[0] = (nal->f << 7) | (nal->t << 1) | (nal->layer_id >> 5);
+	v[1] = ((nal->layer_id & 0x1f) << 3) | nal->tid;
+}
+
+void h265_fu_header_set(h265_fu_header_t* fu, uint8_t v)
+{
+	fu->s = (v & 0x80) >> 7;
+	fu->e = (v & 0x40) >> 6;
+	fu->t = v & 0x3f;
+}
+
+uint8_t h265_fu_header_get(const h265_fu_header_t* fu)
+{
+	uint8_t v = 0;
+	v |= fu->s << 7;
+	v |= fu->e << 6;
+	v |= fu->t;
+	return v;
+}
+
+bool h265_nal_is_keyframe(uint8_t t)
+{
+	// IRAP pictures are 16..23 (22,23 reserved).
+	return (t >= 16 && t <= 21) || t == H265_NAL_VPS || t == H265_NAL_SPS || t == H265_NAL_PPS;
+}
+
+bool h265_nal_is_non_reference(uint8_t t)
+{
+	// TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N and reserved RSV_VCL_N10/12/14.
+	return t <= 14 && (t % 2) == 0;
+}
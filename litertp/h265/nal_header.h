@@ -0,0 +1,47 @@
+/**
+ * @file nal_header.h
+ * @brief H.265 nal unit header and RTP payload header (RFC 7798).
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+#include <stdint.h>
+
+#define H265_NAL_AP 48   //Aggregation Packet
+#define H265_NAL_FU 49   //Fragmentation Unit
+#define H265_NAL_PACI 50
+
+#define H265_NAL_VPS 32
+#define H265_NAL_SPS 33
+#define H265_NAL_PPS 34
+
+typedef struct _h265_nal_header_t
+{
+	uint8_t f : 1;
+	uint8_t t : 6;
+	uint8_t layer_id : 6;
+	uint8_t tid : 3;
+}h265_nal_header_t;
+
+typedef struct _h265_fu_header_t
+{
+	uint8_t s : 1;
+	uint8_t e : 1;
+	uint8_t t : 6;
+}h265_fu_header_t;
+
+
+void h265_nal_header_set(h265_nal_header_t* nal, const uint8_t* v);
+
+void h265_nal_header_get(const h265_nal_header_t* nal, uint8_t* v);
+
+void h265_fu_header_set(h265_fu_header_t* fu, uint8_t v);
+
+uint8_t h265_fu_header_get(const h265_fu_header_t* fu);
+
+//BLA, IDR, CRA and the parameter sets, a decoder can start from here.
+bool h265_nal_is_keyframe(uint8_t t);
+
+//Sub-layer non-reference pictures, can be dropped without breaking the stream.
+bool h265_nal_is_non_reference(uint8_t t);
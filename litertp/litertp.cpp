@@ -7,8 +7,10 @@
 
 #include "litertp.h"
 #include "rtp_session.h"
+#include "fanout_group.h"
 #include "global.h"
 #include <sys2/string_util.h>
+#include <string.h>
 #include "proto/rtcp_util.h"
 
 
@@ -109,6 +111,27 @@ LITERTP_API int LITERTP_CALL litertp_set_on_rtcp_report(litertp_session_t* sessi
 	return 0;
 }
 
+LITERTP_API int LITERTP_CALL litertp_set_on_consent_expired(litertp_session_t* session, litertp_on_consent_expired on_consent_expired, void* ctx)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess)
+		return -1;
+
+	sess->litertp_on_consent_expired_.clear();
+	sess->litertp_on_consent_expired_.add(on_consent_expired, ctx);
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_set_ice_lite(litertp_session_t* session, bool enabled)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess)
+		return -1;
+
+	sess->set_ice_lite(enabled);
+	return 0;
+}
+
 
 LITERTP_API int LITERTP_CALL litertp_create_media_stream(litertp_session_t* session, media_type_t mt, uint32_t ssrc, rtp_trans_mode_t trans_mode, bool security,
 	const char* local_address, int local_rtp_port, int local_rtcp_port)
@@ -160,6 +183,126 @@ LITERTP_API int LITERTP_CALL litertp_create_media_stream_custom_transport(litert
 
 
 
+LITERTP_API int LITERTP_CALL litertp_create_media_stream_mid(litertp_session_t* session, media_type_t mt, const char* mid, uint32_t ssrc, rtp_trans_mode_t trans_mode, bool security,
+	const char* local_address, int local_rtp_port, int local_rtcp_port)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !mid || !mid[0])
+	{
+		return -1;
+	}
+
+	auto m = sess->create_media_stream(mt, ssrc, local_address, local_rtp_port, local_rtcp_port, mid);
+	if (!m)
+	{
+		return -1;
+	}
+
+	m->set_local_trans_mode(trans_mode);
+	if (security)
+	{
+		m->enable_dtls();
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_create_bundled_media_stream(litertp_session_t* session, media_type_t mt, const char* mid, uint32_t ssrc, rtp_trans_mode_t trans_mode)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !mid || !mid[0])
+	{
+		return -1;
+	}
+
+	auto m = sess->create_bundled_media_stream(mt, ssrc, mid);
+	if (!m)
+	{
+		return -1;
+	}
+
+	m->set_local_trans_mode(trans_mode);
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_remove_media_stream_mid(litertp_session_t* session, const char* mid)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !mid)
+	{
+		return -1;
+	}
+
+	sess->remove_media_stream(std::string(mid));
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_get_mid_by_ssrc(litertp_session_t* session, uint32_t ssrc, char* mid, int size)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !mid || size <= 0)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream_by_ssrc(ssrc);
+	if (!m || (int)m->mid().size() >= size)
+	{
+		return -1;
+	}
+
+	memcpy(mid, m->mid().c_str(), m->mid().size() + 1);
+	return (int)m->mid().size();
+}
+
+LITERTP_API int LITERTP_CALL litertp_add_local_track_mid(litertp_session_t* session, const char* mid, codec_type_t codec, uint16_t pt, int frequency, int channels)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !mid)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(std::string(mid));
+	if (!m)
+	{
+		return -1;
+	}
+
+	bool ret = m->media_type() == media_type_video ? m->add_local_video_track(codec, pt, frequency)
+		: m->add_local_audio_track(codec, pt, frequency, channels);
+	if (!ret)
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_send_frame_mid(litertp_session_t* session, const char* mid, const uint8_t* frame, uint32_t size, uint32_t duration)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !mid)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(std::string(mid));
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!m->send_frame(frame, size, duration))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
 LITERTP_API int LITERTP_CALL litertp_remove_media_stream(litertp_session_t* session, media_type_t mt)
 {
 	litertp::rtp_session* sess = (litertp::rtp_session*)session;
@@ -669,6 +812,314 @@ LITERTP_API int LITERTP_CALL litertp_send_frame(litertp_session_t* session, medi
 	return 0;
 }
 
+LITERTP_API int LITERTP_CALL litertp_send_nals(litertp_session_t* session, media_type_t mt, const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!m->send_nals(nals, sizes, count, duration))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_add_local_simulcast_layer(litertp_session_t* session, media_type_t mt, const char* rid, uint32_t ssrc)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !rid)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!m->add_local_simulcast_layer(rid, ssrc))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_send_simulcast_frame(litertp_session_t* session, media_type_t mt, const char* rid, const uint8_t* frame, uint32_t size, uint32_t duration)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !rid)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!m->send_simulcast_frame(rid, frame, size, duration))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_get_remote_rid(litertp_session_t* session, media_type_t mt, uint32_t ssrc, char* rid, int size)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !rid || size <= 0)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	std::string r = m->get_remote_rid(ssrc);
+	if (r.empty() || (int)r.size() >= size)
+	{
+		return -1;
+	}
+
+	memcpy(rid, r.data(), r.size());
+	rid[r.size()] = 0;
+	return (int)r.size();
+}
+
+LITERTP_API int LITERTP_CALL litertp_add_forward_layer(litertp_session_t* session, media_type_t mt, const char* rid, litertp_session_t* target, media_type_t target_mt)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	litertp::rtp_session* sess_target = (litertp::rtp_session*)target;
+	if (!sess || !sess_target || !rid)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	auto m_target = sess_target->get_media_stream(target_mt);
+	if (!m || !m_target)
+	{
+		return -1;
+	}
+
+	if (!m->add_forward(m_target, rid))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_send_layer_frame(litertp_session_t* session, media_type_t mt, const uint8_t* frame, uint32_t size, uint32_t duration, const temporal_layer_t* layer)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess || !layer)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!m->send_layer_frame(frame, size, duration, *layer))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_set_max_temporal_layer(litertp_session_t* session, media_type_t mt, int tid)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!sess)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	m->set_max_temporal_layer(tid);
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_add_forward(litertp_session_t* session, media_type_t mt, litertp_session_t* target, media_type_t target_mt)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	litertp::rtp_session* sess_target = (litertp::rtp_session*)target;
+	if (!sess || !sess_target)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	auto m_target = sess_target->get_media_stream(target_mt);
+	if (!m || !m_target)
+	{
+		return -1;
+	}
+
+	if (!m->add_forward(m_target))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_remove_forward(litertp_session_t* session, media_type_t mt, litertp_session_t* target, media_type_t target_mt)
+{
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	litertp::rtp_session* sess_target = (litertp::rtp_session*)target;
+	if (!sess || !sess_target)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	auto m_target = sess_target->get_media_stream(target_mt);
+	if (!m || !m_target)
+	{
+		return -1;
+	}
+
+	if (!m->remove_forward(m_target))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API litertp_fanout_group_t* LITERTP_CALL litertp_create_fanout_group(media_type_t mt, codec_type_t codec, uint16_t pt, int frequency, int channels)
+{
+	litertp::sdp_format fmt(pt, codec, frequency, channels);
+	litertp::fanout_group* group = new litertp::fanout_group(mt, fmt);
+	return (litertp_fanout_group_t*)group;
+}
+
+LITERTP_API void LITERTP_CALL litertp_destroy_fanout_group(litertp_fanout_group_t** group)
+{
+	litertp::fanout_group* g = (litertp::fanout_group*)(*group);
+	if (g)
+	{
+		delete g;
+	}
+	*group = nullptr;
+}
+
+LITERTP_API int LITERTP_CALL litertp_set_fanout_on_keyframe_required_eventhandler(litertp_fanout_group_t* group, litertp_on_keyframe_required on_keyframe_required, void* ctx)
+{
+	litertp::fanout_group* g = (litertp::fanout_group*)group;
+	if (!g)
+		return -1;
+
+	g->litertp_on_keyframe_required_.add(on_keyframe_required, ctx);
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_fanout_group_add(litertp_fanout_group_t* group, litertp_session_t* session, media_type_t mt)
+{
+	litertp::fanout_group* g = (litertp::fanout_group*)group;
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!g || !sess)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!g->add_stream(m))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_fanout_group_remove(litertp_fanout_group_t* group, litertp_session_t* session, media_type_t mt)
+{
+	litertp::fanout_group* g = (litertp::fanout_group*)group;
+	litertp::rtp_session* sess = (litertp::rtp_session*)session;
+	if (!g || !sess)
+	{
+		return -1;
+	}
+
+	auto m = sess->get_media_stream(mt);
+	if (!m)
+	{
+		return -1;
+	}
+
+	if (!g->remove_stream(m))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_fanout_group_send_frame(litertp_fanout_group_t* group, const uint8_t* frame, uint32_t size, uint32_t duration)
+{
+	litertp::fanout_group* g = (litertp::fanout_group*)group;
+	if (!g)
+	{
+		return -1;
+	}
+
+	if (!g->send_frame(frame, size, duration))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+LITERTP_API int LITERTP_CALL litertp_fanout_group_send_nals(litertp_fanout_group_t* group, const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+{
+	litertp::fanout_group* g = (litertp::fanout_group*)group;
+	if (!g)
+	{
+		return -1;
+	}
+
+	if (!g->send_nals(nals, sizes, count, duration))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
 LITERTP_API int LITERTP_CALL litertp_get_stats(litertp_session_t* session, media_type_t mt, rtp_stats_t* stats)
 {
 	litertp::rtp_session* sess = (litertp::rtp_session*)session;
@@ -18,6 +18,7 @@ extern "C" {
 
 
 typedef void litertp_session_t;
+typedef void litertp_fanout_group_t;
 
 /**
  * @brief Initialize library.
@@ -100,6 +101,29 @@ LITERTP_API int LITERTP_CALL litertp_set_on_rtcp_app(litertp_session_t* session,
  */
 LITERTP_API int LITERTP_CALL litertp_set_on_rtcp_report(litertp_session_t* session, litertp_on_rtcp_report on_report, void* ctx);
 
+/**
+ * @brief Set callback function, raised in ice-lite mode when the remote end of a stream stopped its binding requests for 30 seconds,
+ * or nominated no path within 30 seconds of its sdp. The nominated path is dropped before it is raised.
+ * Removing the stream releases its ports, unless another stream of the session shares them.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] on_consent_expired - A function point to handle.
+ * @param [in] ctx - Context to on_consent_expired.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_set_on_consent_expired(litertp_session_t* session, litertp_on_consent_expired on_consent_expired, void* ctx);
+
+/**
+ * @brief Enable ice-lite, for a server with a public address.
+ * a=ice-lite is put in the sdp, binding requests are only answered and must be signed with the local password,
+ * the remote end nominates the path with USE-CANDIDATE.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] enabled - true to enable.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_set_ice_lite(litertp_session_t* session, bool enabled);
+
 /**
  * @brief Create a media stream for rtp session.
  *
@@ -132,7 +156,7 @@ LITERTP_API int LITERTP_CALL litertp_create_media_stream_custom_transport(litert
 	int port, litertp_on_send_packet on_send_packet, void* ctx);
 
 /**
- * @brief Remove a media stream from rtp session.
+ * @brief Remove the first media stream of mt from rtp session, other streams of mt are kept.
  *
  * @param [in] session - Created by litertp_create_session.
  * @param [in] mt - Enum media_type_t.
@@ -140,6 +164,81 @@ LITERTP_API int LITERTP_CALL litertp_create_media_stream_custom_transport(litert
  */
 LITERTP_API int LITERTP_CALL litertp_remove_media_stream(litertp_session_t* session, media_type_t mt);
 
+/**
+ * @brief Create a media stream with a mid, a session can have many streams of the same media type.
+ * Streams created by litertp_create_media_stream get "0","1"... as mid, and the functions taking media_type_t address the first stream of the type.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t.
+ * @param [in] mid - Unique in session.
+ * @param [in] ssrc - Specify ssrc for local stream, 0 indicate genrate randomly.
+ * @param [in] trans_mode - Enum rtp_trans_mode_t
+ * @param [in] security - Whether use DTLS.
+ * @param [in] local_address - Local address build into local sdp.
+ * @param [in] local_rtp_port - Local rtp port, streams on the same port share the socket.
+ * @param [in] local_rtcp_port - Local rtcp port.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_create_media_stream_mid(litertp_session_t* session, media_type_t mt, const char* mid, uint32_t ssrc, rtp_trans_mode_t trans_mode, bool security,
+	const char* local_address, int local_rtp_port, int local_rtcp_port);
+
+/**
+ * @brief Create a media stream in the BUNDLE group, it shares the transport (ports, ice and dtls) of the first stream of session.
+ *
+ * @param [in] session - Created by litertp_create_session, must have a media stream.
+ * @param [in] mt - Enum media_type_t.
+ * @param [in] mid - Unique in session.
+ * @param [in] ssrc - Specify ssrc for local stream, 0 indicate genrate randomly.
+ * @param [in] trans_mode - Enum rtp_trans_mode_t
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_create_bundled_media_stream(litertp_session_t* session, media_type_t mt, const char* mid, uint32_t ssrc, rtp_trans_mode_t trans_mode);
+
+/**
+ * @brief Remove the media stream of mid.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mid - Mid of stream.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_remove_media_stream_mid(litertp_session_t* session, const char* mid);
+
+/**
+ * @brief Get the mid of the media stream sending or receiving ssrc, use it to tell which stream a frame belongs to.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] ssrc - Local or remote ssrc.
+ * @param [out] mid - Buffer of mid.
+ * @param [in] size - Size of buffer.
+ * @return - Length of mid, less than 0 if not found or buffer is too small.
+ */
+LITERTP_API int LITERTP_CALL litertp_get_mid_by_ssrc(litertp_session_t* session, uint32_t ssrc, char* mid, int size);
+
+/**
+ * @brief Add a local track to the media stream of mid, like litertp_add_local_video_track and litertp_add_local_audio_track.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mid - Mid of stream.
+ * @param [in] codec - Enum codec_type_t.
+ * @param [in] pt - Payload type.
+ * @param [in] frequency - Sample rate.
+ * @param [in] channels - Audio channels, ignored for video.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_add_local_track_mid(litertp_session_t* session, const char* mid, codec_type_t codec, uint16_t pt, int frequency, int channels);
+
+/**
+ * @brief Send a audio/video frame by the media stream of mid.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mid - Mid of stream.
+ * @param [in] frame - Audio/Video frame data
+ * @param [in] size - Size of frame data
+ * @param [in] duration - Duration of frame data, for audio is Samples,for video usually is 90000/fps
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_send_frame_mid(litertp_session_t* session, const char* mid, const uint8_t* frame, uint32_t size, uint32_t duration);
+
 /**
  * @brief Clear all media streams from rtp session.
  *
@@ -452,6 +551,193 @@ LITERTP_API int LITERTP_CALL litertp_require_keyframe(litertp_session_t* session
  */
 LITERTP_API int LITERTP_CALL litertp_send_frame(litertp_session_t* session,media_type_t mt,const uint8_t* frame, uint32_t size, uint32_t duration);
 
+/**
+ * @brief Send a video frame which is already split into nals, the start code scanning is skipped.
+ * Only for h264 and h265, for vp9 each entry is a spatial layer frame from the lowest layer.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @param [in] nals - Nal units of one frame, without start code.
+ * @param [in] sizes - Size of each nal.
+ * @param [in] count - Count of nals.
+ * @param [in] duration - Duration of frame data, for video usually is 90000/fps
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_send_nals(litertp_session_t* session, media_type_t mt, const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+
+/**
+ * @brief Add a simulcast layer to local media stream, each layer has its own ssrc and rid.
+ * The first layer uses the ssrc of media stream. Call it before create offer or answer.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @param [in] rid - Restriction identifier of the layer, like "h","m","l".
+ * @param [in] ssrc - Ssrc of the layer, 0 indicate genrate randomly.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_add_local_simulcast_layer(litertp_session_t* session, media_type_t mt, const char* rid, uint32_t ssrc);
+
+/**
+ * @brief Send a frame of a simulcast layer.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @param [in] rid - Layer added by litertp_add_local_simulcast_layer.
+ * @param [in] frame - Video frame data
+ * @param [in] size - Size of frame data
+ * @param [in] duration - Duration of frame data, for video usually is 90000/fps
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_send_simulcast_frame(litertp_session_t* session, media_type_t mt, const char* rid, const uint8_t* frame, uint32_t size, uint32_t duration);
+
+/**
+ * @brief Get the rid of a received simulcast layer, frames of each layer are raised with its ssrc.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @param [in] ssrc - Ssrc of received frame.
+ * @param [out] rid - Buffer of rid.
+ * @param [in] size - Size of rid buffer.
+ * @return - Length of rid, less than 0 if ssrc is not a simulcast layer.
+ */
+LITERTP_API int LITERTP_CALL litertp_get_remote_rid(litertp_session_t* session, media_type_t mt, uint32_t ssrc, char* rid, int size);
+
+/**
+ * @brief Relay rtp packets received by a media stream to a media stream of another session.
+ * Packets are not depacketized, ssrc/seq/timestamp are rewritten to the target's,
+ * and the target's nack is answered from its own history.
+ * When the target is moved to another source, it is switched at the next keyframe.
+ *
+ * @param [in] session - Source session, created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t of source.
+ * @param [in] target - Target session, its local track must have the same codec.
+ * @param [in] target_mt - Enum media_type_t of target.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_add_forward(litertp_session_t* session, media_type_t mt, litertp_session_t* target, media_type_t target_mt);
+
+/**
+ * @brief Relay a simulcast layer received by a media stream to a media stream of another session.
+ * Call it again with another rid to switch layer, the target is switched at the next keyframe.
+ *
+ * @param [in] session - Source session, created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t of source.
+ * @param [in] rid - Simulcast layer of source.
+ * @param [in] target - Target session, its local track must have the same codec.
+ * @param [in] target_mt - Enum media_type_t of target.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_add_forward_layer(litertp_session_t* session, media_type_t mt, const char* rid, litertp_session_t* target, media_type_t target_mt);
+
+/**
+ * @brief Send a frame of a temporal layer.
+ * The layer is written in the payload descriptor for vp8, and in the frame marking extension for h264 if negotiated.
+ *
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @param [in] frame - Video frame data
+ * @param [in] size - Size of frame data
+ * @param [in] duration - Duration of frame data, for video usually is 90000/fps
+ * @param [in] layer - Temporal layer of the frame.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_send_layer_frame(litertp_session_t* session, media_type_t mt, const uint8_t* frame, uint32_t size, uint32_t duration, const temporal_layer_t* layer);
+
+/**
+ * @brief Limit the temporal layers relayed to a media stream, frames of upper layers are dropped by the forwarder.
+ * The limit is also lowered while the subscriber reports loss.
+ *
+ * @param [in] session - Target session of forwarding.
+ * @param [in] mt - Enum media_type_t
+ * @param [in] tid - Highest temporal layer to relay, -1 for all layers.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_set_max_temporal_layer(litertp_session_t* session, media_type_t mt, int tid);
+
+/**
+ * @brief Stop relaying rtp packets to a target.
+ *
+ * @param [in] session - Source session, created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t of source.
+ * @param [in] target - Target session.
+ * @param [in] target_mt - Enum media_type_t of target.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_remove_forward(litertp_session_t* session, media_type_t mt, litertp_session_t* target, media_type_t target_mt);
+
+/**
+ * @brief Create a fanout group, a frame sent to the group is packetized once
+ * and sent by every media stream in the group with its own ssrc/seq/timestamp.
+ *
+ * @param [in] mt - Enum media_type_t
+ * @param [in] codec - Codec of the frames, the local track of members must have the same codec.
+ * @param [in] pt - Payload type used for packetization.
+ * @param [in] frequency - Clock rate, for video usually is 90000.
+ * @param [in] channels - Channels of audio, 1 for video.
+ * @return - Fanout group, null if failed.
+ */
+LITERTP_API litertp_fanout_group_t* LITERTP_CALL litertp_create_fanout_group(media_type_t mt, codec_type_t codec, uint16_t pt, int frequency, int channels);
+
+/**
+ * @brief Destroy fanout group.
+ *
+ * @param [in] group - Created by litertp_create_fanout_group.
+ */
+LITERTP_API void LITERTP_CALL litertp_destroy_fanout_group(litertp_fanout_group_t** group);
+
+/**
+ * @brief Set callback function, raised when a member joins and waits for a keyframe.
+ *
+ * @param [in] group - Created by litertp_create_fanout_group.
+ * @param [in] on_keyframe_required - A function point to handle.
+ * @param [in] ctx - Context to on_keyframe_required.
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_set_fanout_on_keyframe_required_eventhandler(litertp_fanout_group_t* group, litertp_on_keyframe_required on_keyframe_required, void* ctx);
+
+/**
+ * @brief Add the media stream of a session to fanout group, it starts sending at the next keyframe.
+ *
+ * @param [in] group - Created by litertp_create_fanout_group.
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_fanout_group_add(litertp_fanout_group_t* group, litertp_session_t* session, media_type_t mt);
+
+/**
+ * @brief Remove the media stream of a session from fanout group.
+ *
+ * @param [in] group - Created by litertp_create_fanout_group.
+ * @param [in] session - Created by litertp_create_session.
+ * @param [in] mt - Enum media_type_t
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_fanout_group_remove(litertp_fanout_group_t* group, litertp_session_t* session, media_type_t mt);
+
+/**
+ * @brief Send a audio/video frame to all members of fanout group.
+ *
+ * @param [in] group - Created by litertp_create_fanout_group.
+ * @param [in] frame - Audio/Video frame data
+ * @param [in] size - Size of frame data
+ * @param [in] duration - Duration of frame data, for audio is Samples,for video usually is 90000/fps
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_fanout_group_send_frame(litertp_fanout_group_t* group, const uint8_t* frame, uint32_t size, uint32_t duration);
+
+/**
+ * @brief Send a video frame which is already split into nals to all members of fanout group.
+ *
+ * @param [in] group - Created by litertp_create_fanout_group.
+ * @param [in] nals - Nal units of one frame, without start code.
+ * @param [in] sizes - Size of each nal.
+ * @param [in] count - Count of nals.
+ * @param [in] duration - Duration of frame data, for video usually is 90000/fps
+ * @return - Greater than or equal to 0 is successed, otherwise is failed.
+ */
+LITERTP_API int LITERTP_CALL litertp_fanout_group_send_nals(litertp_fanout_group_t* group, const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+
 
 /**
  * @brief Get stats info
@@ -128,11 +128,19 @@ extern "C" {
 		rtp_receiver_stats_t receiver_stats;
 	}rtp_stats_t;
 
+	typedef struct _temporal_layer_t
+	{
+		uint8_t tid;			//Temporal layer id, 0 is the base layer.
+		uint8_t layer_sync;		//1 if the frame only refers to the base layer, upper layers can be switched on here.
+		uint8_t non_reference;	//1 if no other frame refers to it, so it can be dropped.
+	}temporal_layer_t;
+
 	typedef void (*litertp_on_frame)(void* ctx, uint32_t ssrc, uint16_t pt, int frequency, int channels, const av_frame_t* frame);
 	typedef void (*litertp_on_keyframe_required)(void* ctx, uint32_t ssrc, int mode);
 	typedef void (*litertp_on_rtcp_bye)(void* ctx, uint32_t* ssrcs,int ssrc_count,const char* message);
 	typedef void (*litertp_on_rtcp_app)(void* ctx, uint32_t ssrc, uint32_t name, const char* appdata,uint32_t data_size);
 	typedef void (*litertp_on_rtcp_report)(void* ctx, uint32_t ssrc); //no data, only for heartbeat, call litertp_get_stats for details. 
+	typedef void (*litertp_on_consent_expired)(void* ctx, const char* mid); //ice-lite only, the remote end of the stream stopped its binding requests.
 
 	/*
 	* @brief Called when custom transport want to send packet
@@ -13,13 +13,19 @@
 #include "senders/sender_audio.h"
 #include "senders/sender_audio_aac.h"
 #include "senders/sender_video_h264.h"
+#include "senders/sender_video_h265.h"
 #include "senders/sender_video_vp8.h"
+#include "senders/sender_video_vp9.h"
+#include "senders/sender_video_av1.h"
 
 
 #include "receivers/receiver_audio.h"
 #include "receivers/receiver_audio_aac.h"
 #include "receivers/receiver_video_h264.h"
+#include "receivers/receiver_video_h265.h"
 #include "receivers/receiver_video_vp8.h"
+#include "receivers/receiver_video_vp9.h"
+#include "receivers/receiver_video_av1.h"
 
 #include "proto/rtp_source.h"
 
@@ -28,10 +34,21 @@
 #include <sys2/util.h>
 #include <sys2/string_util.h>
 #include <string.h>
+#include <algorithm>
+
+//Feedback messages sent here (nack, pli, fir) are at most 20 bytes, the rest is for srtcp.
+#define RTCP_FB_BUFFER_SIZE (64 + RTCP_PACKET_TAILROOM)
+//RFC 7675, consent is lost 30 seconds after the last binding request.
+#define ICE_CONSENT_TIMEOUT_MS 30000
 
 namespace litertp
 {
 
+	static int64_t steady_ms()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
 	media_stream::media_stream(media_type_t media_type,uint32_t ssrc, const std::string& mid, const std::string& cname, const std::string& ice_options, const std::string& ice_ufrag, const std::string& ice_pwd,
 		const std::string& local_address, transport_ptr transport_rtp, transport_ptr transport_rtcp, bool is_tcp)
 	{
@@ -41,6 +58,7 @@ namespace litertp
 		local_sdp_media_.ice_pwd_= ice_pwd;
 		local_sdp_media_.msid_ = sys::util::uuid();
 		local_sdp_media_.mid_ = mid;
+		mid_ = mid;
 		local_sdp_media_.rtcp_address_ = local_address;
 		local_sdp_media_.rtcp_port_ = transport_rtcp->port_;
 		local_sdp_media_.rtp_address_ = local_address;
@@ -69,7 +87,7 @@ namespace litertp
 
 
 		transport_rtp_ = transport_rtp;
-		transport_rtp_->rtp_packet_event_.add(s_transport_rtp_packet, this);
+		transport_rtp_->demux_.add_stream(s_transport_rtp_packet, this);
 		transport_rtp_->stun_message_event_.add(s_transport_stun_message, this);
 
 		transport_rtcp_ = transport_rtcp;
@@ -78,11 +96,13 @@ namespace litertp
 		{
 			transport_rtcp_->stun_message_event_.add(s_transport_stun_message, this);
 		}
+
+		update_demux();
 	}
 
 	media_stream::~media_stream()
 	{
-		transport_rtp_->rtp_packet_event_.remove(s_transport_rtp_packet, this);
+		transport_rtp_->demux_.remove_stream(this);
 		transport_rtcp_->rtcp_packet_event_.remove(s_transport_rtcp_packet, this);
 		transport_rtp_->stun_message_event_.remove(s_transport_stun_message, this);
 		transport_rtcp_->stun_message_event_.remove(s_transport_stun_message, this);
@@ -94,23 +114,29 @@ namespace litertp
 	void media_stream::close()
 	{
 		send_rtcp_bye();
+		clear_forwards();
 
 		{
 			std::unique_lock<std::shared_mutex>lk(senders_mutex_);
 			senders_.clear();
+			layer_senders_.clear();
+			rebuild_sender_tables();
 		}
 		{
 			std::unique_lock<std::shared_mutex>lk(receivers_mutex_);
 			receivers_.clear();
+			layer_receivers_.clear();
+			remote_rids_.clear();
+			rebuild_receiver_tables();
 		}
-
+		rebuild_forward_plan();
 
 	}
 
 	
 	bool media_stream::add_local_video_track(codec_type_t codec, uint16_t pt, int frequency)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		if (local_sdp_media_.media_type_ != media_type_video)
 		{
 			return false;
@@ -124,6 +150,17 @@ namespace litertp
 		fmt.rtcp_fb_.insert("nack pli");
 		local_sdp_media_.rtpmap_.insert(std::make_pair((int)pt,fmt));
 
+		//h26x has no layer info in payload, temporal layers are tagged by frame marking.
+		if ((codec == codec_type_h264 || codec == codec_type_h265) && local_sdp_media_.get_extmap_id(SDP_EXTMAP_FRAME_MARKING) == 0)
+		{
+			add_local_extmap(SDP_EXTMAP_FRAME_MARKING);
+		}
+		//av1 key frames are told by the dependency descriptor before the payload is read.
+		if (codec == codec_type_av1 && local_sdp_media_.get_extmap_id(SDP_EXTMAP_DEPENDENCY_DESCRIPTOR) == 0)
+		{
+			add_local_extmap(SDP_EXTMAP_DEPENDENCY_DESCRIPTOR);
+		}
+
 
 
 		return true;
@@ -131,7 +168,7 @@ namespace litertp
 
 	bool media_stream::add_local_audio_track(codec_type_t codec, uint16_t pt, int frequency, int channels)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		if (local_sdp_media_.media_type_ != media_type_audio)
 		{
 			return false;
@@ -146,69 +183,77 @@ namespace litertp
 
 	bool media_stream::add_remote_video_track(codec_type_t codec, uint16_t pt, int frequency)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
 		if (media_type() != media_type_video)
 		{
 			return false;
 		}
 
-		sdp_format fmt(pt, codec, frequency);
-		remote_sdp_media_.rtpmap_.insert(std::make_pair((int)pt, fmt));
+		{
+			sdp_write_lock lk(remote_sdp_);
+			sdp_format fmt(pt, codec, frequency);
+			remote_sdp_media_.rtpmap_.insert(std::make_pair((int)pt, fmt));
+		}
 
-		
+		update_demux();
 		return true;
 	}
 
 	bool media_stream::add_remote_audio_track(codec_type_t codec, uint16_t pt, int frequency, int channels)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
-		if (media_type()!= media_type_audio)
+		if (media_type() != media_type_audio)
 		{
 			return false;
 		}
 
-		sdp_format fmt(pt, codec, frequency, channels);
-		remote_sdp_media_.rtpmap_.insert(std::make_pair((int)pt, fmt));
+		{
+			sdp_write_lock lk(remote_sdp_);
+			sdp_format fmt(pt, codec, frequency, channels);
+			remote_sdp_media_.rtpmap_.insert(std::make_pair((int)pt, fmt));
+		}
 
+		update_demux();
 		return true;
 	}
 
 
 	void media_stream::set_remote_trans_mode(rtp_trans_mode_t trans_mode)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+		sdp_write_lock lk(remote_sdp_);
 		remote_sdp_media_.trans_mode_ = trans_mode;
 	}
 	void media_stream::set_local_trans_mode(rtp_trans_mode_t trans_mode)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		local_sdp_media_.trans_mode_ = trans_mode;
 	}
 
 	void media_stream::set_remote_ssrc(uint32_t ssrc)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
-		ssrc_t ssrct;
-		ssrct.ssrc = ssrc;
-		ssrct.cname = cname_;
-		ssrct.msid = remote_sdp_media_.msid_;
-		remote_sdp_media_.ssrcs_.push_back(ssrct);
+		{
+			sdp_write_lock lk(remote_sdp_);
+			ssrc_t ssrct;
+			ssrct.ssrc = ssrc;
+			ssrct.cname = cname_;
+			ssrct.msid = remote_sdp_media_.msid_;
+			remote_sdp_media_.ssrcs_.push_back(ssrct);
+		}
+		update_demux();
 	}
 
 	void media_stream::set_remote_setup(sdp_setup_t setup)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+		sdp_write_lock lk(remote_sdp_);
 		remote_sdp_media_.setup_ = setup;
 	}
 	void media_stream::set_local_setup(sdp_setup_t setup)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		local_sdp_media_.setup_ = setup;
 	}
 
 	bool media_stream::add_remote_attribute(uint16_t pt, const char* key, const char* val)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+		sdp_write_lock lk(remote_sdp_);
 		auto itr = remote_sdp_media_.rtpmap_.find(pt);
 		if (itr == remote_sdp_media_.rtpmap_.end())
 		{
@@ -232,7 +277,7 @@ namespace litertp
 
 	bool media_stream::clear_remote_attributes(uint16_t pt)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+		sdp_write_lock lk(remote_sdp_);
 		auto itr = remote_sdp_media_.rtpmap_.find(pt);
 		if (itr == remote_sdp_media_.rtpmap_.end())
 		{
@@ -246,7 +291,7 @@ namespace litertp
 
 	bool media_stream::add_local_attribute(uint16_t pt, const char* key, const char* val)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		auto itr=local_sdp_media_.rtpmap_.find(pt);
 		if (itr == local_sdp_media_.rtpmap_.end())
 		{
@@ -270,7 +315,7 @@ namespace litertp
 
 	bool media_stream::clear_local_attributes(uint16_t pt)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		auto itr = local_sdp_media_.rtpmap_.find(pt);
 		if (itr == local_sdp_media_.rtpmap_.end())
 		{
@@ -290,7 +335,7 @@ namespace litertp
 		ca.address_ = address;
 		ca.port_ = port;
 		ca.priority_ = priority;
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		local_sdp_media_.candidates_.push_back(ca);
 	}
 
@@ -302,25 +347,25 @@ namespace litertp
 		ca.address_ = address;
 		ca.port_ = port;
 		ca.priority_ = priority;
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+		sdp_write_lock lk(remote_sdp_);
 		remote_sdp_media_.candidates_.push_back(ca);
 	}
 
 	void media_stream::clear_local_candidates()
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		local_sdp_media_.candidates_.clear();
 	}
 
 	void media_stream::clear_remote_candidates()
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+		sdp_write_lock lk(remote_sdp_);
 		remote_sdp_media_.candidates_.clear();
 	}
 
 	void media_stream::enable_dtls()
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 #ifdef LITERTP_SSL
 		if (transport_rtp_->enable_security(true))
 		{
@@ -337,7 +382,7 @@ namespace litertp
 
 	void media_stream::disable_dtls()
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 #ifdef LITERTP_SSL
 		local_sdp_media_.protos_.erase("SAVP");
 		local_sdp_media_.protos_.erase("SAVPF");
@@ -359,16 +404,18 @@ namespace litertp
 	bool media_stream::set_remote_sdp(const sdp_media& sdp, sdp_type_t sdp_type)
 	{
 		{
-			std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
+			sdp_write_lock lk(remote_sdp_);
 			remote_sdp_media_ = sdp;
 		}
+		update_demux();
 
-		sdp_media sdpm_local = this->get_local_sdp();
+		// Checks of the remote end start with its sdp.
+		nominate_deadline_ms_ = steady_ms() + ICE_CONSENT_TIMEOUT_MS;
 
 		transport_rtp_->ice_ufrag_remote_ = sdp.ice_ufrag_;
-		transport_rtp_->ice_pwd_remote_ = sdp.ice_pwd_;
+		transport_rtp_->set_ice_pwd_remote(sdp.ice_pwd_);
 		transport_rtcp_->ice_ufrag_remote_ = sdp.ice_ufrag_;
-		transport_rtcp_->ice_pwd_remote_ = sdp.ice_pwd_;
+		transport_rtcp_->set_ice_pwd_remote(sdp.ice_pwd_);
 
 		if (sdp_type == sdp_type_offer)
 		{
@@ -376,7 +423,8 @@ namespace litertp
 
 			if (sdp.setup_ == sdp_setup_actpass)
 			{
-				this->set_local_setup(sdp_setup_active);
+				// A lite agent sends no checks, so the full agent opens the dtls handshake.
+				this->set_local_setup(ice_lite_ ? sdp_setup_passive : sdp_setup_active);
 			}
 
 			if (sdp.trans_mode_ == rtp_trans_mode_recvonly)
@@ -412,10 +460,10 @@ namespace litertp
 			}
 
 			{
-				std::shared_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+				snapshot<sdp_media>::reader local(local_sdp_);
 				if (sdp.protos_.find("TLS") != sdp.protos_.end())
 				{
-					if (local_sdp_media_.protos_.find("TLS") == local_sdp_media_.protos_.end())
+					if (local->protos_.find("TLS") == local->protos_.end())
 					{
 						return false;
 					}
@@ -451,8 +499,10 @@ namespace litertp
 
 	void media_stream::set_local_sdp(const sdp_media& sdp)
 	{
-		std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+		sdp_write_lock lk(local_sdp_);
 		this->local_sdp_media_ = sdp;
+		// The session looks up streams by mid, it does not change.
+		this->local_sdp_media_.mid_ = mid_;
 	}
 
 	void media_stream::set_sdp_type(sdp_type_t sdp_type)
@@ -460,21 +510,50 @@ namespace litertp
 		sdp_type_ = sdp_type;
 		if (sdp_type_ == sdp_type_offer)
 		{
-			std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
+			sdp_write_lock lk(local_sdp_);
 			local_sdp_media_.setup_ = sdp_setup_actpass;
 		}
 	}
 
 	void media_stream::set_remote_mid(const char* mid)
 	{
-		std::unique_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
-		remote_sdp_media_.mid_ = mid;
+		{
+			sdp_write_lock lk(remote_sdp_);
+			remote_sdp_media_.mid_ = mid;
+		}
+		update_demux();
+	}
+
+	void media_stream::update_demux()
+	{
+		std::string mid;
+		std::vector<uint32_t> ssrcs;
+		std::vector<int> pts;
+		int mid_ext_id = 0;
+		{
+			snapshot<sdp_media>::reader remote(remote_sdp_);
+			mid = remote->mid_.empty() ? mid_ : remote->mid_;
+			for (auto& ssrct : remote->ssrcs_)
+			{
+				ssrcs.push_back(ssrct.ssrc);
+			}
+			// Receivers are made of remote formats.
+			for (auto& itr : remote->rtpmap_)
+			{
+				pts.push_back(itr.first);
+			}
+			mid_ext_id = remote->get_extmap_id(SDP_EXTMAP_MID);
+		}
+		transport_rtp_->demux_.update_stream(this, mid, ssrcs, pts, (uint8_t)mid_ext_id);
+
+		std::unique_lock<std::shared_mutex>lk(receivers_mutex_);
+		rebuild_remote_ssrcs();
 	}
 
 	void media_stream::set_remote_rtp_endpoint(const sockaddr* addr, int addr_size, uint32_t priority)
 	{
 		std::unique_lock<std::shared_mutex>lk(remote_rtp_endpoint_mutex_);
-		if (priority > remote_rtp_endpoint_priority)
+		if (!remote_rtp_endpoint_nominated_ && priority > remote_rtp_endpoint_priority)
 		{
 			memcpy(&remote_rtp_endpoint_, addr, addr_size);
 			remote_rtp_endpoint_priority = priority;
@@ -484,13 +563,161 @@ namespace litertp
 	void media_stream::set_remote_rtcp_endpoint(const sockaddr* addr, int addr_size, uint32_t priority)
 	{
 		std::unique_lock<std::shared_mutex>lk(remote_rtcp_endpoint_mutex_);
-		if (priority > remote_rtcp_endpoint_priority) 
+		if (!remote_rtcp_endpoint_nominated_ && priority > remote_rtcp_endpoint_priority)
+		{
+			memcpy(&remote_rtcp_endpoint_, addr, addr_size);
+			remote_rtcp_endpoint_priority = priority;
+		}
+	}
+
+	static bool same_address(const sockaddr_storage& endpoint, const sockaddr* addr)
+	{
+		if (endpoint.ss_family != addr->sa_family)
+		{
+			return false;
+		}
+		if (addr->sa_family == AF_INET)
+		{
+			const sockaddr_in* a = (const sockaddr_in*)&endpoint;
+			const sockaddr_in* b = (const sockaddr_in*)addr;
+			return a->sin_port == b->sin_port && memcmp(&a->sin_addr, &b->sin_addr, sizeof(a->sin_addr)) == 0;
+		}
+		if (addr->sa_family == AF_INET6)
+		{
+			const sockaddr_in6* a = (const sockaddr_in6*)&endpoint;
+			const sockaddr_in6* b = (const sockaddr_in6*)addr;
+			return a->sin6_port == b->sin6_port && memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+		}
+		return false;
+	}
+
+	void media_stream::nominate_remote_rtp_endpoint(const sockaddr* addr, int addr_size, uint32_t priority, bool use_candidate)
+	{
+		{
+			// Consent checks on the locked path only need the shared lock.
+			std::shared_lock<std::shared_mutex> lk(remote_rtp_endpoint_mutex_);
+			if (remote_rtp_endpoint_nominated_ && same_address(remote_rtp_endpoint_, addr))
+			{
+				remote_rtp_consent_ms_ = steady_ms();
+				return;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lk(remote_rtp_endpoint_mutex_);
+		if (remote_rtp_endpoint_nominated_)
+		{
+			// The selected path stays until its consent expires, other paths are only answered.
+			if (same_address(remote_rtp_endpoint_, addr))
+			{
+				remote_rtp_consent_ms_ = steady_ms();
+			}
+			return;
+		}
+
+		if (use_candidate)
+		{
+			memcpy(&remote_rtp_endpoint_, addr, addr_size);
+			remote_rtp_endpoint_priority = priority > 0 ? priority : 1;
+			remote_rtp_endpoint_nominated_ = true;
+			remote_rtp_consent_ms_ = steady_ms();
+			nominate_deadline_ms_ = 0;
+		}
+		else if (priority > remote_rtp_endpoint_priority)
+		{
+			memcpy(&remote_rtp_endpoint_, addr, addr_size);
+			remote_rtp_endpoint_priority = priority;
+		}
+	}
+
+	void media_stream::nominate_remote_rtcp_endpoint(const sockaddr* addr, int addr_size, uint32_t priority, bool use_candidate)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lk(remote_rtcp_endpoint_mutex_);
+			if (remote_rtcp_endpoint_nominated_ && same_address(remote_rtcp_endpoint_, addr))
+			{
+				remote_rtcp_consent_ms_ = steady_ms();
+				return;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lk(remote_rtcp_endpoint_mutex_);
+		if (remote_rtcp_endpoint_nominated_)
+		{
+			// The selected path stays until its consent expires, other paths are only answered.
+			if (same_address(remote_rtcp_endpoint_, addr))
+			{
+				remote_rtcp_consent_ms_ = steady_ms();
+			}
+			return;
+		}
+
+		if (use_candidate)
+		{
+			memcpy(&remote_rtcp_endpoint_, addr, addr_size);
+			remote_rtcp_endpoint_priority = priority > 0 ? priority : 1;
+			remote_rtcp_endpoint_nominated_ = true;
+			remote_rtcp_consent_ms_ = steady_ms();
+			nominate_deadline_ms_ = 0;
+		}
+		else if (priority > remote_rtcp_endpoint_priority)
 		{
 			memcpy(&remote_rtcp_endpoint_, addr, addr_size);
 			remote_rtcp_endpoint_priority = priority;
 		}
 	}
 
+	void media_stream::set_ice_lite(bool enabled)
+	{
+		ice_lite_ = enabled;
+		transport_rtp_->ice_lite_ = enabled;
+		transport_rtcp_->ice_lite_ = enabled;
+	}
+
+	bool media_stream::check_consent()
+	{
+		if (!ice_lite_)
+		{
+			return false;
+		}
+
+		int64_t now = steady_ms();
+		bool expired = false;
+		{
+			std::unique_lock<std::shared_mutex> lk(remote_rtp_endpoint_mutex_);
+			if (remote_rtp_endpoint_nominated_ && now - remote_rtp_consent_ms_ > ICE_CONSENT_TIMEOUT_MS)
+			{
+				memset(&remote_rtp_endpoint_, 0, sizeof(remote_rtp_endpoint_));
+				remote_rtp_endpoint_priority = 0;
+				remote_rtp_endpoint_nominated_ = false;
+				expired = true;
+			}
+		}
+		{
+			std::unique_lock<std::shared_mutex> lk(remote_rtcp_endpoint_mutex_);
+			if (remote_rtcp_endpoint_nominated_ && now - remote_rtcp_consent_ms_ > ICE_CONSENT_TIMEOUT_MS)
+			{
+				memset(&remote_rtcp_endpoint_, 0, sizeof(remote_rtcp_endpoint_));
+				remote_rtcp_endpoint_priority = 0;
+				remote_rtcp_endpoint_nominated_ = false;
+				expired = true;
+			}
+		}
+
+		int64_t deadline = nominate_deadline_ms_;
+		if (deadline > 0 && now > deadline && nominate_deadline_ms_.compare_exchange_strong(deadline, 0))
+		{
+			// The remote end never finished a check, the stream is reclaimed like a lost path.
+			expired = true;
+		}
+
+		if (expired)
+		{
+			LOGW("ice consent expired mid=%s\n", mid_.c_str());
+			litertp_on_consent_expired_.invoke(mid_.c_str());
+		}
+		return expired;
+	}
+
 	bool media_stream::get_remote_rtp_endpoint(sockaddr_storage* addr)
 	{
 		std::shared_lock<std::shared_mutex> lk(remote_rtp_endpoint_mutex_);
@@ -515,22 +742,29 @@ namespace litertp
 
 	srtp_role_t media_stream::srtp_role()
 	{
-		auto sdpm_remote = this->get_remote_sdp();
-		auto sdpm_local = this->get_local_sdp();
+		return negotiated_params()->srtp_role;
+	}
+
+	bool media_stream::check_setup()
+	{
+		return negotiated_params()->setup_valid;
+	}
 
-		if (sdpm_local.setup_ == sdp_setup_active&& (sdpm_remote.setup_ == sdp_setup_actpass || sdpm_remote.setup_ == sdp_setup_passive))
+	srtp_role_t media_stream::resolve_srtp_role(sdp_setup_t local, sdp_setup_t remote)
+	{
+		if (local == sdp_setup_active&& (remote == sdp_setup_actpass || remote == sdp_setup_passive))
 		{
 			return srtp_role_client;
 		}
-		else if (sdpm_local.setup_ == sdp_setup_passive && (sdpm_remote.setup_ == sdp_setup_actpass|| sdpm_remote.setup_ == sdp_setup_active))
+		else if (local == sdp_setup_passive && (remote == sdp_setup_actpass|| remote == sdp_setup_active))
 		{
 			return srtp_role_server;
 		}
-		else if (sdpm_local.setup_ == sdp_setup_actpass && (sdpm_remote.setup_ == sdp_setup_active))
+		else if (local == sdp_setup_actpass && (remote == sdp_setup_active))
 		{
 			return srtp_role_server;
 		}
-		else if (sdpm_local.setup_ == sdp_setup_actpass && (sdpm_remote.setup_ == sdp_setup_passive))
+		else if (local == sdp_setup_actpass && (remote == sdp_setup_passive))
 		{
 			return srtp_role_client;
 		}
@@ -540,23 +774,21 @@ namespace litertp
 		}
 	}
 
-	bool media_stream::check_setup()
+	bool media_stream::resolve_setup(sdp_setup_t local, sdp_setup_t remote)
 	{
-		auto sdpm_remote = this->get_remote_sdp();
-		auto sdpm_local = this->get_local_sdp();
-		if (sdpm_local.setup_ == sdp_setup_active && (sdpm_remote.setup_ == sdp_setup_actpass || sdpm_remote.setup_ == sdp_setup_passive))
+		if (local == sdp_setup_active && (remote == sdp_setup_actpass || remote == sdp_setup_passive))
 		{
 			return true;
 		}
-		else if (sdpm_local.setup_ == sdp_setup_passive && (sdpm_remote.setup_ == sdp_setup_actpass || sdpm_remote.setup_ == sdp_setup_active))
+		else if (local == sdp_setup_passive && (remote == sdp_setup_actpass || remote == sdp_setup_active))
 		{
 			return true;
 		}
-		else if (sdpm_local.setup_ == sdp_setup_actpass && (sdpm_remote.setup_ == sdp_setup_active))
+		else if (local == sdp_setup_actpass && (remote == sdp_setup_active))
 		{
 			return true;
 		}
-		else if (sdpm_local.setup_ == sdp_setup_actpass && (sdpm_remote.setup_ == sdp_setup_passive))
+		else if (local == sdp_setup_actpass && (remote == sdp_setup_passive))
 		{
 			return true;
 		}
@@ -569,8 +801,8 @@ namespace litertp
 	bool media_stream::negotiate()
 	{
 		{
-			std::unique_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
-			std::unique_lock<std::shared_mutex> lk2(remote_sdp_media_mutex_);
+			sdp_write_lock lk(local_sdp_);
+			sdp_write_lock lk2(remote_sdp_);
 
 			if (sdp_type_ == sdp_type_offer)
 			{
@@ -619,7 +851,21 @@ namespace litertp
 				}
 
 				//If not clear this, webrtc stream will be delayed.
-				remote_sdp_media_.extmap_.clear();
+				//Only sdes extensions are kept, they are needed to route simulcast layers,
+				//frame marking, it tells the temporal layer of h26x packets, and the av1 dependency descriptor.
+				for (auto itr = remote_sdp_media_.extmap_.begin(); itr != remote_sdp_media_.extmap_.end();)
+				{
+					const std::string& uri = itr->second;
+					if (uri.find(SDP_EXTMAP_MID) == 0 || uri.find(SDP_EXTMAP_RTP_STREAM_ID) == 0 || uri.find(SDP_EXTMAP_REPAIRED_RTP_STREAM_ID) == 0
+						|| uri.find(SDP_EXTMAP_FRAME_MARKING) == 0 || uri.find(SDP_EXTMAP_DEPENDENCY_DESCRIPTOR) == 0)
+					{
+						itr++;
+					}
+					else
+					{
+						itr = remote_sdp_media_.extmap_.erase(itr);
+					}
+				}
 
 				//use remote payload type to send
 				local_sdp_media_.rtpmap_ = remote_sdp_media_.rtpmap_;
@@ -630,10 +876,12 @@ namespace litertp
 				return false;
 			}
 		}
-		transport_rtp_->srtp_role_ = srtp_role();
-		transport_rtcp_->srtp_role_ = srtp_role();
+		srtp_role_t role = srtp_role();
+		transport_rtp_->srtp_role_ = role;
+		transport_rtcp_->srtp_role_ = role;
 		transport_rtp_->sdp_type_ = sdp_type_;
 		transport_rtcp_->sdp_type_ = sdp_type_;
+		update_demux();
 		return true;
 	}
 
@@ -659,12 +907,11 @@ namespace litertp
 					rtcp_sr_add_report(&sr, &rp);
 				}
 
+				size_t offset = compound_pkt.size();
 				size_t size = rtcp_sr_size(&sr);
-				uint8_t* buf_sr = (uint8_t*)malloc(2048);
-				if (buf_sr) {
-					rtcp_sr_serialize(&sr, buf_sr, size);
-					compound_pkt.append((const char*)buf_sr, size);
-					free(buf_sr);
+				compound_pkt.resize(offset + size);
+				if (rtcp_sr_serialize(&sr, (uint8_t*)&compound_pkt[offset], size) < 0) {
+					compound_pkt.resize(offset);
 				}
 			}
 		}
@@ -679,12 +926,11 @@ namespace litertp
 				rtcp_report rp;
 				receiver->prepare_rr(rp);
 				rtcp_rr_add_report(rr, &rp);
+				size_t offset = compound_pkt.size();
 				size_t size = rtcp_rr_size(rr);
-				uint8_t* buf_rr = (uint8_t*)malloc(2048);
-				if (buf_rr) {
-					rtcp_rr_serialize(rr, buf_rr, size);
-					compound_pkt.append((const char*)buf_rr, size);
-					free(buf_rr);
+				compound_pkt.resize(offset + size);
+				if (rtcp_rr_serialize(rr, (uint8_t*)&compound_pkt[offset], size) < 0) {
+					compound_pkt.resize(offset);
 				}
 				rtcp_rr_free(rr);
 			}
@@ -696,22 +942,24 @@ namespace litertp
 		rtcp_sdes* sdes = rtcp_sdes_create();
 		rtcp_sdes_init(sdes);
 		
-		auto sdpm_local = this->get_local_sdp();
-		for (auto itr : sdpm_local.ssrcs_) 
+		auto sdpm_local = this->local_sdp();
+		for (auto& itr : sdpm_local->ssrcs_) 
 		{
 			rtcp_sdes_add_entry(sdes, itr.ssrc);
 			rtcp_sdes_set_item(sdes, itr.ssrc, RTCP_SDES_CNAME, itr.cname.c_str());
 		}
+		size_t offset = compound_pkt.size();
 		size_t size = rtcp_sdes_size(sdes);
-		uint8_t* buf_sdes = (uint8_t*)malloc(size);
-		if (buf_sdes) {
-			rtcp_sdes_serialize(sdes, buf_sdes, size);
-			compound_pkt.append((const char*)buf_sdes, size);
-			free(buf_sdes);
+		compound_pkt.resize(offset + size);
+		if (rtcp_sdes_serialize(sdes, (uint8_t*)&compound_pkt[offset], size) < 0) {
+			compound_pkt.resize(offset);
 		}
 		rtcp_sdes_free(sdes);
 
-		send_rtcp_packet((uint8_t*)compound_pkt.data(), (int)compound_pkt.size());
+		// srtcp appends its trailer in place.
+		size_t len = compound_pkt.size();
+		compound_pkt.resize(len + RTCP_PACKET_TAILROOM);
+		send_rtcp_packet((uint8_t*)compound_pkt.data(), (int)len);
 
 
 
@@ -719,23 +967,28 @@ namespace litertp
 
 	void media_stream::run_stun_request()
 	{
+		if (ice_lite_)
+		{
+			return;
+		}
+
 		sockaddr_storage addr_rtp = { 0 };
 		sockaddr_storage addr_rtcp = { 0 };
 
-		auto sdpm_remote = this->get_remote_sdp();
+		auto params = this->negotiated_params();
 
 		if (get_remote_rtp_endpoint(&addr_rtp) && get_remote_rtcp_endpoint(&addr_rtcp))
 		{
 			this->get_remote_rtp_endpoint(&addr_rtp);
 			transport_rtp_->send_stun_request((const sockaddr*)&addr_rtp, sizeof(addr_rtp), remote_rtp_endpoint_priority);
-			if (!sdpm_remote.rtcp_mux_)
+			if (!params->remote_rtcp_mux)
 			{
 				transport_rtcp_->send_stun_request((const sockaddr*)&addr_rtcp, sizeof(addr_rtcp), remote_rtcp_endpoint_priority);
 			}
 		}
 		else
 		{
-			for (auto& ca : sdpm_remote.candidates_)
+			for (auto& ca : params->remote->candidates_)
 			{
 				if (ca.component_ == 1)
 				{
@@ -765,8 +1018,8 @@ namespace litertp
 		fb.ssrc_media = ssrc_media;
 		rtcp_rtpfb_nack_set(&fb, pid, blp);
 
-		uint8_t buffer[2048] = { 0 };// size 2048 for srtp
-		int size=rtcp_fb_serialize(&fb, buffer,sizeof(buffer));
+		uint8_t buffer[RTCP_FB_BUFFER_SIZE];
+		int size=rtcp_fb_serialize(&fb, buffer,sizeof(buffer) - RTCP_PACKET_TAILROOM);
 		if (size>0)
 		{
 			send_rtcp_packet(buffer, size);
@@ -782,16 +1035,16 @@ namespace litertp
 
 	void media_stream::send_rtcp_keyframe(uint32_t ssrc_media)
 	{
-		auto sdpm_remote = get_remote_sdp();
+		auto params = negotiated_params();
 		uint32_t ssrc=get_local_ssrc();
 		
-		for (auto itr_fmt = sdpm_remote.rtpmap_.begin(); itr_fmt != sdpm_remote.rtpmap_.end(); itr_fmt++)
+		for (auto& fb : params->keyframe_fbs)
 		{
-			if (itr_fmt->second.rtcp_fb_.find("nack pli") != itr_fmt->second.rtcp_fb_.end())
+			if (fb.pli)
 			{
 				send_rtcp_keyframe_pli(ssrc, ssrc_media);
 			}
-			else if (itr_fmt->second.rtcp_fb_.find("ccm fir") != itr_fmt->second.rtcp_fb_.end())
+			else if (fb.fir)
 			{
 				send_rtcp_keyframe_fir(ssrc, ssrc_media);
 			}
@@ -804,21 +1057,23 @@ namespace litertp
 
 	void media_stream::send_rtcp_keyframe(uint32_t ssrc_media, uint16_t pt)
 	{
-		auto sdpm_remote = get_remote_sdp();
+		auto params = negotiated_params();
 
 		uint32_t ssrc = get_local_ssrc();
 
-		auto itr_fmt = sdpm_remote.rtpmap_.find(pt);
-		if (itr_fmt == sdpm_remote.rtpmap_.end())
+		auto itr_fb = std::find_if(params->keyframe_fbs.begin(), params->keyframe_fbs.end(), [pt](const negotiated_params_t::keyframe_fb_t& fb) {
+			return fb.pt == pt;
+			});
+		if (itr_fb == params->keyframe_fbs.end())
 		{
 			return;
 		}
 
-		if (itr_fmt->second.rtcp_fb_.find("nack pli") == itr_fmt->second.rtcp_fb_.end())
+		if (!itr_fb->pli)
 		{
 			send_rtcp_keyframe_pli(ssrc, ssrc_media);
 		}
-		else if (itr_fmt->second.rtcp_fb_.find("ccm fir") == itr_fmt->second.rtcp_fb_.end())
+		else if (!itr_fb->fir)
 		{
 			send_rtcp_keyframe_fir(ssrc, ssrc_media);
 		}
@@ -840,8 +1095,8 @@ namespace litertp
 		rtcp_fb_init(&fb, RTCP_PSFB, RTCP_PSFB_FMT_PLI);
 		fb.ssrc_sender = ssrc_sender;
 		fb.ssrc_media = ssrc_media;
-		uint8_t buffer[2048] = { 0 };// size 2048 for srtp
-		int size=rtcp_fb_serialize(&fb, buffer, sizeof(buffer));
+		uint8_t buffer[RTCP_FB_BUFFER_SIZE];
+		int size=rtcp_fb_serialize(&fb, buffer, sizeof(buffer) - RTCP_PACKET_TAILROOM);
 		if (size > 0) 
 		{
 			send_rtcp_packet(buffer, size);
@@ -869,8 +1124,8 @@ namespace litertp
 		}
 		rtcp_fb_set_fci(&fb, fci, sizeof(fci));
 
-		uint8_t buffer[2048] = { 0 };// size 2048 for srtp
-		int size = rtcp_fb_serialize(&fb, buffer, sizeof(buffer));
+		uint8_t buffer[RTCP_FB_BUFFER_SIZE];
+		int size = rtcp_fb_serialize(&fb, buffer, sizeof(buffer) - RTCP_PACKET_TAILROOM);
 		if (size > 0)
 		{
 			send_rtcp_packet(buffer, size);
@@ -892,11 +1147,11 @@ namespace litertp
 			rtcp_bye_add_source(pkt, sender->ssrc());
 		}
 		
-		uint8_t buffer[2048] = { 0 };
-		int size=rtcp_bye_serialize(pkt, buffer, sizeof(buffer));
+		std::vector<uint8_t> buffer(rtcp_bye_size(pkt) + RTCP_PACKET_TAILROOM);
+		int size=rtcp_bye_serialize(pkt, buffer.data(), buffer.size() - RTCP_PACKET_TAILROOM);
 		if (size > 0)
 		{
-			send_rtcp_packet(buffer, size);
+			send_rtcp_packet(buffer.data(), size);
 		}
 	}
 
@@ -909,6 +1164,14 @@ namespace litertp
 		return transport_rtp_->send_rtp_packet(packet, (const sockaddr*)&addr, sizeof(addr));
 	}
 
+	bool media_stream::send_rtp_packets(const std::vector<packet_ptr>& packets)
+	{
+		sockaddr_storage addr = { 0 };
+		this->get_remote_rtp_endpoint(&addr);
+
+		return transport_rtp_->send_rtp_packets(packets, (const sockaddr*)&addr, sizeof(addr));
+	}
+
 	bool media_stream::send_rtcp_packet(uint8_t* rtcp_data, int size)
 	{
 		sockaddr_storage addr = { 0 };
@@ -919,8 +1182,8 @@ namespace litertp
 
 	media_type_t media_stream::media_type()
 	{
-		std::shared_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
-		return local_sdp_media_.media_type_;
+		snapshot<sdp_media>::reader local(local_sdp_);
+		return local->media_type_;
 	}
 
 	bool media_stream::send_frame(const uint8_t* frame, uint32_t size, uint32_t duration)
@@ -934,186 +1197,603 @@ namespace litertp
 		return sender->send_frame(frame, size, duration);
 	}
 
-
-	sdp_media media_stream::get_local_sdp()
-	{
-		std::shared_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
-		return local_sdp_media_;
-
-	}
-
-	sdp_media media_stream::get_remote_sdp()
-	{
-		std::shared_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
-		return remote_sdp_media_;
-	}
-
-	bool media_stream::get_local_format(int pt, sdp_format& fmt)
-	{
-		std::shared_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
-		auto itr=local_sdp_media_.rtpmap_.find(pt);
-		if (itr == local_sdp_media_.rtpmap_.end())
-		{
-			return false;
-		}
-
-		fmt = itr->second;
-		return true;
-	}
-	bool media_stream::get_remote_format(int pt, sdp_format& fmt)
+	bool media_stream::send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
 	{
-		std::shared_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
-		auto itr = remote_sdp_media_.rtpmap_.find(pt);
-		if (itr == remote_sdp_media_.rtpmap_.end())
+		auto sender = get_default_sender();
+		if (!sender)
 		{
 			return false;
 		}
 
-		fmt = itr->second;
-		return true;
+		return sender->send_nals(nals, sizes, count, duration);
 	}
 
-	uint32_t media_stream::get_local_ssrc(int idx)
+	bool media_stream::add_local_simulcast_layer(const std::string& rid, uint32_t ssrc)
 	{
-		std::shared_lock<std::shared_mutex> lk(local_sdp_media_mutex_);
-		if (idx < 0 || idx >= local_sdp_media_.ssrcs_.size())
+		if (rid.empty())
 		{
-			return 0;
+			return false;
 		}
 
-		return local_sdp_media_.ssrcs_[idx].ssrc;
-	}
-	uint32_t media_stream::get_remote_ssrc(int idx)
-	{
-		std::shared_lock<std::shared_mutex> lk(remote_sdp_media_mutex_);
-		if (idx < 0 || idx >= remote_sdp_media_.ssrcs_.size())
+		sdp_write_lock lk(local_sdp_);
+		for (auto& itr : local_sdp_media_.rids_)
 		{
-			return 0;
+			if (itr.id == rid)
+			{
+				return false;
+			}
 		}
 
-		return remote_sdp_media_.ssrcs_[idx].ssrc;
-	}
-
-	void media_stream::get_stats(rtp_stats_t& stats)
-	{
-		memset(&stats, 0, sizeof(stats));
-		auto sender=this->get_default_sender();
-		auto sdp_local = this->get_local_sdp();
-
-		uint16_t pt = 0;
-		
-		if (sender) 
+		if (local_sdp_media_.rids_.empty() && local_sdp_media_.ssrcs_.size() > 0)
 		{
-			pt=sender->format().payload_type_;
+			local_sdp_media_.ssrcs_[0].rid = rid;
 		}
-		
-		if (pt == 0)
+		else
 		{
-			auto itr = sdp_local.rtpmap_.begin();
-			if (itr != sdp_local.rtpmap_.end())
+			if (ssrc == 0)
 			{
-				pt = itr->first;
+				ssrc = sys::util::random_number<uint32_t>(0x10000, 0xFFFFFFFF);
 			}
+			ssrc_t ssrct;
+			ssrct.ssrc = ssrc;
+			ssrct.cname = cname_;
+			ssrct.msid = local_sdp_media_.msid_;
+			ssrct.rid = rid;
+			local_sdp_media_.ssrcs_.push_back(ssrct);
 		}
 
+		rid_t ridt;
+		ridt.id = rid;
+		ridt.send = true;
+		local_sdp_media_.rids_.push_back(ridt);
+		local_sdp_media_.simulcast_send_.push_back(rid);
+		local_sdp_media_.ssrc_group_ = "SIM";
 
-		stats.pt = pt;
-		stats.mt = sdp_local.media_type_;
-
-		receiver_ptr receiver = this->get_receiver(pt);
-
-		if (sender)
+		if (local_sdp_media_.get_extmap_id(SDP_EXTMAP_RTP_STREAM_ID) == 0)
 		{
-			stats.ct = sender->format().codec_;
-			sender->get_stats(stats.sender_stats);
+			add_local_extmap(SDP_EXTMAP_RTP_STREAM_ID);
 		}
+		return true;
+	}
 
-		if (receiver)
+	void media_stream::add_local_extmap(const char* uri)
+	{
+		for (int id = 1; id <= 14; id++)
 		{
-			if (stats.ct == codec_type_unknown)
+			if (local_sdp_media_.extmap_.find(id) == local_sdp_media_.extmap_.end())
 			{
-				stats.ct = receiver->format().codec_;
+				local_sdp_media_.extmap_.insert(std::make_pair(id, std::string(uri)));
+				break;
 			}
-			
-			receiver->get_stats(stats.receiver_stats);
 		}
-		
 	}
 
-
-	void media_stream::set_timestamp(uint32_t ms)
+	uint8_t media_stream::get_send_extmap_id(const char* uri)
 	{
-		std::shared_lock<std::shared_mutex>lk(senders_mutex_);
-		for (auto itr=senders_.begin();itr!=senders_.end();itr++)
+		if (sdp_type_ == sdp_type_answer)
 		{
-			itr->second->set_last_rtp_timestamp_ms(ms);
+			// The answer is made from the remote sdp, so are the extmap ids.
+			snapshot<sdp_media>::reader remote(remote_sdp_);
+			return (uint8_t)remote->get_extmap_id(uri);
 		}
+
+		snapshot<sdp_media>::reader local(local_sdp_);
+		return (uint8_t)local->get_extmap_id(uri);
 	}
 
-	uint32_t media_stream::timestamp()
+	uint8_t media_stream::get_frame_marking_id()
 	{
-		auto sender=get_default_sender();
-		if (!sender)
+		// Only sent when the remote end has accepted it.
+		if (negotiated_reader(*this)->frame_marking_ext_id == 0)
 		{
 			return 0;
 		}
-
-		return sender->last_rtp_timestamp_ms();
+		return get_send_extmap_id(SDP_EXTMAP_FRAME_MARKING);
 	}
 
-
-
-	sender_ptr media_stream::get_sender(int pt)
+	int media_stream::get_temporal_layer(codec_type_t codec, packet_ptr packet)
 	{
+		if (codec == codec_type_vp8)
 		{
-			std::shared_lock<std::shared_mutex>lk(senders_mutex_);
-			auto itr = senders_.find(pt);
-			if (itr != senders_.end())
+			return receiver_video_vp8::temporal_layer(packet->payload(), (int)packet->payload_size());
+		}
+		else if (codec == codec_type_vp9)
+		{
+			return receiver_video_vp9::temporal_layer(packet->payload(), (int)packet->payload_size());
+		}
+		else if (codec == codec_type_h264 || codec == codec_type_h265)
+		{
+			uint8_t ext_id = negotiated_reader(*this)->frame_marking_ext_id;
+			uint8_t buf[3];
+			// Only the long form carries TID.
+			if (ext_id > 0 && rtp_header_get_ext_element(packet->handle_->header, ext_id, buf, sizeof(buf)) == 3)
 			{
-				return itr->second;
+				return buf[0] & 0x07;
 			}
 		}
+		return -1;
+	}
 
-
-		sdp_format fmt;
-		if (!get_local_format(pt, fmt))
+	bool media_stream::send_layer_frame(const uint8_t* frame, uint32_t size, uint32_t duration, const temporal_layer_t& layer)
+	{
+		auto sender = get_default_sender();
+		if (!sender)
 		{
-			return nullptr;
+			return false;
 		}
 
-		return create_sender(fmt);
-
+		return sender->send_layer_frame(frame, size, duration, layer);
 	}
 
-	sender_ptr media_stream::get_sender_by_ssrc(uint32_t ssrc)
+	void media_stream::set_max_temporal_layer(int tid)
 	{
-		std::shared_lock<std::shared_mutex>lk(senders_mutex_);
-		for (auto itr = senders_.begin(); itr != senders_.end(); itr++)
+		max_temporal_layer_ = tid;
+		for (auto& sender : get_senders())
 		{
-			if (itr->second->ssrc() == ssrc)
-			{
-				return itr->second;
-			}
+			sender->set_max_temporal_layer(tid);
 		}
-		return nullptr;
 	}
 
-	sender_ptr media_stream::get_default_sender()
+	bool media_stream::send_simulcast_frame(const std::string& rid, const uint8_t* frame, uint32_t size, uint32_t duration)
 	{
+		auto sender = get_layer_sender(rid);
+		if (!sender)
 		{
-			std::shared_lock<std::shared_mutex>lk(senders_mutex_);
-			auto itr = senders_.begin();
-			if (itr != senders_.end())
-			{
-				return itr->second;
-			}
+			return false;
 		}
 
+		return sender->send_frame(frame, size, duration);
+	}
 
-
-		auto sdp = this->get_local_sdp();
-		auto itr_fmt = sdp.rtpmap_.begin();
-		if (itr_fmt == sdp.rtpmap_.end())
+	std::string media_stream::get_remote_rid(uint32_t ssrc)
+	{
+		std::shared_lock<std::shared_mutex>lk(receivers_mutex_);
+		auto itr = remote_rids_.find(ssrc);
+		if (itr == remote_rids_.end())
+		{
+			return "";
+		}
+		return itr->second;
+	}
+
+	bool media_stream::add_forward(std::shared_ptr<media_stream> target, const std::string& rid)
+	{
+		if (!target || target.get() == this)
+		{
+			return false;
+		}
+
+		{
+			std::unique_lock<std::shared_mutex>lk(forwards_mutex_);
+			bool found = false;
+			for (auto& itr : forward_targets_)
+			{
+				if (itr.stream.lock() == target)
+				{
+					if (itr.rid == rid)
+					{
+						return true;
+					}
+					// Switch layer, the target sender moves to the new ssrc at its next keyframe.
+					itr.rid = rid;
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+			{
+				forward_target_t ft;
+				ft.stream = target;
+				ft.rid = rid;
+				forward_targets_.push_back(ft);
+			}
+		}
+		rebuild_forward_plan();
+
+		{
+			std::unique_lock<std::shared_mutex>lk(target->forwards_mutex_);
+			target->forward_source_ = shared_from_this();
+		}
+
+		// The new subscriber starts from a keyframe.
+		require_keyframe();
+		return true;
+	}
+
+	bool media_stream::remove_forward(std::shared_ptr<media_stream> target)
+	{
+		bool found = false;
+		{
+			std::unique_lock<std::shared_mutex>lk(forwards_mutex_);
+			for (auto itr = forward_targets_.begin(); itr != forward_targets_.end();)
+			{
+				auto t = itr->stream.lock();
+				if (!t || t == target)
+				{
+					found = found || t == target;
+					itr = forward_targets_.erase(itr);
+				}
+				else
+				{
+					itr++;
+				}
+			}
+		}
+		rebuild_forward_plan();
+
+		if (found)
+		{
+			std::unique_lock<std::shared_mutex>lk(target->forwards_mutex_);
+			if (target->forward_source_.lock().get() == this)
+			{
+				target->forward_source_.reset();
+			}
+		}
+		return found;
+	}
+
+	void media_stream::clear_forwards()
+	{
+		{
+			std::unique_lock<std::shared_mutex>lk(forwards_mutex_);
+			forward_targets_.clear();
+			forward_source_.reset();
+		}
+		rebuild_forward_plan();
+	}
+
+	void media_stream::rebuild_forward_plan()
+	{
+		std::lock_guard<std::mutex> lk_plan(forward_plan_mutex_);
+		std::vector<forward_target_t> targets;
+		{
+			std::shared_lock<std::shared_mutex>lk(forwards_mutex_);
+			targets = forward_targets_;
+		}
+		if (targets.empty())
+		{
+			forward_plan_.store(nullptr);
+			return;
+		}
+
+		std::map<uint32_t, std::string> rids;
+		std::string first_rid;
+		{
+			std::shared_lock<std::shared_mutex>lk(receivers_mutex_);
+			rids = remote_rids_;
+			first_rid = first_remote_rid_;
+		}
+
+		// Each target takes one simulcast layer, the first layer if not specified.
+		auto plan = new forward_plan_t();
+		for (auto& target : targets)
+		{
+			if (target.rid.empty())
+			{
+				plan->others.push_back(target.stream);
+			}
+		}
+		for (auto& itr : rids)
+		{
+			auto& layer = plan->layers[itr.first];
+			for (auto& target : targets)
+			{
+				const std::string& want = target.rid.empty() ? first_rid : target.rid;
+				if (want == itr.second)
+				{
+					layer.push_back(target.stream);
+				}
+			}
+		}
+		forward_plan_.store(plan);
+	}
+
+	bool media_stream::forward_rtp_packet(const sdp_format& fmt, packet_ptr packet, bool keyframe, int tid)
+	{
+		auto sender = get_forward_sender(fmt.codec_);
+		if (!sender)
+		{
+			return false;
+		}
+
+		return sender->forward_packet(packet, keyframe, tid);
+	}
+
+	void media_stream::require_keyframe()
+	{
+		if (media_type() != media_type_video)
+		{
+			return;
+		}
+
+		std::vector<uint32_t> layers;
+		{
+			std::shared_lock<std::shared_mutex>lk(receivers_mutex_);
+			for (auto& itr : layer_receivers_)
+			{
+				layers.push_back(itr.first);
+			}
+		}
+		if (layers.size() > 0)
+		{
+			for (auto ssrc : layers)
+			{
+				send_rtcp_keyframe(ssrc);
+			}
+			return;
+		}
+
+		uint32_t ssrc_media = get_remote_ssrc();
+		if (ssrc_media == 0)
+		{
+			auto receivers = get_receivers();
+			if (receivers.empty())
+			{
+				return;
+			}
+			ssrc_media = receivers[0]->ssrc();
+		}
+		send_rtcp_keyframe(ssrc_media);
+	}
+
+
+	sdp_media media_stream::get_local_sdp()
+	{
+		return *local_sdp_.get();
+
+	}
+
+	sdp_media media_stream::get_remote_sdp()
+	{
+		return *remote_sdp_.get();
+	}
+
+	sdp_media_ptr media_stream::local_sdp()
+	{
+		return local_sdp_.get();
+	}
+
+	sdp_media_ptr media_stream::remote_sdp()
+	{
+		return remote_sdp_.get();
+	}
+
+	negotiated_params_ptr media_stream::negotiated_params()
+	{
+		negotiated_reader params(*this);
+		return params.ptr();
+	}
+
+	media_stream::negotiated_reader::negotiated_reader(media_stream& s)
+	{
+		uint64_t local_version = s.local_sdp_.version();
+		uint64_t remote_version = s.remote_sdp_.version();
+		reader_.emplace(s.negotiated_);
+		if (*reader_ && (*reader_)->local_version == local_version && (*reader_)->remote_version == remote_version)
+		{
+			return;
+		}
+
+		// Resolved outside of the read section, a racing thread resolves the same.
+		reader_.reset();
+		s.resolve_negotiated();
+		reader_.emplace(s.negotiated_);
+	}
+
+	void media_stream::resolve_negotiated()
+	{
+		// Versions are read first, params resolved from a newer sdp are only resolved once more.
+		auto node = new negotiated_node_t();
+		node->local_version = local_sdp_.version();
+		node->remote_version = remote_sdp_.version();
+		auto local = local_sdp_.get();
+		auto remote = remote_sdp_.get();
+
+		auto np = std::make_shared<negotiated_params_t>();
+		np->local = local;
+		np->remote = remote;
+		np->srtp_role = resolve_srtp_role(local->setup_, remote->setup_);
+		np->setup_valid = resolve_setup(local->setup_, remote->setup_);
+		np->remote_rtcp_mux = remote->rtcp_mux_;
+		for (auto& itr : remote->rtpmap_)
+		{
+			negotiated_params_t::keyframe_fb_t fb;
+			fb.pt = (uint16_t)itr.first;
+			fb.pli = itr.second.rtcp_fb_.find("nack pli") != itr.second.rtcp_fb_.end();
+			fb.fir = itr.second.rtcp_fb_.find("ccm fir") != itr.second.rtcp_fb_.end();
+			np->keyframe_fbs.push_back(fb);
+		}
+
+		np->rids = remote->get_send_rids();
+		if (remote->ssrc_group_ == "SIM")
+		{
+			for (auto& ssrct : remote->ssrcs_)
+			{
+				np->sim_ssrcs.push_back(ssrct.ssrc);
+			}
+		}
+		np->stream_id_ext_id = (uint8_t)remote->get_extmap_id(SDP_EXTMAP_RTP_STREAM_ID);
+		np->frame_marking_ext_id = (uint8_t)remote->get_extmap_id(SDP_EXTMAP_FRAME_MARKING);
+
+		node->params = np;
+		negotiated_.store(node);
+	}
+
+	bool media_stream::get_local_format(int pt, sdp_format& fmt)
+	{
+		snapshot<sdp_media>::reader local(local_sdp_);
+		auto itr = local->rtpmap_.find(pt);
+		if (itr == local->rtpmap_.end())
+		{
+			return false;
+		}
+
+		fmt = itr->second;
+		return true;
+	}
+	bool media_stream::get_remote_format(int pt, sdp_format& fmt)
+	{
+		snapshot<sdp_media>::reader remote(remote_sdp_);
+		auto itr = remote->rtpmap_.find(pt);
+		if (itr == remote->rtpmap_.end())
+		{
+			return false;
+		}
+
+		fmt = itr->second;
+		return true;
+	}
+
+	uint32_t media_stream::get_local_ssrc(int idx)
+	{
+		snapshot<sdp_media>::reader local(local_sdp_);
+		if (idx < 0 || idx >= (int)local->ssrcs_.size())
+		{
+			return 0;
+		}
+
+		return local->ssrcs_[idx].ssrc;
+	}
+	uint32_t media_stream::get_remote_ssrc(int idx)
+	{
+		snapshot<sdp_media>::reader remote(remote_sdp_);
+		if (idx < 0 || idx >= (int)remote->ssrcs_.size())
+		{
+			return 0;
+		}
+
+		return remote->ssrcs_[idx].ssrc;
+	}
+
+	void media_stream::get_stats(rtp_stats_t& stats)
+	{
+		memset(&stats, 0, sizeof(stats));
+		auto sender=this->get_default_sender();
+		auto sdp_local = this->local_sdp();
+
+		uint16_t pt = 0;
+		
+		if (sender) 
+		{
+			pt=sender->format().payload_type_;
+		}
+		
+		if (pt == 0)
+		{
+			auto itr = sdp_local->rtpmap_.begin();
+			if (itr != sdp_local->rtpmap_.end())
+			{
+				pt = itr->first;
+			}
+		}
+
+
+		stats.pt = pt;
+		stats.mt = sdp_local->media_type_;
+
+		receiver_ptr receiver = this->get_receiver(pt);
+
+		if (sender)
+		{
+			stats.ct = sender->format().codec_;
+			sender->get_stats(stats.sender_stats);
+		}
+
+		if (receiver)
+		{
+			if (stats.ct == codec_type_unknown)
+			{
+				stats.ct = receiver->format().codec_;
+			}
+			
+			receiver->get_stats(stats.receiver_stats);
+		}
+		
+	}
+
+
+	void media_stream::set_timestamp(uint32_t ms)
+	{
+		std::shared_lock<std::shared_mutex>lk(senders_mutex_);
+		for (auto itr=senders_.begin();itr!=senders_.end();itr++)
+		{
+			itr->second->set_last_rtp_timestamp_ms(ms);
+		}
+	}
+
+	uint32_t media_stream::timestamp()
+	{
+		auto sender=get_default_sender();
+		if (!sender)
+		{
+			return 0;
+		}
+
+		return sender->last_rtp_timestamp_ms();
+	}
+
+
+
+	sender_ptr media_stream::get_sender(int pt)
+	{
+		sender_ptr sender;
+		if (senders_by_pt_.find(pt, sender))
+		{
+			return sender;
+		}
+
+		sdp_format fmt;
+		if (!get_local_format(pt, fmt))
+		{
+			return nullptr;
+		}
+
+		return create_sender(fmt);
+
+	}
+
+	sender_ptr media_stream::get_sender_by_ssrc(uint32_t ssrc)
+	{
+		sender_ptr sender;
+		senders_by_ssrc_.find(ssrc, sender);
+		return sender;
+	}
+
+	void media_stream::rebuild_sender_tables()
+	{
+		std::vector<std::pair<uint32_t, sender_ptr>> by_pt, by_ssrc;
+		by_pt.reserve(senders_.size());
+		by_ssrc.reserve(senders_.size() + layer_senders_.size());
+		// Senders of different payload types share the ssrc, the first one is found as before.
+		for (auto itr = layer_senders_.rbegin(); itr != layer_senders_.rend(); itr++)
+		{
+			by_ssrc.push_back(std::make_pair(itr->second->ssrc(), itr->second));
+		}
+		for (auto itr = senders_.rbegin(); itr != senders_.rend(); itr++)
+		{
+			by_pt.push_back(std::make_pair((uint32_t)itr->first, itr->second));
+			by_ssrc.push_back(std::make_pair(itr->second->ssrc(), itr->second));
+		}
+		senders_by_pt_.assign(by_pt);
+		senders_by_ssrc_.assign(by_ssrc);
+	}
+
+	sender_ptr media_stream::get_default_sender()
+	{
+		{
+			std::shared_lock<std::shared_mutex>lk(senders_mutex_);
+			auto itr = senders_.begin();
+			if (itr != senders_.end())
+			{
+				return itr->second;
+			}
+		}
+
+
+
+		auto sdp = this->local_sdp();
+		auto itr_fmt = sdp->rtpmap_.begin();
+		if (itr_fmt == sdp->rtpmap_.end())
 		{
 			return nullptr;
 		}
@@ -1122,33 +1802,146 @@ namespace litertp
 		return create_sender(itr_fmt->second);
 	}
 
-	sender_ptr media_stream::create_sender(const sdp_format& fmt)
+	sender_ptr media_stream::get_forward_sender(codec_type_t codec)
 	{
+		{
+			std::shared_lock<std::shared_mutex>lk(senders_mutex_);
+			for (auto& itr : senders_)
+			{
+				if (itr.second->format().codec_ == codec)
+				{
+					return itr.second;
+				}
+			}
+		}
+
+		// The target may use another payload type for the same codec.
+		auto sdp = this->local_sdp();
+		for (auto& itr : sdp->rtpmap_)
+		{
+			if (itr.second.codec_ == codec)
+			{
+				return create_sender(itr.second);
+			}
+		}
+		return nullptr;
+	}
+
+	sender_ptr media_stream::get_layer_sender(const std::string& rid)
+	{
+		{
+			std::shared_lock<std::shared_mutex>lk(senders_mutex_);
+			auto itr = layer_senders_.find(rid);
+			if (itr != layer_senders_.end())
+			{
+				return itr->second;
+			}
+		}
+
+		uint32_t ssrc = 0;
+		{
+			snapshot<sdp_media>::reader local(local_sdp_);
+			for (auto& ssrct : local->ssrcs_)
+			{
+				if (ssrct.rid == rid)
+				{
+					ssrc = ssrct.ssrc;
+					break;
+				}
+			}
+		}
+		if (ssrc == 0)
+		{
+			return nullptr;
+		}
+		uint8_t ext_id = get_send_extmap_id(SDP_EXTMAP_RTP_STREAM_ID);
+		uint8_t frame_marking_id = get_frame_marking_id();
+
+		auto def = get_default_sender();
+		if (!def)
+		{
+			return nullptr;
+		}
+
 		std::unique_lock<std::shared_mutex>lk(senders_mutex_);
+		auto itr = layer_senders_.find(rid);
+		if (itr != layer_senders_.end())
+		{
+			return itr->second;
+		}
 
-		uint32_t ssrc = this->get_local_ssrc();
+		sender_ptr sender = def;
+		if (def->ssrc() != ssrc)
+		{
+			sender = make_sender(ssrc, media_type(), def->format());
+			sender->set_frame_marking(frame_marking_id);
+			sender->set_max_temporal_layer(max_temporal_layer_);
+			sender->send_rtp_packet_event_.add(s_send_rtp_packet_event, this);
+			sender->send_rtp_packets_event_.add(s_send_rtp_packets_event, this);
+		}
+		sender->set_rid(rid, ext_id);
+		layer_senders_.insert(std::make_pair(rid, sender));
+		rebuild_sender_tables();
+		return sender;
+	}
 
+	sender_ptr media_stream::make_sender(uint32_t ssrc, media_type_t mt, const sdp_format& fmt)
+	{
 		sender_ptr sender;
 		if (fmt.codec_ == codec_type_h264)
 		{
-			sender = std::make_shared<sender_video_h264>(ssrc, media_type(), fmt);
+			sender = std::make_shared<sender_video_h264>(ssrc, mt, fmt);
+		}
+		else if (fmt.codec_ == codec_type_h265)
+		{
+			sender = std::make_shared<sender_video_h265>(ssrc, mt, fmt);
 		}
 		else if (fmt.codec_ == codec_type_vp8)
 		{
-			sender = std::make_shared <sender_video_vp8>(ssrc, media_type(), fmt);
+			sender = std::make_shared <sender_video_vp8>(ssrc, mt, fmt);
+		}
+		else if (fmt.codec_ == codec_type_vp9)
+		{
+			sender = std::make_shared<sender_video_vp9>(ssrc, mt, fmt);
+		}
+		else if (fmt.codec_ == codec_type_av1)
+		{
+			sender = std::make_shared<sender_video_av1>(ssrc, mt, fmt);
 		}
 		else if (fmt.codec_ == codec_type_mpeg4_generic || fmt.codec_ == codec_type_mp4a_latm)
 		{
-			sender = std::make_shared<sender_audio_aac>(ssrc, media_type(), fmt);
+			sender = std::make_shared<sender_audio_aac>(ssrc, mt, fmt);
 		}
 		else
 		{
-			sender = std::make_shared<sender_audio>(ssrc, media_type(), fmt);
+			sender = std::make_shared<sender_audio>(ssrc, mt, fmt);
+		}
+		return sender;
+	}
+
+	sender_ptr media_stream::create_sender(const sdp_format& fmt)
+	{
+		uint8_t frame_marking_id = get_frame_marking_id();
+
+		std::unique_lock<std::shared_mutex>lk(senders_mutex_);
+		auto itr = senders_.find(fmt.payload_type_);
+		if (itr != senders_.end())
+		{
+			// Created by another thread.
+			return itr->second;
 		}
 
+		uint32_t ssrc = this->get_local_ssrc();
+
+		sender_ptr sender = make_sender(ssrc, media_type(), fmt);
+		sender->set_frame_marking(frame_marking_id);
+		sender->set_max_temporal_layer(max_temporal_layer_);
+
 		sender->send_rtp_packet_event_.add(s_send_rtp_packet_event, this);
+		sender->send_rtp_packets_event_.add(s_send_rtp_packets_event, this);
 
 		senders_.insert(std::make_pair(fmt.payload_type_, sender));
+		rebuild_sender_tables();
 
 		return sender;
 	}
@@ -1158,71 +1951,216 @@ namespace litertp
 		std::shared_lock<std::shared_mutex>lk(senders_mutex_);
 
 		std::vector<sender_ptr> vec;
-		vec.reserve(senders_.size());
+		vec.reserve(senders_.size() + layer_senders_.size());
 		for (auto sender : senders_)
 		{
 			vec.push_back(sender.second);
 		}
+		for (auto sender : layer_senders_)
+		{
+			// The first layer is also the default sender.
+			if (std::find(vec.begin(), vec.end(), sender.second) == vec.end())
+			{
+				vec.push_back(sender.second);
+			}
+		}
 		return vec;
 	}
 
+	receiver_ptr media_stream::make_receiver(uint32_t ssrc, const sdp_format& fmt)
+	{
+		receiver_ptr receiver;
+		if (fmt.codec_ == codec_type_h264)
+		{
+			receiver = std::make_shared<receiver_video_h264>(ssrc, media_type_video, fmt);
+		}
+		else if (fmt.codec_ == codec_type_h265)
+		{
+			receiver = std::make_shared<receiver_video_h265>(ssrc, media_type_video, fmt);
+		}
+		else if (fmt.codec_ == codec_type_vp8)
+		{
+			receiver = std::make_shared <receiver_video_vp8>(ssrc, media_type_video, fmt);
+		}
+		else if (fmt.codec_ == codec_type_vp9)
+		{
+			receiver = std::make_shared<receiver_video_vp9>(ssrc, media_type_video, fmt);
+		}
+		else if (fmt.codec_ == codec_type_av1)
+		{
+			auto av1 = std::make_shared<receiver_video_av1>(ssrc, media_type_video, fmt);
+			av1->set_dependency_descriptor((uint8_t)negotiated_reader(*this)->remote->get_extmap_id(SDP_EXTMAP_DEPENDENCY_DESCRIPTOR));
+			receiver = av1;
+		}
+		else if (fmt.codec_ == codec_type_mpeg4_generic || fmt.codec_ == codec_type_mp4a_latm)
+		{
+			receiver = std::make_shared <receiver_audio_aac>(ssrc, media_type_video, fmt);
+		}
+		else
+		{
+			receiver = std::make_shared<receiver_audio>(ssrc, media_type_audio, fmt);
+		}
+		receiver->rtp_frame_event_.add(s_rtp_frame_event, this);
+		receiver->rtp_nack_event_.add(s_rtp_nack_event, this);
+		receiver->rtp_keyframe_event_.add(s_rtp_keyframe_event, this);
+		return receiver;
+	}
+
 	receiver_ptr media_stream::get_receiver(int pt)
 	{
+		receiver_ptr receiver;
+		if (receivers_by_pt_.find(pt, receiver))
 		{
-			std::shared_lock<std::shared_mutex>lk(receivers_mutex_);
-			auto itr = receivers_.find(pt);
-			if (itr != receivers_.end())
-			{
-				return itr->second;
-			}
+			return receiver;
 		}
 
+		sdp_format fmt;
+		if (!get_remote_format(pt, fmt))
 		{
-			std::unique_lock<std::shared_mutex>lk(receivers_mutex_);
-			sdp_format fmt;
-			if (!get_remote_format(pt, fmt))
+			return nullptr;
+		}
+		uint32_t ssrc = get_remote_ssrc();
+
+		std::unique_lock<std::shared_mutex>lk(receivers_mutex_);
+		auto itr = receivers_.find(pt);
+		if (itr != receivers_.end())
+		{
+			return itr->second;
+		}
+
+		receiver = make_receiver(ssrc, fmt);
+		receivers_.insert(std::make_pair(pt, receiver));
+		rebuild_receiver_tables();
+
+		return receiver;
+	}
+
+	receiver_ptr media_stream::get_layer_receiver(packet_ptr packet)
+	{
+		uint32_t ssrc = packet->handle_->header->ssrc;
+		receiver_ptr layer;
+		if (layer_receivers_by_ssrc_.find(ssrc, layer))
+		{
+			return layer;
+		}
+
+		std::string rid, first_rid;
+		{
+			// Most streams have no simulcast layer, a miss is resolved without locking.
+			negotiated_reader params(*this);
+			if (params->rids.empty())
 			{
 				return nullptr;
 			}
-			uint32_t ssrc = get_remote_ssrc();
 
-			receiver_ptr receiver;
-			if (fmt.codec_ == codec_type_h264)
+			// A layer is found by the rtp-stream-id extension, or by the order of ssrc-group:SIM.
+			uint8_t buf[256];
+			int len = params->stream_id_ext_id > 0 ? rtp_header_get_ext_element(packet->handle_->header, params->stream_id_ext_id, buf, sizeof(buf)) : -1;
+			if (len > 0)
 			{
-				receiver = std::make_shared<receiver_video_h264>(ssrc, media_type_video, fmt);
+				rid.assign((const char*)buf, len);
 			}
-			else if (fmt.codec_ == codec_type_vp8)
+			else
 			{
-				receiver = std::make_shared <receiver_video_vp8>(ssrc, media_type_video, fmt);
+				for (size_t i = 0; i < params->sim_ssrcs.size() && i < params->rids.size(); i++)
+				{
+					if (params->sim_ssrcs[i] == ssrc)
+					{
+						rid = params->rids[i];
+						break;
+					}
+				}
 			}
-			else if (fmt.codec_ == codec_type_mpeg4_generic || fmt.codec_ == codec_type_mp4a_latm)
+			first_rid = params->rids[0];
+		}
+		if (rid.empty())
+		{
+			return nullptr;
+		}
+
+		sdp_format fmt;
+		if (!get_remote_format(packet->handle_->header->pt, fmt))
+		{
+			return nullptr;
+		}
+
+		std::unique_lock<std::shared_mutex>lk(receivers_mutex_);
+		auto itr = layer_receivers_.find(ssrc);
+		if (itr != layer_receivers_.end())
+		{
+			return itr->second;
+		}
+
+		// The layer may come back with a new ssrc.
+		for (auto itr_rid = remote_rids_.begin(); itr_rid != remote_rids_.end();)
+		{
+			if (itr_rid->second == rid)
 			{
-				receiver = std::make_shared <receiver_audio_aac>(ssrc, media_type_video, fmt);
+				layer_receivers_.erase(itr_rid->first);
+				itr_rid = remote_rids_.erase(itr_rid);
 			}
 			else
 			{
-				receiver = std::make_shared<receiver_audio>(ssrc, media_type_audio, fmt);
+				itr_rid++;
 			}
-			receiver->rtp_frame_event_.add(s_rtp_frame_event, this);
-			receiver->rtp_nack_event_.add(s_rtp_nack_event, this);
-			receiver->rtp_keyframe_event_.add(s_rtp_keyframe_event, this);
-			receivers_.insert(std::make_pair(pt, receiver));
-
-			return receiver;
 		}
+
+		receiver_ptr receiver = make_receiver(ssrc, fmt);
+		layer_receivers_.insert(std::make_pair(ssrc, receiver));
+		remote_rids_.insert(std::make_pair(ssrc, rid));
+		first_remote_rid_ = first_rid;
+		rebuild_receiver_tables();
+		lk.unlock();
+
+		rebuild_forward_plan();
+		return receiver;
 	}
 
 	receiver_ptr media_stream::get_receiver_by_ssrc(uint32_t ssrc)
 	{
-		std::shared_lock<std::shared_mutex>lk(receivers_mutex_);
-		for (auto itr = receivers_.begin(); itr != receivers_.end(); itr++)
+		receiver_ptr receiver;
+		receivers_by_ssrc_.find(ssrc, receiver);
+		return receiver;
+	}
+
+	void media_stream::rebuild_receiver_tables()
+	{
+		std::vector<std::pair<uint32_t, receiver_ptr>> by_pt, by_ssrc, layers;
+		by_pt.reserve(receivers_.size());
+		by_ssrc.reserve(receivers_.size() + layer_receivers_.size());
+		for (auto& itr : receivers_)
 		{
-			if (itr->second->ssrc() == ssrc)
+			by_pt.push_back(std::make_pair((uint32_t)itr.first, itr.second));
+			by_ssrc.push_back(std::make_pair(itr.second->ssrc(), itr.second));
+		}
+		// A layer takes the ssrc before a receiver of the same ssrc.
+		for (auto& itr : layer_receivers_)
+		{
+			by_ssrc.push_back(std::make_pair(itr.first, itr.second));
+			layers.push_back(std::make_pair(itr.first, itr.second));
+		}
+		receivers_by_pt_.assign(by_pt);
+		receivers_by_ssrc_.assign(by_ssrc);
+		layer_receivers_by_ssrc_.assign(layers);
+		rebuild_remote_ssrcs();
+	}
+
+	void media_stream::rebuild_remote_ssrcs()
+	{
+		std::vector<std::pair<uint32_t, bool>> ssrcs;
+		{
+			snapshot<sdp_media>::reader remote(remote_sdp_);
+			for (auto& ssrct : remote->ssrcs_)
 			{
-				return itr->second;
+				ssrcs.push_back(std::make_pair(ssrct.ssrc, true));
 			}
 		}
-		return nullptr;
+		// Layers found by rid may not be listed in sdp.
+		for (auto& itr : layer_receivers_)
+		{
+			ssrcs.push_back(std::make_pair(itr.first, true));
+		}
+		remote_ssrcs_.assign(ssrcs);
 	}
 
 	std::vector<receiver_ptr> media_stream::get_receivers()
@@ -1230,18 +2168,21 @@ namespace litertp
 		std::shared_lock<std::shared_mutex>lk(receivers_mutex_);
 
 		std::vector<receiver_ptr> vec;
-		vec.reserve(receivers_.size());
+		vec.reserve(receivers_.size() + layer_receivers_.size());
 		for (auto receiver : receivers_)
 		{
 			vec.push_back(receiver.second);
 		}
+		for (auto receiver : layer_receivers_)
+		{
+			vec.push_back(receiver.second);
+		}
 		return vec;
 	}
 
 	bool media_stream::has_remote_ssrc(uint32_t ssrc)
 	{
-		std::shared_lock<std::shared_mutex>lk(remote_sdp_media_mutex_);
-		return remote_sdp_media_.has_ssrc(ssrc);
+		return remote_ssrcs_.contains(ssrc);
 	}
 
 
@@ -1266,12 +2207,52 @@ namespace litertp
 		//}
 
 
-		auto receiver = p->get_receiver(packet->handle_->header->pt);
+		auto receiver = p->get_layer_receiver(packet);
+		if (!receiver)
+		{
+			receiver = p->get_receiver(packet->handle_->header->pt);
+		}
 		if (!receiver)
 		{
 			return;
 		}
-		receiver->insert_packet(packet);
+
+		std::vector<media_stream_ptr> targets;
+		{
+			published<forward_plan_t>::reader plan(p->forward_plan_);
+			if (plan)
+			{
+				auto itr = plan->layers.find(receiver->ssrc());
+				const auto& streams = itr != plan->layers.end() ? itr->second : plan->others;
+				targets.reserve(streams.size());
+				for (auto& stream : streams)
+				{
+					auto target = stream.lock();
+					if (target)
+					{
+						targets.push_back(target);
+					}
+				}
+			}
+		}
+
+		if (targets.empty())
+		{
+			receiver->insert_packet(packet);
+			return;
+		}
+
+		// Forwarding mode, frames are not assembled.
+		bool keyframe = false;
+		if (!receiver->forward_packet(packet, keyframe))
+		{
+			return;
+		}
+		int tid = p->get_temporal_layer(receiver->format().codec_, packet);
+		for (auto& target : targets)
+		{
+			target->forward_rtp_packet(receiver->format(), packet, keyframe, tid);
+		}
 
 		
 	}
@@ -1395,21 +2376,28 @@ namespace litertp
 		}
 	}
 
-	void media_stream::s_transport_stun_message(void* ctx, std::shared_ptr<sys::socket> skt, const stun_message& msg, const sockaddr* addr, int addr_size)
+	void media_stream::s_transport_stun_message(void* ctx, std::shared_ptr<sys::socket> skt, const stun_view& msg, const sockaddr* addr, int addr_size)
 	{
-		if (msg.type_ == stun_message_type_binding_request)
+		if (msg.type() == stun_message_type_binding_request)
 		{
-			std::string spriority=msg.get_attribute(stun_attribute_type_priority);
 			uint32_t priority = 0;
-			if (spriority.size() >= 4)
+			msg.get_uint32(stun_attribute_type_priority, &priority);
+
+			media_stream* p = (media_stream*)ctx;
+			if (p->ice_lite_)
 			{
-				priority |= ((uint8_t)spriority[0]) << 24;
-				priority |= ((uint8_t)spriority[1]) << 16;
-				priority |= ((uint8_t)spriority[2]) << 8;
-				priority |= ((uint8_t)spriority[3]);
+				bool use_candidate = msg.has(stun_attribute_type_use_candidate);
+				if (p->transport_rtp_->socket_ == skt)
+				{
+					p->nominate_remote_rtp_endpoint(addr, addr_size, priority, use_candidate);
+				}
+				if (p->transport_rtcp_->socket_ == skt)
+				{
+					p->nominate_remote_rtcp_endpoint(addr, addr_size, priority, use_candidate);
+				}
+				return;
 			}
 
-			media_stream* p = (media_stream*)ctx;
 			if (p->transport_rtp_->socket_ == skt)
 			{
 				p->set_remote_rtp_endpoint(addr, addr_size, priority);
@@ -1482,25 +2470,81 @@ namespace litertp
 
 	void media_stream::on_rtcp_nack(uint32_t ssrc, uint16_t pid, uint16_t bld)
 	{
-		auto sender=this->get_default_sender();
+		// Each simulcast layer keeps its own history.
+		auto sender = this->get_sender_by_ssrc(ssrc);
+		if (!sender)
+		{
+			sender = this->get_default_sender();
+		}
 		if (sender)
 		{
-			auto pkt = sender->get_history(pid);
-			if (pkt)
+			// Retransmissions of one nack are sent together.
+			// Packets not in the history were lost before they were forwarded, they are nacked to the source.
+			std::vector<packet_ptr> pkts;
+			std::vector<uint16_t> missing;
+			for (int i = -1; i < 16; i++)
 			{
-				this->send_rtp_packet(pkt);
+				if (i >= 0 && ((bld >> i) & 0x0001) == 0)
+				{
+					continue;
+				}
+				uint16_t seq = pid + i + 1;
+				auto pkt = sender->get_history(seq);
+				if (pkt)
+				{
+					pkts.push_back(pkt);
+				}
+				else
+				{
+					missing.push_back(seq);
+				}
+			}
+			if (pkts.size() > 0)
+			{
+				this->send_rtp_packets(pkts);
 			}
 
-			for (int i = 0; i < 16; i++)
+			media_stream_ptr source;
+			if (missing.size() > 0)
 			{
-				bld = bld >> i;
-				if (bld & 0x0001)
+				std::shared_lock<std::shared_mutex>lk(forwards_mutex_);
+				source = forward_source_.lock();
+			}
+			if (source)
+			{
+				// Each seq is mapped on its own, forwarded seqs are not contiguous in the source
+				// when packets were dropped or the source changed. The blp is made again from the source seqs.
+				bool pending = false;
+				uint32_t nack_ssrc = 0;
+				uint16_t nack_pid = 0;
+				uint16_t nack_blp = 0;
+				for (auto seq : missing)
 				{
-					pkt = sender->get_history(pid + i + 1);
-					if (pkt)
+					uint32_t src_ssrc = 0;
+					uint16_t src_seq = 0;
+					if (!sender->forward_source_seq(seq, &src_ssrc, &src_seq))
+					{
+						continue;
+					}
+
+					uint16_t distance = src_seq - nack_pid;
+					if (pending && src_ssrc == nack_ssrc && distance >= 1 && distance <= 16)
+					{
+						nack_blp |= (uint16_t)(1 << (distance - 1));
+						continue;
+					}
+					if (pending)
 					{
-						this->send_rtp_packet(pkt);
+						source->send_rtcp_nack(source->get_local_ssrc(), nack_ssrc, nack_pid, nack_blp);
 					}
+					pending = true;
+					nack_ssrc = src_ssrc;
+					nack_pid = src_seq;
+					nack_blp = 0;
+				}
+				if (pending)
+				{
+					source->send_rtcp_nack(source->get_local_ssrc(), nack_ssrc, nack_pid, nack_blp);
 				}
 			}
 
@@ -1519,6 +2563,17 @@ namespace litertp
 			sender->increase_pli();
 		}
 
+		// Subscribers of a forwarded stream get the keyframe from the source.
+		media_stream_ptr source;
+		{
+			std::shared_lock<std::shared_mutex>lk(forwards_mutex_);
+			source = forward_source_.lock();
+		}
+		if (source)
+		{
+			source->require_keyframe();
+		}
+
 		litertp_on_keyframe_required_.invoke(ssrc, 0);
 	}
 
@@ -1532,6 +2587,17 @@ namespace litertp
 			sender->increase_fir();
 		}
 
+		// Subscribers of a forwarded stream get the keyframe from the source.
+		media_stream_ptr source;
+		{
+			std::shared_lock<std::shared_mutex>lk(forwards_mutex_);
+			source = forward_source_.lock();
+		}
+		if (source)
+		{
+			source->require_keyframe();
+		}
+
 		litertp_on_keyframe_required_.invoke(ssrc, 1);
 	}
 
@@ -1577,6 +2643,12 @@ namespace litertp
 		p->send_rtp_packet(packet);
 	}
 
+	void media_stream::s_send_rtp_packets_event(void* ctx, const std::vector<packet_ptr>& packets)
+	{
+		media_stream* p = (media_stream*)ctx;
+		p->send_rtp_packets(packets);
+	}
+
 
 
 	
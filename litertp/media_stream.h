@@ -22,12 +22,72 @@
 #include "proto/rtcp_sdes.h"
 
 #include "sdp/sdp.h"
+#include "util/lookup_table.hpp"
+#include "util/snapshot.hpp"
+#include "util/published.hpp"
 
 #include <sys2/signal.h>
 
+#include <optional>
+#include <unordered_map>
+
 namespace litertp
 {
-	class media_stream
+	class media_stream;
+
+	typedef struct _forward_target_t
+	{
+		std::weak_ptr<media_stream> stream;
+		std::string rid; //simulcast layer to relay, empty is the first layer.
+	}forward_target_t;
+
+	//Targets of each received stream, resolved from forward targets and remote rids.
+	typedef struct _forward_plan_t
+	{
+		std::unordered_map<uint32_t, std::vector<std::weak_ptr<media_stream>>> layers; //keyed by ssrc of a simulcast layer
+		std::vector<std::weak_ptr<media_stream>> others; //streams without a rid
+	}forward_plan_t;
+
+	typedef std::shared_ptr<const sdp_media> sdp_media_ptr;
+
+	//Resolved from the local and remote sdp, for the periodic and packet paths.
+	typedef struct _negotiated_params_t
+	{
+		//The sdp this is resolved from.
+		sdp_media_ptr local;
+		sdp_media_ptr remote;
+
+		srtp_role_t srtp_role = srtp_role_client;
+		bool setup_valid = false;
+		bool remote_rtcp_mux = false;
+
+		struct keyframe_fb_t
+		{
+			uint16_t pt;
+			bool pli;
+			bool fir;
+		};
+		std::vector<keyframe_fb_t> keyframe_fbs; //remote formats
+
+		//Remote simulcast layers, and the ssrcs of ssrc-group:SIM in the same order.
+		std::vector<std::string> rids;
+		std::vector<uint32_t> sim_ssrcs;
+		//Extension ids of received packets.
+		uint8_t stream_id_ext_id = 0;
+		uint8_t frame_marking_ext_id = 0;
+	}negotiated_params_t;
+
+	typedef std::shared_ptr<const negotiated_params_t> negotiated_params_ptr;
+
+	//Negotiated params with the sdp versions they are resolved from.
+	typedef struct _negotiated_node_t
+	{
+		negotiated_params_ptr params;
+		uint64_t local_version = 0;
+		uint64_t remote_version = 0;
+	}negotiated_node_t;
+
+	class media_stream:public std::enable_shared_from_this<media_stream>
 	{
 	public:
 		media_stream(media_type_t media_type, uint32_t ssrc,const std::string& mid,const std::string& cname,const std::string& ice_options, const std::string& ice_ufrag, const std::string& ice_pwd,
@@ -77,6 +137,14 @@ namespace litertp
 		bool get_remote_rtp_endpoint(sockaddr_storage* addr);
 		bool get_remote_rtcp_endpoint(sockaddr_storage* addr);
 
+		//ICE-lite, only answer binding requests, the remote end nominates the path with USE-CANDIDATE
+		//and keeps consent with its requests.
+		void set_ice_lite(bool enabled);
+		bool ice_lite() const { return ice_lite_; }
+		//Called by the session timer, drop the nominated paths without consent, return true if any is dropped.
+		//A stream whose remote end nominates no path within the consent timeout of its remote sdp also expires, once.
+		bool check_consent();
+
 		srtp_role_t srtp_role();
 		bool check_setup();
 
@@ -96,20 +164,62 @@ namespace litertp
 		void send_rtcp_bye(const char* reason="closed");
 
 		bool send_rtp_packet(packet_ptr packet);
+		bool send_rtp_packets(const std::vector<packet_ptr>& packets);
 		bool send_rtcp_packet(uint8_t* rtcp_data,int size);
 
 		media_type_t media_type();
+		const std::string& mid()const { return mid_; }
 
 		bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration);
+		bool send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+
+		//Simulcast, each layer is sent by its own sender with a ssrc and rid.
+		//The first layer uses the ssrc of the stream.
+		bool add_local_simulcast_layer(const std::string& rid, uint32_t ssrc);
+		bool send_simulcast_frame(const std::string& rid, const uint8_t* frame, uint32_t size, uint32_t duration);
+		//rid of a received simulcast layer, empty if ssrc is not a layer.
+		std::string get_remote_rid(uint32_t ssrc);
+
+		//Relay received rtp packets to target without depacketization.
+		//For a simulcast source, only the layer of rid is relayed, call again to switch layer.
+		bool add_forward(std::shared_ptr<media_stream> target, const std::string& rid = "");
+		bool remove_forward(std::shared_ptr<media_stream> target);
+		void clear_forwards();
+		bool forward_rtp_packet(const sdp_format& fmt, packet_ptr packet, bool keyframe, int tid = -1);
+		void require_keyframe();
+
+		//Temporal layers, the layer is tagged in the vp8 descriptor, or the frame marking extension for h26x.
+		bool send_layer_frame(const uint8_t* frame, uint32_t size, uint32_t duration, const temporal_layer_t& layer);
+		//Relayed frames of temporal layers above tid are dropped, -1 forwards all layers.
+		void set_max_temporal_layer(int tid);
+
+		//Create the packetizer of codec, it is not attached to any stream.
+		static sender_ptr make_sender(uint32_t ssrc, media_type_t mt, const sdp_format& fmt);
 
 		sdp_media get_local_sdp();
 		sdp_media get_remote_sdp();
+		//Shared immutable copies, no copy is made until the sdp is changed.
+		sdp_media_ptr local_sdp();
+		sdp_media_ptr remote_sdp();
+		negotiated_params_ptr negotiated_params();
+
+		//Reads the negotiated params in place for packet paths, resolved again first if either sdp is changed.
+		class negotiated_reader
+		{
+		public:
+			explicit negotiated_reader(media_stream& s);
+			const negotiated_params_t* operator->() const { return (*reader_)->params.get(); }
+			const negotiated_params_ptr& ptr() const { return (*reader_)->params; }
+		private:
+			std::optional<published<negotiated_node_t>::reader> reader_;
+		};
 		
 		bool get_local_format(int pt, sdp_format& fmt);
 		bool get_remote_format(int pt, sdp_format& fmt);
 
 		uint32_t get_local_ssrc(int idx=0);
 		uint32_t get_remote_ssrc(int idx=0);
+		bool has_remote_ssrc(uint32_t ssrc);
 
 		void get_stats(rtp_stats_t& stats);
 
@@ -119,7 +229,7 @@ namespace litertp
 
 		static void s_transport_rtp_packet(void* ctx, std::shared_ptr<sys::socket> skt, packet_ptr packet, const sockaddr* addr, int addr_size);
 		static void s_transport_rtcp_packet(void* ctx, std::shared_ptr<sys::socket> skt, uint16_t pt, const uint8_t* buffer, size_t size, const sockaddr* addr, int addr_size);
-		static void s_transport_stun_message(void* ctx, std::shared_ptr<sys::socket> skt, const stun_message& msg, const sockaddr* addr, int addr_size);
+		static void s_transport_stun_message(void* ctx, std::shared_ptr<sys::socket> skt, const stun_view& msg, const sockaddr* addr, int addr_size);
 
 		static void s_rtp_frame_event(void* ctx, uint32_t ssrc, const sdp_format& fmt, const av_frame_t& frame);
 		void on_rtp_frame_event(uint32_t ssrc, const sdp_format& fmt, const av_frame_t& frame);
@@ -133,19 +243,45 @@ namespace litertp
 
 
 		static void s_send_rtp_packet_event(void* ctx,packet_ptr packet);
+		static void s_send_rtp_packets_event(void* ctx, const std::vector<packet_ptr>& packets);
 
 		sender_ptr get_default_sender();
 		sender_ptr get_sender(int pt);
 		sender_ptr get_sender_by_ssrc(uint32_t ssrc);
 		std::vector<sender_ptr> get_senders();
 		sender_ptr create_sender(const sdp_format& fmt);
+		sender_ptr get_forward_sender(codec_type_t codec);
+		sender_ptr get_layer_sender(const std::string& rid);
 
+		receiver_ptr make_receiver(uint32_t ssrc, const sdp_format& fmt);
 		receiver_ptr get_receiver(int pt);
+		receiver_ptr get_layer_receiver(packet_ptr packet);
 		receiver_ptr get_receiver_by_ssrc(uint32_t ssrc);
 		std::vector<receiver_ptr> get_receivers();
 
-		bool has_remote_ssrc(uint32_t ssrc);
+		//Called with senders_mutex_ or receivers_mutex_ locked.
+		void rebuild_sender_tables();
+		void rebuild_receiver_tables();
+		void rebuild_remote_ssrcs();
+
+		//Called without forwards_mutex_ and receivers_mutex_ locked.
+		void rebuild_forward_plan();
+
+		//Tell the transport which packets are for this stream.
+		void update_demux();
+		//Resolve negotiated params from the current sdp and publish them.
+		void resolve_negotiated();
+		void add_local_extmap(const char* uri);
+		uint8_t get_send_extmap_id(const char* uri);
+		uint8_t get_frame_marking_id();
+		int get_temporal_layer(codec_type_t codec, packet_ptr packet);
+
+		static srtp_role_t resolve_srtp_role(sdp_setup_t local, sdp_setup_t remote);
+		static bool resolve_setup(sdp_setup_t local, sdp_setup_t remote);
 	private:
+		//ICE-lite, a request with USE-CANDIDATE locks the path, later requests from it refresh consent.
+		void nominate_remote_rtp_endpoint(const sockaddr* addr, int addr_size, uint32_t priority, bool use_candidate);
+		void nominate_remote_rtcp_endpoint(const sockaddr* addr, int addr_size, uint32_t priority, bool use_candidate);
 
 		void on_rtcp_app(const rtcp_app* app);
 		void on_rtcp_bye(const rtcp_bye* bye);
@@ -163,10 +299,12 @@ namespace litertp
 		sys::callback<litertp_on_rtcp_app> litertp_on_rtcp_app_;
 		sys::callback<litertp_on_rtcp_bye> litertp_on_rtcp_bye_;
 		sys::callback<litertp_on_rtcp_report> litertp_on_rtcp_report_;
+		sys::callback<litertp_on_consent_expired> litertp_on_consent_expired_;
 
 		transport_ptr transport_rtp_;
 		transport_ptr transport_rtcp_;
 	private:
+		std::string mid_;
 		std::string cname_;
 
 		std::shared_mutex local_sdp_media_mutex_;
@@ -174,23 +312,57 @@ namespace litertp
 
 		std::shared_mutex remote_sdp_media_mutex_;
 		sdp_media remote_sdp_media_;
+
+		typedef snapshot<sdp_media>::write_lock sdp_write_lock;
+		snapshot<sdp_media> local_sdp_{ local_sdp_media_mutex_, local_sdp_media_ };
+		snapshot<sdp_media> remote_sdp_{ remote_sdp_media_mutex_, remote_sdp_media_ };
+		published<negotiated_node_t> negotiated_;
 		
 
 
 		std::shared_mutex remote_rtp_endpoint_mutex_;
 		sockaddr_storage remote_rtp_endpoint_ = { 0 };
 		uint32_t remote_rtp_endpoint_priority = 0;
+		bool remote_rtp_endpoint_nominated_ = false;
+		std::atomic<int64_t> remote_rtp_consent_ms_{ 0 };
 
 		std::shared_mutex remote_rtcp_endpoint_mutex_;
 		sockaddr_storage remote_rtcp_endpoint_ = { 0 };
 		uint32_t remote_rtcp_endpoint_priority = 0;
+		bool remote_rtcp_endpoint_nominated_ = false;
+		std::atomic<int64_t> remote_rtcp_consent_ms_{ 0 };
+		//Steady clock ms by which a path must be nominated, 0 if not waiting.
+		std::atomic<int64_t> nominate_deadline_ms_{ 0 };
+
+		std::atomic<bool> ice_lite_{ false };
 		
 
 		std::shared_mutex senders_mutex_;
 		std::map<int, sender_ptr> senders_;
+		std::map<std::string, sender_ptr> layer_senders_;
 
 		std::shared_mutex receivers_mutex_;
 		std::map<int, receiver_ptr> receivers_;
+		//simulcast layers received, keyed by ssrc.
+		std::map<uint32_t, receiver_ptr> layer_receivers_;
+		std::map<uint32_t, std::string> remote_rids_;
+		std::string first_remote_rid_;
+
+		//Copies of the maps above for the packet paths, read without locking.
+		lookup_table<sender_ptr> senders_by_pt_;
+		lookup_table<sender_ptr> senders_by_ssrc_;
+		lookup_table<receiver_ptr> receivers_by_pt_;
+		lookup_table<receiver_ptr> receivers_by_ssrc_;
+		lookup_table<receiver_ptr> layer_receivers_by_ssrc_;
+		lookup_table<bool> remote_ssrcs_;
+
+		std::shared_mutex forwards_mutex_;
+		std::vector<forward_target_t> forward_targets_;
+		std::weak_ptr<media_stream> forward_source_;
+		//Read by the packet path instead of forward_targets_, rebuilt one at a time.
+		std::mutex forward_plan_mutex_;
+		published<forward_plan_t> forward_plan_;
+		std::atomic<int> max_temporal_layer_ = -1;
 
 
 		sdp_type_t sdp_type_= sdp_type_offer;
@@ -6,6 +6,7 @@
  */
 
 #include "packet.h"
+#include <string.h>
 
 
 
@@ -48,22 +49,38 @@ namespace litertp {
 
 	bool packet::serialize(std::string& buffer)
 	{
-		size_t size=rtp_packet_size(handle_);
-		uint8_t* buf = (uint8_t*)malloc(size);
-		if (buf == nullptr) {
-			return false;
+		const uint8_t* data = nullptr;
+		int r = rtp_packet_serialize_inplace(handle_, &data);
+		if (r >= 0) {
+			buffer.assign((const char*)data, r);
+			return true;
 		}
 
-		int r=rtp_packet_serialize(handle_, buf, size);
+		size_t size=rtp_packet_size(handle_);
+		buffer.resize(size);
+		r=rtp_packet_serialize(handle_, (uint8_t*)buffer.data(), size);
 		if (r < 0) {
-			free(buf);
+			buffer.clear();
 			return false;
 		}
-		buffer.assign((const char*)buf,size);
-		free(buf);
 		return true;
 	}
 
+	int packet::serialize(uint8_t* buffer, size_t size)
+	{
+		return rtp_packet_serialize(handle_, buffer, size);
+	}
+
+	int packet::serialize_inplace(const uint8_t** data)
+	{
+		return rtp_packet_serialize_inplace(handle_, data);
+	}
+
+	size_t packet::tailroom()const
+	{
+		return handle_->tailroom;
+	}
+
 	bool packet::parse(const uint8_t* buffer, size_t size)
 	{
 		int r = rtp_packet_parse(handle_, buffer, size);
@@ -76,15 +93,77 @@ namespace litertp {
 
 	bool packet::set_payload(const uint8_t* payload, size_t size)
 	{
-		if (rtp_packet_set_payload(handle_, payload, size) < 0) {
+		uint8_t* buf = alloc_payload(size);
+		if (!buf) {
 			return false;
 		}
+		memcpy(buf, payload, size);
 		return true;
 	}
 
+	uint8_t* packet::alloc_payload(size_t size)
+	{
+		return rtp_packet_alloc_payload(handle_, RTP_PACKET_HEADROOM, RTP_PACKET_TAILROOM, size);
+	}
+
 	void packet::clear_payload()
 	{
 		rtp_packet_clear_payload(handle_);
+		payload_owner_.reset();
+	}
+
+	bool packet::share_payload(std::shared_ptr<packet> owner)
+	{
+		if (!owner || !owner->payload()) {
+			return false;
+		}
+		//Payload of a sealed packet is encrypted.
+		owner->shared_ = true;
+		if (owner->sealed_size_ != -1) {
+			return false;
+		}
+		if (rtp_packet_ref_payload(handle_, owner->payload(), owner->payload_size()) < 0) {
+			return false;
+		}
+		payload_owner_ = owner;
+		return true;
+	}
+
+	bool packet::mark_sent()
+	{
+		return !sent_.exchange(true);
+	}
+
+	bool packet::begin_seal(size_t trailer)
+	{
+		if (!handle_->buffer || handle_->payload_ref || handle_->tailroom < trailer) {
+			return false;
+		}
+
+		//-2 marks sealing, share_payload checks it after setting shared_.
+		sealed_size_ = -2;
+		if (shared_) {
+			sealed_size_ = -1;
+			return false;
+		}
+		return true;
+	}
+
+	void packet::seal(uint32_t generation, int size)
+	{
+		sealed_generation_ = generation;
+		sealed_size_.store(size >= 0 ? size : -2, std::memory_order_release);
+	}
+
+	int packet::sealed(uint32_t* generation, const uint8_t** data)const
+	{
+		int size = sealed_size_.load(std::memory_order_acquire);
+		if (size < 0) {
+			return -1;
+		}
+		*generation = sealed_generation_;
+		*data = (const uint8_t*)handle_->payload_data - rtp_header_size(handle_->header);
+		return size;
 	}
 
 }
@@ -8,10 +8,17 @@
 #pragma once
 #include <memory>
 #include <string>
+#include <atomic>
 #include <sys2/socket.h>
 
 #include "proto/rtp_packet.h"
 
+//Reserved in front of payload for the rtp header (fixed header, csrcs and extensions).
+#define RTP_PACKET_HEADROOM 64
+//Reserved after payload for the srtp auth tag, 16 is the tag of aes gcm, the largest profile offered.
+#define RTP_PACKET_TAILROOM 16
+//Reserved after rtcp packets for the srtcp auth tag and index.
+#define RTCP_PACKET_TAILROOM 20
 
 namespace litertp {
 
@@ -27,16 +34,44 @@ namespace litertp {
 		const uint8_t* payload()const;
 		
 		bool serialize(std::string& buffer);
+		//Write header and payload into buffer, returns the packet size or -1.
+		int serialize(uint8_t* buffer, size_t size);
+		//Write the header into the payload headroom, data points to the whole packet.
+		int serialize_inplace(const uint8_t** data);
+		//Bytes free after the serialized packet.
+		size_t tailroom()const;
 		bool parse(const uint8_t* buffer, size_t size);
 
 		bool set_payload(const uint8_t* payload, size_t size);
+		//Alloc payload with headroom, caller writes payload directly into the returned buffer.
+		uint8_t* alloc_payload(size_t size);
 		void clear_payload();
+		//Reference the payload of owner without copy, owner is kept alive by this packet.
+		//The shared payload must not be changed after that.
+		bool share_payload(std::shared_ptr<packet> owner);
+
+		//Returns true only on the first send of the packet.
+		bool mark_sent();
+		//The packet owns its payload, nobody shares it and trailer bytes fit in the tailroom,
+		//so it can be protected in place. The plain payload is lost after that.
+		bool begin_seal(size_t trailer);
+		//Keep the wire image protected in place with keys of generation, retransmissions send it again.
+		//size < 0 means it failed.
+		void seal(uint32_t generation, int size);
+		//Returns the wire image size or -1 if the packet is not sealed.
+		int sealed(uint32_t* generation, const uint8_t** data)const;
 
 	private:
 		void init(uint8_t pt, uint32_t ssrc, uint16_t seq, uint32_t ts);
 
 	public:
 		rtp_packet* handle_ = nullptr;
+	private:
+		std::shared_ptr<packet> payload_owner_;
+		std::atomic<bool> sent_{ false };
+		std::atomic<bool> shared_{ false };
+		uint32_t sealed_generation_ = 0;
+		std::atomic<int> sealed_size_{ -1 };
 	};
 	
 
@@ -247,7 +247,126 @@ void rtp_header_clear_ext(rtp_header *header)
 
     if(header->ext_data) {
         free(header->ext_data);
+        header->ext_data = NULL;
         header->ext_id = 0;
         header->ext_count = 0;
     }
+    header->x = 0;
+}
+
+#define RTP_EXT_ONE_BYTE 0xBEDE
+#define RTP_EXT_TWO_BYTE 0x1000
+
+static uint8_t ext_byte(const rtp_header *header, size_t i)
+{
+    return (uint8_t)(header->ext_data[i >> 2] >> (24 - 8 * (i & 3)));
+}
+
+int rtp_header_get_ext_element(
+    const rtp_header *header, uint8_t id, uint8_t *data, size_t size)
+{
+    assert(header != NULL);
+
+    if(!header->x || !header->ext_data)
+        return -1;
+
+    const int two_byte = (header->ext_id & 0xfff0) == RTP_EXT_TWO_BYTE;
+    if(!two_byte && header->ext_id != RTP_EXT_ONE_BYTE)
+        return -1;
+
+    const size_t total = 4U * header->ext_count;
+    size_t i = 0;
+    while(i < total) {
+        uint8_t eid = ext_byte(header, i);
+        if(eid == 0) {
+            // Padding
+            i++;
+            continue;
+        }
+
+        size_t len;
+        if(two_byte) {
+            if(i + 1 >= total)
+                return -1;
+            len = ext_byte(header, i + 1);
+            i += 2;
+        }
+        else {
+            len = (eid & 0x0f) + 1U;
+            eid >>= 4;
+            if(eid == 15)
+                return -1;
+            i += 1;
+        }
+
+        if(i + len > total)
+            return -1;
+
+        if(eid == id) {
+            if(len > size)
+                return -1;
+            for(size_t j = 0; j < len; j++)
+                data[j] = ext_byte(header, i + j);
+            return (int)len;
+        }
+        i += len;
+    }
+
+    return -1;
+}
+
+int rtp_header_add_ext_element(
+    rtp_header *header, uint8_t id, const uint8_t *data, size_t size)
+{
+    assert(header != NULL);
+    assert(data != NULL);
+
+    if(id < 1 || id > 14 || size < 1 || size > 16)
+        return -1;
+
+    uint8_t buf[256];
+    size_t used = 0;
+    if(header->ext_data) {
+        if(header->ext_id != RTP_EXT_ONE_BYTE)
+            return -1;
+
+        // Keep the existing elements, trailing padding is dropped.
+        const size_t total = 4U * header->ext_count;
+        size_t i = 0;
+        while(i < total) {
+            uint8_t b = ext_byte(header, i);
+            if(b == 0) {
+                i++;
+                continue;
+            }
+            size_t len = (b & 0x0f) + 1U;
+            if((b >> 4) == 15 || i + 1 + len > total
+                || used + 1 + len > sizeof(buf))
+                return -1;
+            for(size_t j = 0; j <= len; j++)
+                buf[used++] = ext_byte(header, i + j);
+            i += 1 + len;
+        }
+    }
+
+    if(used + 1 + size + 3 > sizeof(buf))
+        return -1;
+
+    buf[used++] = (uint8_t)((id << 4) | (size - 1));
+    memcpy(buf + used, data, size);
+    used += size;
+    while(used & 3)
+        buf[used++] = 0;
+
+    uint32_t words[64];
+    const uint16_t count = (uint16_t)(used / 4);
+    for(uint16_t i = 0; i < count; i++)
+        words[i] = read_u32(buf + 4 * i);
+
+    rtp_header_clear_ext(header);
+    if(rtp_header_set_ext(header, RTP_EXT_ONE_BYTE, words, count) < 0)
+        return -1;
+
+    header->x = 1;
+    return 0;
 }
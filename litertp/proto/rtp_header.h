@@ -160,6 +160,32 @@ int rtp_header_set_ext(
  */
 void rtp_header_clear_ext(rtp_header *header);
 
+/**
+ * @brief Find an element of a RFC 8285 header extension.
+ *
+ * Both the one-byte and the two-byte header forms are supported.
+ *
+ * @param [in] header - header to search.
+ * @param [in] id - element id.
+ * @param [out] data - buffer for the element data.
+ * @param [in] size - buffer size.
+ * @return element data size or -1 if not found.
+ */
+int rtp_header_get_ext_element(
+    const rtp_header *header, uint8_t id, uint8_t *data, size_t size);
+
+/**
+ * @brief Append an element to the RFC 8285 one-byte header extension.
+ *
+ * @param [out] header - header to add to.
+ * @param [in] id - element id, 1 to 14.
+ * @param [in] data - element data.
+ * @param [in] size - element data size, 1 to 16.
+ * @return 0 on success.
+ */
+int rtp_header_add_ext_element(
+    rtp_header *header, uint8_t id, const uint8_t *data, size_t size);
+
 #if defined(__cplusplus)
 }
 #endif // __cplusplus
@@ -35,8 +35,7 @@ void rtp_packet_free(rtp_packet *packet)
     if(packet->header)
         rtp_header_free(packet->header);
 
-    if(packet->payload_data)
-        free(packet->payload_data);
+    rtp_packet_clear_payload(packet);
 
     free(packet);
 }
@@ -109,11 +108,78 @@ int rtp_packet_set_payload(rtp_packet *packet, const void *data, size_t size)
     return 0;
 }
 
+uint8_t *rtp_packet_alloc_payload(
+    rtp_packet *packet, size_t headroom, size_t tailroom, size_t size)
+{
+    assert(packet != NULL);
+
+    if (packet->payload_data) {
+        return NULL;
+    }
+
+    packet->buffer = (uint8_t*)malloc(headroom + size + tailroom);
+    if(!packet->buffer)
+        return NULL;
+
+    packet->headroom = headroom;
+    packet->tailroom = tailroom;
+    packet->payload_size = size;
+    packet->payload_data = packet->buffer + headroom;
+
+    return (uint8_t*)packet->payload_data;
+}
+
+int rtp_packet_ref_payload(rtp_packet *packet, const void *data, size_t size)
+{
+    assert(packet != NULL);
+    assert(data != NULL);
+
+    if (packet->payload_data) {
+        return -1;
+    }
+
+    packet->payload_data = (void*)data;
+    packet->payload_size = size;
+    packet->payload_ref = 1;
+
+    return 0;
+}
+
+int rtp_packet_serialize_inplace(rtp_packet *packet, const uint8_t **data)
+{
+    assert(packet != NULL);
+    assert(data != NULL);
+
+    const size_t header_size = rtp_header_size(packet->header);
+    if(!packet->buffer || packet->headroom < header_size)
+        return -1;
+
+    uint8_t *start = (uint8_t*)packet->payload_data - header_size;
+    if(rtp_header_serialize(packet->header, start, header_size) < 0)
+        return -1;
+
+    *data = start;
+    return (int)(header_size + packet->payload_size);
+}
+
 void rtp_packet_clear_payload(rtp_packet *packet)
 {
     assert(packet != NULL);
 
-    if(packet->payload_data) {
+    if(packet->payload_ref) {
+        packet->payload_ref = 0;
+        packet->payload_data = NULL;
+        packet->payload_size = 0;
+    }
+    else if(packet->buffer) {
+        free(packet->buffer);
+        packet->buffer = NULL;
+        packet->headroom = 0;
+        packet->tailroom = 0;
+        packet->payload_data = NULL;
+        packet->payload_size = 0;
+    }
+    else if(packet->payload_data) {
         free(packet->payload_data);
         packet->payload_data = NULL;
         packet->payload_size = 0;
@@ -22,6 +22,10 @@ typedef struct rtp_packet {
     rtp_header *header;         /**< RTP header. */
     size_t payload_size;        /**< Size of the payload data in bytes. */
     void *payload_data;         /**< Payload data. */
+    uint8_t *buffer;            /**< Allocation holding headroom and payload. */
+    size_t headroom;            /**< Bytes reserved before payload_data. */
+    size_t tailroom;            /**< Bytes reserved after payload_data. */
+    uint8_t payload_ref;        /**< Payload is borrowed and not freed. */
 } rtp_packet;
 
 /**
@@ -96,6 +100,46 @@ int rtp_packet_parse(rtp_packet *packet, const uint8_t *buffer, size_t size);
 int rtp_packet_set_payload(
     rtp_packet *packet, const void *data, size_t size);
 
+/**
+ * @brief Allocate the RTP packet payload with headroom for the header.
+ *
+ * The caller fills the returned buffer directly, so payload data is copied
+ * only once. The headroom lets rtp_packet_serialize_inplace() put the header
+ * in front of the payload without copying it again, the tailroom lets SRTP
+ * append its authentication tag to the serialized packet.
+ *
+ * @param [out] packet - packet to allocate on.
+ * @param [in] headroom - bytes reserved before the payload.
+ * @param [in] tailroom - bytes reserved after the payload.
+ * @param [in] size - payload data size.
+ * @return payload buffer or NULL on failure.
+ */
+uint8_t *rtp_packet_alloc_payload(
+    rtp_packet *packet, size_t headroom, size_t tailroom, size_t size);
+
+/**
+ * @brief Reference an external RTP packet payload.
+ *
+ * The payload is not copied and not freed with the packet, so the caller
+ * must keep the data alive and unchanged while the packet is in use.
+ *
+ * @param [out] packet - packet to set on.
+ * @param [in] data - payload data.
+ * @param [in] size - payload data size.
+ * @return 0 on success.
+ */
+int rtp_packet_ref_payload(
+    rtp_packet *packet, const void *data, size_t size);
+
+/**
+ * @brief Write the RTP header into the payload headroom.
+ *
+ * @param [in] packet - packet to serialize.
+ * @param [out] data - start of the serialized packet.
+ * @return packet size in bytes or -1 if headroom is not enough.
+ */
+int rtp_packet_serialize_inplace(rtp_packet *packet, const uint8_t **data);
+
 /**
  * @brief Clear the RTP packet payload.
  *
@@ -118,6 +118,30 @@ namespace litertp
 	}
 
 
+	bool receiver::forward_packet(packet_ptr pkt, bool& keyframe)
+	{
+		std::unique_lock<std::shared_mutex>lk(mutex_);
+		if (!receiver::insert_packet(pkt))
+		{
+			return false;
+		}
+
+		// Nothing is reassembled, keep the seq window for nack only.
+		recv_packs_[pkt->handle_->header->seq % PACKET_BUFFER_SIZE].reset();
+
+		keyframe = is_keyframe(pkt);
+		if (keyframe)
+		{
+			waiting_for_keyframe_ = false;
+		}
+		return true;
+	}
+
+	bool receiver::is_keyframe(packet_ptr)
+	{
+		return false;
+	}
+
 	uint16_t receiver::last_rtp_seq()
 	{
 		std::shared_lock<std::shared_mutex>lk(mutex_);
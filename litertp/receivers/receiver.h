@@ -48,6 +48,12 @@ namespace litertp
 
 		virtual bool insert_packet(packet_ptr pkt) = 0;
 
+		//Update stats and nack for a packet which is relayed without depacketization.
+		bool forward_packet(packet_ptr pkt, bool& keyframe);
+
+		//Test whether a decoder can start from this packet, false unless the format tells it.
+		virtual bool is_keyframe(packet_ptr pkt);
+
 		void update_remote_sr(const rtcp_sr& sr);
 		void prepare_rr(rtcp_report& rr);
 		void get_stats(rtp_receiver_stats_t& stats);
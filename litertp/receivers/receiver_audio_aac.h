@@ -18,6 +18,8 @@ namespace litertp
 		virtual ~receiver_audio_aac();
 
 		virtual bool insert_packet(packet_ptr pkt);
+		//Every audio packet can be decoded on its own.
+		virtual bool is_keyframe(packet_ptr) { return true; }
 	private:
 		void find_a_frame();
 		bool process_rfc3640_frame(packet_ptr pkt);
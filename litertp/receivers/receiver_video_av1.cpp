@@ -0,0 +1,462 @@
+/**
+ * @file receiver_video_av1.cpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "receiver_video_av1.h"
+
+#include "../litertp_def.h"
+#include "../util/sn.hpp"
+#include "../av1/obu.h"
+#include "../log.h"
+
+#include <string.h>
+
+namespace litertp
+{
+	receiver_video_av1::receiver_video_av1(int ssrc, media_type_t mt, const sdp_format& fmt)
+		:receiver(ssrc,mt, fmt)
+	{
+	}
+
+	receiver_video_av1::~receiver_video_av1()
+	{
+	}
+
+	bool receiver_video_av1::insert_packet(packet_ptr pkt)
+	{
+		std::unique_lock<std::shared_mutex>lk(mutex_);
+		if (!receiver::insert_packet(pkt))
+		{
+			return false;
+		}
+
+		std::vector<packet_ptr> frame;
+		while (find_a_frame(frame))
+		{
+			// A completed nal
+			frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+			combin_frame(frame);
+		}
+		check_for_drop();
+
+		
+
+		return true;
+	}
+
+
+	void receiver_video_av1::set_dependency_descriptor(uint8_t ext_id)
+	{
+		dd_ext_id_ = ext_id;
+	}
+
+	bool receiver_video_av1::is_keyframe(packet_ptr pkt)
+	{
+		uint8_t ext_id = dd_ext_id_;
+		if (ext_id != 0)
+		{
+			// |S|E| template id | frame number (16) |, then |structure present|... when extended.
+			// The dependency structure is attached to every key frame, a start without it is a delta frame.
+			uint8_t dd[256];
+			int len = rtp_header_get_ext_element(pkt->handle_->header, ext_id, dd, sizeof(dd));
+			if (len >= 3)
+			{
+				if ((dd[0] & 0x80) == 0 || len < 4 || (dd[3] & 0x80) == 0)
+				{
+					return false;
+				}
+			}
+		}
+		return is_keyframe(pkt->payload(), (int)pkt->payload_size());
+	}
+
+	// The first OBU of an element, a fragment keeps its header so its payload may be cut.
+	static bool read_obu_header(const uint8_t* buf, int size, av1_obu_t* obu)
+	{
+		if (av1_obu_parse(obu, buf, size) > 0)
+		{
+			return true;
+		}
+		if (size < obu->header_size || obu->header_size == 0)
+		{
+			return false;
+		}
+
+		int pos = obu->header_size;
+		if (obu->has_size)
+		{
+			uint32_t obu_size = 0;
+			int n = av1_leb128_read(buf + pos, size - pos, &obu_size);
+			if (n == 0)
+			{
+				return false;
+			}
+			pos += n;
+		}
+		obu->payload = buf + pos;
+		obu->payload_size = size - pos;
+		return true;
+	}
+
+	bool receiver_video_av1::is_keyframe(const uint8_t* payload, int payload_size)
+	{
+		if (payload_size < 2)
+		{
+			return false;
+		}
+
+		av1_aggregation_header_t ah = {};
+		av1_aggregation_header_set(&ah, payload[0]);
+		if (ah.n)
+		{
+			// The first packet of a coded video sequence, which starts with a key frame.
+			return true;
+		}
+		if (ah.z)
+		{
+			return false;
+		}
+
+		// A sequence header may be repeated on delta frames, only the frame header tells.
+		bool reduced_still_picture = false;
+		int pos = 1;
+		int idx = 0;
+		while (pos < payload_size)
+		{
+			uint32_t len = 0;
+			if (ah.w != 0 && idx == ah.w - 1)
+			{
+				len = payload_size - pos;
+			}
+			else
+			{
+				int n = av1_leb128_read(payload + pos, payload_size - pos, &len);
+				if (n == 0)
+				{
+					return false;
+				}
+				pos += n;
+			}
+			if (len > (uint32_t)(payload_size - pos))
+			{
+				return false;
+			}
+
+			av1_obu_t obu;
+			if (!read_obu_header(payload + pos, (int)len, &obu))
+			{
+				return false;
+			}
+			if (obu.type == AV1_OBU_SEQUENCE_HEADER)
+			{
+				reduced_still_picture = av1_sequence_header_reduced_still_picture(obu.payload, obu.payload_size);
+			}
+			else if (obu.type == AV1_OBU_FRAME || obu.type == AV1_OBU_FRAME_HEADER)
+			{
+				return av1_frame_header_is_keyframe(obu.payload, obu.payload_size, reduced_still_picture);
+			}
+
+			pos += len;
+			idx++;
+		}
+		return false;
+	}
+
+	int receiver_video_av1::temporal_id(const uint8_t* payload, int payload_size)
+	{
+		if (payload_size < 2)
+		{
+			return -1;
+		}
+
+		av1_aggregation_header_t ah = {};
+		av1_aggregation_header_set(&ah, payload[0]);
+		if (ah.z)
+		{
+			return -1;
+		}
+
+		int pos = 1;
+		if (ah.w != 1)
+		{
+			uint32_t len = 0;
+			int n = av1_leb128_read(payload + pos, payload_size - pos, &len);
+			if (n == 0)
+			{
+				return -1;
+			}
+			pos += n;
+		}
+
+		av1_obu_t obu;
+		if (!read_obu_header(payload + pos, payload_size - pos, &obu))
+		{
+			return -1;
+		}
+		return obu.tid;
+	}
+
+	bool receiver_video_av1::find_a_frame(std::vector<packet_ptr>& pkts)
+	{
+		pkts.clear();
+		if (begin_seq_ < 0 || end_seq_ < 0|| sn::ahead_of<uint16_t>(begin_seq_, end_seq_))
+		{
+			return false;
+		}
+
+		
+
+		std::vector<int> idx_lst;
+		uint16_t i = begin_seq_;
+		bool detected = false;
+		while (!sn::ahead_of<uint16_t>(i, end_seq_))
+		{
+			int pos = i % PACKET_BUFFER_SIZE;
+			i++;
+			auto pkt = recv_packs_[pos];
+			if (pkt == nullptr)
+			{
+				return false;
+			}
+
+			idx_lst.push_back(pos);
+
+			if (pkt->handle_->header->m==1)
+			{
+				detected = true;
+				break;
+			}
+		}
+
+		if (!detected||idx_lst.size() == 0)
+		{
+			return false;
+		}
+
+		begin_seq_ = i;
+		frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+
+		pkts.reserve(idx_lst.size());
+		for (int idx : idx_lst)
+		{
+			pkts.push_back(recv_packs_[idx]);
+			recv_packs_[idx].reset();
+		}
+
+		return true;
+	}
+
+	void receiver_video_av1::check_for_drop()
+	{
+		if (begin_seq_ < 0 || end_seq_ < 0 || sn::ahead_of<uint16_t>(begin_seq_, end_seq_))
+		{
+			return;
+		}
+		if (!is_timeout())
+		{
+			return;
+		}
+
+		uint16_t i = begin_seq_;
+		int frame_tid = -1;
+		bool dropped = false;
+		while (!sn::ahead_of<uint16_t>(i, end_seq_))
+		{
+			int idx = i % PACKET_BUFFER_SIZE;
+			i++;
+			auto pkt = recv_packs_[idx];
+			if (!pkt)
+			{
+				continue;
+			}
+			dropped = true;
+			LOGD("drop packet %d\n", idx);
+			recv_packs_[idx].reset();
+
+			if (frame_tid < 0)
+			{
+				frame_tid = temporal_id(pkt->payload(), (int)pkt->payload_size());
+			}
+
+			if (pkt->handle_->header->m==1)
+			{
+				//new start
+				frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+				break;
+			}
+		}
+
+		// Frames of the highest temporal layer are not referenced, the next temporal unit still decodes.
+		if (dropped && (frame_tid < 0 || frame_tid < highest_tid_ || highest_tid_ == 0))
+		{
+			waiting_for_keyframe_ = true;
+		}
+
+		begin_seq_ = i;
+		frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+	}
+
+	bool receiver_video_av1::append_obu(std::string& tu, const std::string& element, bool& keyframe, bool& frame_seen, bool& reduced_still_picture)
+	{
+		const uint8_t* buf = (const uint8_t*)element.data();
+		int size = (int)element.size();
+
+		av1_obu_t obu;
+		if (av1_obu_parse(&obu, buf, size) == 0)
+		{
+			return false;
+		}
+
+		if (obu.type == AV1_OBU_SEQUENCE_HEADER)
+		{
+			reduced_still_picture = av1_sequence_header_reduced_still_picture(obu.payload, obu.payload_size);
+		}
+		else if (!frame_seen && (obu.type == AV1_OBU_FRAME || obu.type == AV1_OBU_FRAME_HEADER))
+		{
+			keyframe = av1_frame_header_is_keyframe(obu.payload, obu.payload_size, reduced_still_picture);
+			frame_seen = true;
+		}
+
+		uint8_t header[2];
+		memcpy(header, obu.header, obu.header_size);
+		header[0] |= 0x02; //obu_has_size_field
+		uint8_t leb128[8];
+		int n = av1_leb128_write(leb128, obu.payload_size);
+
+		tu.append((const char*)header, obu.header_size);
+		tu.append((const char*)leb128, n);
+		tu.append((const char*)obu.payload, obu.payload_size);
+		return true;
+	}
+
+	//https://aomediacodec.github.io/av1-rtp-spec/#44-av1-aggregation-header
+	bool receiver_video_av1::combin_frame(const std::vector<packet_ptr>& pkts)
+	{
+		if (pkts.size() <= 0) {
+			return false;
+		}
+
+		bool keyframe = false;
+		bool frame_seen = false;
+		bool reduced_still_picture = false;
+		bool pending = false;
+		std::string element;
+		std::string tu;
+		tu.reserve(pkts.size() * MAX_RTP_PAYLOAD_SIZE);
+
+		for (int i = 0; i < (int)pkts.size(); i++)
+		{
+			auto pkt = pkts[i];
+			const uint8_t* payload = pkt->payload();
+			int payload_size = pkt->payload_size();
+			if (payload_size < 1)
+			{
+				continue;
+			}
+
+			av1_aggregation_header_t ah = {};
+			av1_aggregation_header_set(&ah, payload[0]);
+			if (i == 0)
+			{
+				int tid = temporal_id(payload, payload_size);
+				if (tid > highest_tid_)
+				{
+					highest_tid_ = tid;
+				}
+			}
+
+			if (!ah.z && pending)
+			{
+				//the fragment is broken.
+				pending = false;
+				element.clear();
+			}
+
+			int pos = 1;
+			int idx = 0;
+			while (pos < payload_size)
+			{
+				uint32_t len = 0;
+				if (ah.w != 0 && idx == ah.w - 1)
+				{
+					len = payload_size - pos;
+				}
+				else
+				{
+					int n = av1_leb128_read(payload + pos, payload_size - pos, &len);
+					if (n == 0)
+					{
+						break;
+					}
+					pos += n;
+				}
+
+				if (len > (uint32_t)(payload_size - pos))
+				{
+					break;
+				}
+
+				if (idx == 0 && ah.z)
+				{
+					if (pending)
+					{
+						element.append((const char*)payload + pos, len);
+					}
+				}
+				else
+				{
+					element.assign((const char*)payload + pos, len);
+					pending = true;
+				}
+
+				pos += len;
+				idx++;
+
+				bool is_last = pos >= payload_size;
+				if (pending && !(is_last && ah.y))
+				{
+					append_obu(tu, element, keyframe, frame_seen, reduced_still_picture);
+					element.clear();
+					pending = false;
+				}
+			}
+		}
+
+		if (tu.empty())
+		{
+			return false;
+		}
+
+		if (keyframe)
+		{
+			waiting_for_keyframe_ = false;
+		}
+
+		av_frame_t frame;
+		memset(&frame, 0, sizeof(frame));
+		frame.ct = codec_type_av1;
+		frame.mt = media_type_video;
+		frame.pts = pkts[0]->handle_->header->ts;
+		frame.dts = frame.pts;
+		frame.data = (uint8_t*)tu.data();
+		frame.data_size = tu.size();
+
+		if (!waiting_for_keyframe_)
+		{
+			rtp_frame_event_.invoke(ssrc_, format_, frame);
+			stats_.frames_received++;
+		}
+		else
+		{
+			stats_.frames_droped++;
+		}
+
+		return true;
+	}
+
+
+
+}
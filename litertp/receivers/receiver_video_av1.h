@@ -0,0 +1,51 @@
+/**
+ * @file receiver_video_av1.h
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+#include "receiver.h"
+
+
+
+namespace litertp
+{
+
+	class receiver_video_av1 :public receiver
+	{
+	public:
+		receiver_video_av1(int ssrc, media_type_t mt, const sdp_format& fmt);
+		virtual ~receiver_video_av1();
+
+		virtual bool insert_packet(packet_ptr pkt);
+		virtual bool is_keyframe(packet_ptr pkt);
+		static bool is_keyframe(const uint8_t* payload, int payload_size);
+
+		//Read the dependency descriptor header extension with ext_id, 0 disables it.
+		void set_dependency_descriptor(uint8_t ext_id);
+	private:
+		bool find_a_frame(std::vector<packet_ptr>& pkts);
+
+		//check and drop the broken frame;
+		void check_for_drop();
+
+		bool combin_frame(const std::vector<packet_ptr>& pkts);
+
+		//Append an OBU element to the temporal unit with obu_size field restored.
+		//keyframe is decided by the first frame header of the temporal unit, frame_seen tells it is found.
+		static bool append_obu(std::string& tu, const std::string& element, bool& keyframe, bool& frame_seen, bool& reduced_still_picture);
+
+		//Temporal id of the first OBU in payload, -1 if it is a fragment or can not be read.
+		static int temporal_id(const uint8_t* payload, int payload_size);
+
+	private:
+		std::atomic<uint8_t> dd_ext_id_ = 0;
+		//The highest temporal layer seen, its frames are not referenced by others.
+		int highest_tid_ = 0;
+	};
+
+
+}
@@ -54,6 +54,46 @@ namespace litertp
 	}
 
 
+	bool receiver_video_h264::is_keyframe(packet_ptr pkt)
+	{
+		return is_keyframe(pkt->payload(), (int)pkt->payload_size());
+	}
+
+	bool receiver_video_h264::is_keyframe(const uint8_t* payload, int payload_size)
+	{
+		if (payload_size < 2)
+		{
+			return false;
+		}
+
+		nal_header_t fui = { 0 };
+		nal_header_set(&fui, payload[0]);
+		if (fui.t == 24) //STAP-A
+		{
+			const uint8_t* buf = payload + 1;
+			int size = payload_size - 1;
+			while (size > 2)
+			{
+				uint16_t nal_size = buf[0] << 8 | buf[1];
+				uint8_t t = buf[2] & 0x1f;
+				if (t == 5 || t == 7)
+				{
+					return true;
+				}
+				buf += nal_size + 2;
+				size -= nal_size + 2;
+			}
+			return false;
+		}
+		else if (fui.t == 28) //FU-A
+		{
+			fu_header_t fuh = { 0 };
+			fu_header_set(&fuh, payload[1]);
+			return fuh.s == 1 && (fuh.t == 5 || fuh.t == 7);
+		}
+		return fui.t == 5 || fui.t == 7;
+	}
+
 	bool receiver_video_h264::find_a_frame(std::vector<packet_ptr>& pkts)
 	{
 		pkts.clear();
@@ -217,6 +257,10 @@ namespace litertp
 				{
 					uint16_t nal_size = 0;
 					nal_size = buf[0] << 8 | buf[1];
+					if (nal_size == 0 || nal_size + 2 > size)
+					{
+						break;
+					}
 
 					std::string frame_data;
 					frame_data.reserve(nal_size + 4);
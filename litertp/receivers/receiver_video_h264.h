@@ -21,6 +21,8 @@ namespace litertp
 		virtual ~receiver_video_h264();
 
 		virtual bool insert_packet(packet_ptr pkt);
+		virtual bool is_keyframe(packet_ptr pkt);
+		static bool is_keyframe(const uint8_t* payload, int payload_size);
 	private:
 		bool find_a_frame(std::vector<packet_ptr>& pkts);
 
@@ -0,0 +1,327 @@
+/**
+ * @file receiver_video_h265.cpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "receiver_video_h265.h"
+
+#include "../litertp_def.h"
+#include "../util/sn.hpp"
+#include "../h265/nal_header.h"
+#include "../log.h"
+
+
+#include <sys2/util.h>
+#include <string.h>
+
+namespace litertp
+{
+	receiver_video_h265::receiver_video_h265(int ssrc, media_type_t mt, const sdp_format& fmt)
+		:receiver(ssrc,mt,fmt)
+	{
+	}
+
+	receiver_video_h265::~receiver_video_h265()
+	{
+	}
+
+
+
+	bool receiver_video_h265::insert_packet(packet_ptr pkt)
+	{
+		std::unique_lock<std::shared_mutex>lk(mutex_);
+		if (!receiver::insert_packet(pkt))
+		{
+			return false;
+		}
+
+		std::vector<packet_ptr> frame;
+		while (find_a_frame(frame))
+		{
+			// A completed nal
+			combin_frame(frame);
+		}
+		
+		check_for_drop();
+
+		return true;
+	}
+
+
+	bool receiver_video_h265::is_keyframe(packet_ptr pkt)
+	{
+		return is_keyframe(pkt->payload(), (int)pkt->payload_size());
+	}
+
+	bool receiver_video_h265::is_keyframe(const uint8_t* payload, int payload_size)
+	{
+		if (payload_size < 3)
+		{
+			return false;
+		}
+
+		h265_nal_header_t ph = {};
+		h265_nal_header_set(&ph, payload);
+		if (ph.t == H265_NAL_AP)
+		{
+			const uint8_t* buf = payload + 2;
+			int size = payload_size - 2;
+			while (size > 3)
+			{
+				uint16_t nal_size = buf[0] << 8 | buf[1];
+				if (h265_nal_is_keyframe((buf[2] & 0x7e) >> 1))
+				{
+					return true;
+				}
+				buf += nal_size + 2;
+				size -= nal_size + 2;
+			}
+			return false;
+		}
+		else if (ph.t == H265_NAL_FU)
+		{
+			h265_fu_header_t fuh = {};
+			h265_fu_header_set(&fuh, payload[2]);
+			return fuh.s == 1 && h265_nal_is_keyframe(fuh.t);
+		}
+		return h265_nal_is_keyframe(ph.t);
+	}
+
+	bool receiver_video_h265::find_a_frame(std::vector<packet_ptr>& pkts)
+	{
+		pkts.clear();
+		if (begin_seq_ < 0 || end_seq_ < 0|| sn::ahead_of<uint16_t>(begin_seq_, end_seq_))
+		{
+			return false;
+		}
+
+		std::vector<int> idx_lst;
+		uint16_t i = begin_seq_;
+		bool detected = false;
+		while (!sn::ahead_of<uint16_t>(i, end_seq_))
+		{
+			int pos = i % PACKET_BUFFER_SIZE;
+			i++;
+
+			auto pkt = recv_packs_[pos];
+			if (!pkt)
+			{
+				return false;
+			}
+
+			idx_lst.push_back(pos);
+
+			if (pkt->handle_->header->m==1)
+			{
+				detected = true;
+				break;
+			}
+		}
+
+		if (!detected||idx_lst.size() == 0)
+		{
+			return false;
+		}
+
+		begin_seq_ = i;
+		frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+
+		pkts.reserve(idx_lst.size());
+		for (int idx : idx_lst)
+		{
+			pkts.push_back(recv_packs_[idx]);
+			recv_packs_[idx].reset();
+		}
+
+		return true;
+	}
+
+	void receiver_video_h265::check_for_drop()
+	{
+		if (begin_seq_ < 0 || end_seq_ < 0 || sn::ahead_of<uint16_t>(begin_seq_, end_seq_))
+		{
+			return;
+		}
+		if (!is_timeout())
+		{
+			return;
+		}
+
+		uint16_t i = begin_seq_;
+		while (!sn::ahead_of<uint16_t>(i, end_seq_))
+		{
+			int idx = i % PACKET_BUFFER_SIZE;
+			i++;
+
+			auto pkt = recv_packs_[idx];
+			if (!pkt)
+			{
+				continue;
+			}
+
+			if (pkt->payload_size() >= 2)
+			{
+				const uint8_t* payload = pkt->payload();
+				h265_nal_header_t ph = {};
+				h265_nal_header_set(&ph, payload);
+				uint8_t t = ph.t;
+				if (ph.t == H265_NAL_FU && pkt->payload_size() >= 3)
+				{
+					h265_fu_header_t fuh = {};
+					h265_fu_header_set(&fuh, payload[2]);
+					t = fuh.t;
+				}
+
+				if (!h265_nal_is_non_reference(t))
+				{
+					waiting_for_keyframe_ = true;
+				}
+			}
+
+			LOGD("drop packet %d\n",idx);
+			recv_packs_[idx].reset();
+
+			if (pkt->handle_->header->m==1)
+			{
+				//new start
+				frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+				break;
+			}
+		}
+
+		begin_seq_ = i;
+	}
+
+	void receiver_video_h265::output_nal(uint32_t ts, const uint8_t* nal, int nal_size)
+	{
+		std::string frame_data;
+		frame_data.reserve(nal_size + 4);
+		frame_data.append(3, 0);
+		frame_data.append(1, 1);
+		frame_data.append((const char*)nal, nal_size);
+
+		av_frame_t frame;
+		memset(&frame, 0, sizeof(frame));
+		frame.ct = codec_type_h265;
+		frame.mt = media_type_video;
+		frame.pts = ts;
+		frame.dts = frame.pts;
+		frame.data = (uint8_t*)frame_data.data();
+		frame.data_size = frame_data.size();
+
+		h265_nal_header_t nalh = {};
+		h265_nal_header_set(&nalh, nal);
+		if (h265_nal_is_keyframe(nalh.t))
+		{
+			waiting_for_keyframe_ = false;
+		}
+
+		if (!waiting_for_keyframe_)
+		{
+			rtp_frame_event_.invoke(ssrc_, format_, frame);
+			stats_.frames_received++;
+		}
+		else
+		{
+			stats_.frames_droped++;
+		}
+	}
+
+	bool receiver_video_h265::combin_frame(const std::vector<packet_ptr>& pkts)
+	{
+		if (pkts.size() <= 0) {
+			return false;
+		}
+
+		packet_ptr first_pkt;
+		std::string fu_frame_data;
+		
+		for (auto pkt : pkts)
+		{
+			const uint8_t* payload = pkt->payload();
+			int payload_size = pkt->payload_size();
+
+			if (payload_size < 2)
+			{
+				continue;
+			}
+
+			h265_nal_header_t ph = {};
+			h265_nal_header_set(&ph, payload);
+			if (ph.f != 0)
+			{
+				continue;
+			}
+
+			if (ph.t < H265_NAL_AP)
+			{
+				output_nal(pkt->handle_->header->ts, payload, payload_size);
+			}
+			else if (ph.t == H265_NAL_AP)
+			{
+				// sprop-max-don-diff is not used, so there is no DONL/DOND field.
+				const uint8_t* buf = payload + 2; //skip payload header
+				int size = payload_size - 2;
+				while (size >= 2)
+				{
+					uint16_t nal_size = buf[0] << 8 | buf[1];
+					if (nal_size < 2 || nal_size + 2 > size)
+					{
+						break;
+					}
+					output_nal(pkt->handle_->header->ts, buf + 2, nal_size);
+					buf += nal_size + 2;
+					size -= nal_size + 2;
+				}
+			}
+			else if (ph.t == H265_NAL_FU)
+			{
+				if (payload_size < 3)
+				{
+					continue;
+				}
+
+				h265_fu_header_t fuh = {};
+				h265_fu_header_set(&fuh, payload[2]);
+
+				if (fuh.s == 1)
+				{
+					first_pkt = pkt;
+
+					fu_frame_data.clear();
+					fu_frame_data.reserve(MAX_RTP_PAYLOAD_SIZE * pkts.size() + 2);
+
+					h265_nal_header_t nalh = ph;
+					nalh.t = fuh.t;
+					uint8_t nalhv[2];
+					h265_nal_header_get(&nalh, nalhv);
+					fu_frame_data.append((const char*)nalhv, 2);
+				}
+				if (!first_pkt)
+				{
+					continue;
+				}
+
+				fu_frame_data.append((const char*)payload + 3, payload_size - 3); //skip payload header and fu header
+
+				if (fuh.e == 1)
+				{
+					output_nal(first_pkt->handle_->header->ts, (const uint8_t*)fu_frame_data.data(), (int)fu_frame_data.size());
+					fu_frame_data.clear();
+					first_pkt.reset();
+				}
+			}
+			else
+			{
+				// PACI and reserved types are not supported.
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+}
@@ -48,6 +48,33 @@ namespace litertp
 	}
 
 
+	bool receiver_video_vp8::is_keyframe(packet_ptr pkt)
+	{
+		return is_keyframe(pkt->payload(), (int)pkt->payload_size());
+	}
+
+	bool receiver_video_vp8::is_keyframe(const uint8_t* payload, int payload_size)
+	{
+		vp8_header h = { 0 };
+		int hsize = 0;
+		if (vp8_header_deserialize(&h, &hsize, payload, payload_size) < 0)
+		{
+			return false;
+		}
+		return h.startof_vp8_partition == 1 && h.part_index == 0 && h.p == 0;
+	}
+
+	int receiver_video_vp8::temporal_layer(const uint8_t* payload, int payload_size)
+	{
+		vp8_header h = { 0 };
+		int hsize = 0;
+		if (vp8_header_deserialize(&h, &hsize, payload, payload_size) < 0 || !h.tid_present)
+		{
+			return -1;
+		}
+		return h.tid;
+	}
+
 	bool receiver_video_vp8::find_a_frame(std::vector<packet_ptr>& pkts)
 	{
 		pkts.clear();
@@ -23,6 +23,10 @@ namespace litertp
 		virtual ~receiver_video_vp8();
 
 		virtual bool insert_packet(packet_ptr pkt);
+		virtual bool is_keyframe(packet_ptr pkt);
+		static bool is_keyframe(const uint8_t* payload, int payload_size);
+		//Temporal layer id in the payload descriptor, -1 if not present.
+		static int temporal_layer(const uint8_t* payload, int payload_size);
 	private:
 		bool find_a_frame(std::vector<packet_ptr>& pkts);
 
@@ -0,0 +1,274 @@
+/**
+ * @file receiver_video_vp9.cpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "receiver_video_vp9.h"
+
+#include "../litertp_def.h"
+#include "../util/sn.hpp"
+#include "../vpx/vpx_header.h"
+#include "../log.h"
+
+#include <string.h>
+
+namespace litertp
+{
+	receiver_video_vp9::receiver_video_vp9(int ssrc, media_type_t mt, const sdp_format& fmt)
+		:receiver(ssrc,mt, fmt)
+	{
+	}
+
+	receiver_video_vp9::~receiver_video_vp9()
+	{
+	}
+
+	bool receiver_video_vp9::insert_packet(packet_ptr pkt)
+	{
+		std::unique_lock<std::shared_mutex>lk(mutex_);
+		if (!receiver::insert_packet(pkt))
+		{
+			return false;
+		}
+
+		std::vector<packet_ptr> frame;
+		while (find_a_frame(frame))
+		{
+			// A completed nal
+			frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+			combin_frame(frame);
+		}
+		check_for_drop();
+
+		
+
+		return true;
+	}
+
+
+	bool receiver_video_vp9::is_keyframe(packet_ptr pkt)
+	{
+		return is_keyframe(pkt->payload(), (int)pkt->payload_size());
+	}
+
+	bool receiver_video_vp9::is_keyframe(const uint8_t* payload, int payload_size)
+	{
+		vp9_header h;
+		int hsize = 0;
+		if (vp9_header_deserialize(&h, &hsize, payload, payload_size) < 0)
+		{
+			return false;
+		}
+		return h.start_of_frame && !h.inter_picture && h.sid == 0;
+	}
+
+	int receiver_video_vp9::temporal_layer(const uint8_t* payload, int payload_size)
+	{
+		vp9_header h;
+		int hsize = 0;
+		if (vp9_header_deserialize(&h, &hsize, payload, payload_size) < 0 || !h.layer_idx_present)
+		{
+			return -1;
+		}
+		return h.tid;
+	}
+
+	bool receiver_video_vp9::find_a_frame(std::vector<packet_ptr>& pkts)
+	{
+		pkts.clear();
+		if (begin_seq_ < 0 || end_seq_ < 0|| sn::ahead_of<uint16_t>(begin_seq_, end_seq_))
+		{
+			return false;
+		}
+
+		
+
+		std::vector<int> idx_lst;
+		uint16_t i = begin_seq_;
+		bool detected = false;
+		while (!sn::ahead_of<uint16_t>(i, end_seq_))
+		{
+			int pos = i % PACKET_BUFFER_SIZE;
+			i++;
+			auto pkt = recv_packs_[pos];
+			if (pkt == nullptr)
+			{
+				return false;
+			}
+
+			idx_lst.push_back(pos);
+
+			if (pkt->handle_->header->m==1)
+			{
+				detected = true;
+				break;
+			}
+		}
+
+		if (!detected||idx_lst.size() == 0)
+		{
+			return false;
+		}
+
+		begin_seq_ = i;
+		frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+
+		pkts.reserve(idx_lst.size());
+		for (int idx : idx_lst)
+		{
+			pkts.push_back(recv_packs_[idx]);
+			recv_packs_[idx].reset();
+		}
+
+		return true;
+	}
+
+	void receiver_video_vp9::check_for_drop()
+	{
+		if (begin_seq_ < 0 || end_seq_ < 0 || sn::ahead_of<uint16_t>(begin_seq_, end_seq_))
+		{
+			return;
+		}
+		if (!is_timeout())
+		{
+			return;
+		}
+
+		uint16_t i = begin_seq_;
+		while (!sn::ahead_of<uint16_t>(i, end_seq_))
+		{
+			int idx = i % PACKET_BUFFER_SIZE;
+			i++;
+			auto pkt = recv_packs_[idx];
+			if (!pkt)
+			{
+				continue;
+			}
+			LOGD("drop packet %d\n", idx);
+			recv_packs_[idx].reset();
+
+			// The descriptor does not tell whether later pictures reference it.
+			waiting_for_keyframe_ = true;
+
+			if (pkt->handle_->header->m==1)
+			{
+				//new start
+				frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+				break;
+			}
+		}
+
+		begin_seq_ = i;
+		frame_begin_ts_ = std::chrono::high_resolution_clock::now();
+	}
+
+	//https://datatracker.ietf.org/doc/html/rfc9628#section-4.2
+	bool receiver_video_vp9::combin_frame(const std::vector<packet_ptr>& pkts)
+	{
+		if (pkts.size() <= 0) {
+			return false;
+		}
+
+		packet_ptr first_pkt;
+		bool keyframe = false;
+
+		// Spatial layer frames of this picture, merged into a superframe.
+		std::string frame_data;
+		frame_data.reserve(pkts.size() * MAX_RTP_PAYLOAD_SIZE + 34);
+		int layer_sizes[VP9_MAX_SPATIAL_LAYERS] = { 0 };
+		int layers = 0;
+		int layer_begin = -1;
+
+		for (auto pkt : pkts)
+		{
+			const uint8_t* payload = pkt->payload();
+			int payload_size = pkt->payload_size();
+
+			vp9_header h;
+			int header_size = 0;
+			if (vp9_header_deserialize(&h, &header_size, payload, payload_size) < 0)
+			{
+				continue;
+			}
+
+			if (h.start_of_frame)
+			{
+				if (layer_begin >= 0)
+				{
+					//previous layer frame is not ended.
+					frame_data.resize(layer_begin);
+				}
+				if (layers >= VP9_MAX_SPATIAL_LAYERS)
+				{
+					break;
+				}
+				layer_begin = (int)frame_data.size();
+				if (!first_pkt)
+				{
+					first_pkt = pkt;
+					keyframe = !h.inter_picture && h.sid == 0;
+				}
+			}
+			if (layer_begin < 0)
+			{
+				continue;
+			}
+
+			frame_data.append((const char*)payload + header_size, payload_size - header_size);
+
+			if (h.end_of_frame)
+			{
+				layer_sizes[layers++] = (int)frame_data.size() - layer_begin;
+				layer_begin = -1;
+			}
+		}
+
+		if (layer_begin >= 0)
+		{
+			frame_data.resize(layer_begin);
+		}
+
+		if (!first_pkt || layers == 0)
+		{
+			return false;
+		}
+
+		if (layers > 1)
+		{
+			uint8_t index[34];
+			int index_size = vp9_superframe_index(layer_sizes, layers, index);
+			frame_data.append((const char*)index, index_size);
+		}
+
+		if (keyframe)
+		{
+			waiting_for_keyframe_ = false;
+		}
+
+		av_frame_t frame;
+		memset(&frame, 0, sizeof(frame));
+		frame.ct = codec_type_vp9;
+		frame.mt = media_type_video;
+		frame.pts = first_pkt->handle_->header->ts;
+		frame.dts = frame.pts;
+		frame.data = (uint8_t*)frame_data.data();
+		frame.data_size = frame_data.size();
+
+		if (!waiting_for_keyframe_)
+		{
+			rtp_frame_event_.invoke(ssrc_, format_, frame);
+			stats_.frames_received++;
+		}
+		else
+		{
+			stats_.frames_droped++;
+		}
+
+		return true;
+	}
+
+
+
+}
@@ -0,0 +1,38 @@
+/**
+ * @file receiver_video_vp9.h
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#pragma once
+
+#include "receiver.h"
+
+
+
+namespace litertp
+{
+
+	class receiver_video_vp9 :public receiver
+	{
+	public:
+		receiver_video_vp9(int ssrc, media_type_t mt, const sdp_format& fmt);
+		virtual ~receiver_video_vp9();
+
+		virtual bool insert_packet(packet_ptr pkt);
+		virtual bool is_keyframe(packet_ptr pkt);
+		static bool is_keyframe(const uint8_t* payload, int payload_size);
+		//Temporal layer id in the payload descriptor, -1 if not present.
+		static int temporal_layer(const uint8_t* payload, int payload_size);
+	private:
+		bool find_a_frame(std::vector<packet_ptr>& pkts);
+
+		//check and drop the broken frame;
+		void check_for_drop();
+
+		bool combin_frame(const std::vector<packet_ptr>& pkts);
+	};
+
+
+}
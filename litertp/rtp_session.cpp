@@ -7,6 +7,7 @@
 
 #include "rtp_session.h"
 #include <sys2/util.h>
+#include <algorithm>
 
 namespace litertp
 {
@@ -49,13 +50,13 @@ namespace litertp
 
 
 
-	media_stream_ptr rtp_session::create_media_stream(media_type_t mt, uint32_t ssrc, const char* local_address, int local_rtp_port, int local_rtcp_port)
+	media_stream_ptr rtp_session::create_media_stream(media_type_t mt, uint32_t ssrc, const char* local_address, int local_rtp_port, int local_rtcp_port, const std::string& mid)
 	{
 		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
-		auto itr = streams_.find(mt);
-		if (itr != streams_.end())
+		auto m = find_media_stream(mt, mid);
+		if (m)
 		{
-			return itr->second;
+			return m;
 		}
 
 		auto tp = create_udp_transport(local_rtp_port);
@@ -70,27 +71,16 @@ namespace litertp
 			return nullptr;
 		}
 
-		std::string mid = std::to_string((int)mt);
-		media_stream_ptr m = std::make_shared<media_stream>(mt, ssrc, mid, cname_,ice_options_, ice_ufrag_, ice_pwd_, local_address, tp, tp2);
-		
-		m->litertp_on_frame_.add(s_litertp_on_frame, this);
-		m->litertp_on_keyframe_required_.add(s_litertp_on_keyframe_required, this);
-		m->litertp_on_rtcp_app_.add(s_litertp_on_rtcp_app, this);
-		m->litertp_on_rtcp_bye_.add(s_litertp_on_rtcp_bye, this);
-		m->litertp_on_rtcp_report_.add(s_litertp_on_rtcp_report, this);
-
-		streams_.insert(std::make_pair(mt, m));
-
-		return m;
+		return add_media_stream(mt, ssrc, mid, local_address, tp, tp2, false);
 	}
 
-	media_stream_ptr rtp_session::create_media_stream(media_type_t mt, uint32_t ssrc, int port, litertp_on_send_packet on_send_packet, void* ctx)
+	media_stream_ptr rtp_session::create_media_stream(media_type_t mt, uint32_t ssrc, int port, litertp_on_send_packet on_send_packet, void* ctx, const std::string& mid)
 	{
 		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
-		auto itr = streams_.find(mt);
-		if (itr != streams_.end())
+		auto m = find_media_stream(mt, mid);
+		if (m)
 		{
-			return itr->second;
+			return m;
 		}
 
 		auto tp = create_custom_transport(port, on_send_packet, ctx);
@@ -99,24 +89,104 @@ namespace litertp
 			return nullptr;
 		}
 		
+		return add_media_stream(mt, ssrc, mid, "0.0.0.0", tp, tp, true);
+	}
 
-		std::string mid = std::to_string((int)mt);
-		media_stream_ptr m = std::make_shared<media_stream>(mt, ssrc, mid, cname_,ice_options_, ice_ufrag_, ice_pwd_,"0.0.0.0", tp, tp,true);
+	media_stream_ptr rtp_session::create_bundled_media_stream(media_type_t mt, uint32_t ssrc, const std::string& mid)
+	{
+		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
+		if (streams_.empty())
+		{
+			return nullptr;
+		}
+		auto m = find_media_stream(mt, mid);
+		if (m)
+		{
+			return m;
+		}
+
+		// One transport, one ice and dtls session for all streams of the group.
+		auto first = streams_[0];
+		auto sdpm = first->local_sdp();
+		bool is_tcp = sdpm->protos_.find("TCP") != sdpm->protos_.end();
+		m = add_media_stream(mt, ssrc, mid, sdpm->rtp_address_, first->transport_rtp_, first->transport_rtcp_, is_tcp);
+		if (m && !sdpm->fingerprint_.empty())
+		{
+			m->enable_dtls();
+		}
+		return m;
+	}
+
+	media_stream_ptr rtp_session::add_media_stream(media_type_t mt, uint32_t ssrc, const std::string& mid, const std::string& local_address,
+		transport_ptr transport_rtp, transport_ptr transport_rtcp, bool is_tcp)
+	{
+		std::string m_mid = mid.empty() ? make_mid(mt) : mid;
+		if (mids_.find(m_mid) != mids_.end())
+		{
+			// The mid is taken by a stream of another media type.
+			return nullptr;
+		}
+		media_stream_ptr m = std::make_shared<media_stream>(mt, ssrc, m_mid, cname_,ice_options_, ice_ufrag_, ice_pwd_, local_address, transport_rtp, transport_rtcp, is_tcp);
+		
 		m->litertp_on_frame_.add(s_litertp_on_frame, this);
 		m->litertp_on_keyframe_required_.add(s_litertp_on_keyframe_required, this);
 		m->litertp_on_rtcp_app_.add(s_litertp_on_rtcp_app, this);
 		m->litertp_on_rtcp_bye_.add(s_litertp_on_rtcp_bye, this);
 		m->litertp_on_rtcp_report_.add(s_litertp_on_rtcp_report, this);
-		streams_.insert(std::make_pair(mt, m));
+		m->litertp_on_consent_expired_.add(s_litertp_on_consent_expired, this);
+		m->set_ice_lite(ice_lite_);
+
+		streams_.push_back(m);
+		mids_.insert(std::make_pair(m_mid, m));
 
 		return m;
 	}
 
+	media_stream_ptr rtp_session::find_media_stream(media_type_t mt, const std::string& mid)
+	{
+		if (mid.empty())
+		{
+			for (auto& m : streams_)
+			{
+				if (m->media_type() == mt)
+				{
+					return m;
+				}
+			}
+			return nullptr;
+		}
+
+		auto itr = mids_.find(mid);
+		if (itr == mids_.end() || itr->second->media_type() != mt)
+		{
+			return nullptr;
+		}
+		return itr->second;
+	}
+
+	std::string rtp_session::make_mid(media_type_t mt)
+	{
+		// The first stream of a type keeps the mid used before, as peers may have stored it.
+		int n = (int)mt;
+		std::string mid = std::to_string(n);
+		while (mids_.find(mid) != mids_.end())
+		{
+			mid = std::to_string(++n);
+		}
+		return mid;
+	}
+
 	media_stream_ptr rtp_session::get_media_stream(media_type_t mt)
 	{
 		std::shared_lock<std::shared_mutex>lk(streams_mutex_);
-		auto itr = streams_.find(mt);
-		if (itr == streams_.end())
+		return find_media_stream(mt, "");
+	}
+
+	media_stream_ptr rtp_session::get_media_stream(const std::string& mid)
+	{
+		std::shared_lock<std::shared_mutex>lk(streams_mutex_);
+		auto itr = mids_.find(mid);
+		if (itr == mids_.end())
 		{
 			return nullptr;
 		}
@@ -124,31 +194,58 @@ namespace litertp
 		return itr->second;
 	}
 
-	std::vector<media_stream_ptr> rtp_session::get_media_streams()
+	media_stream_ptr rtp_session::get_media_stream_by_ssrc(uint32_t ssrc)
 	{
-		std::vector<media_stream_ptr> vec;
-		std::shared_lock<std::shared_mutex> lk(streams_mutex_);
-		if (streams_.size() > 0)
+		auto ms = get_media_streams();
+		for (auto& m : ms)
 		{
-			vec.reserve(streams_.size());
-			for (auto stream : streams_)
+			if (m->has_remote_ssrc(ssrc) || m->get_local_ssrc() == ssrc)
 			{
-				vec.push_back(stream.second);
+				return m;
 			}
 		}
-		return vec;
+		return nullptr;
+	}
+
+	std::vector<media_stream_ptr> rtp_session::get_media_streams()
+	{
+		std::shared_lock<std::shared_mutex> lk(streams_mutex_);
+		return streams_;
 	}
 
 	void rtp_session::remove_media_stream(media_type_t mt)
 	{
 		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
-		streams_.erase(mt);
+		auto itr = std::find_if(streams_.begin(), streams_.end(), [mt](const media_stream_ptr& m) {
+			return m->media_type() == mt;
+			});
+		if (itr == streams_.end())
+		{
+			return;
+		}
+		mids_.erase((*itr)->mid());
+		streams_.erase(itr);
+		release_unused_transports();
+	}
+
+	void rtp_session::remove_media_stream(const std::string& mid)
+	{
+		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
+		auto itr = mids_.find(mid);
+		if (itr == mids_.end())
+		{
+			return;
+		}
+		streams_.erase(std::find(streams_.begin(), streams_.end(), itr->second));
+		mids_.erase(itr);
+		release_unused_transports();
 	}
 
 	void rtp_session::clear_media_streams()
 	{
 		std::unique_lock<std::shared_mutex>lk(streams_mutex_);
 		streams_.clear();
+		mids_.clear();
 	}
 
 
@@ -198,12 +295,12 @@ namespace litertp
 			sdp.attrs_.push_back(sdp_pair("msid-semantic", "WMS", ":"));
 		}
 		sdp.bundle_ = local_group_bundle();
+		sdp.ice_lite_ = webrtc_ && ice_lite_;
 		auto streams=get_media_streams();
 		for (auto stream : streams)
 		{
 			stream->set_sdp_type(sdp_type_offer);
-			auto sdpm = stream->get_local_sdp();
-			sdp.medias_.push_back(sdpm);
+			sdp.medias_.push_back(*stream->local_sdp());
 		}
 
 		return sdp.to_string();
@@ -217,6 +314,7 @@ namespace litertp
 			sdp.attrs_.push_back(sdp_pair("msid-semantic", "WMS", ":"));
 		}
 		sdp.bundle_ = local_group_bundle();
+		sdp.ice_lite_ = webrtc_ && ice_lite_;
 		auto streams = get_media_streams();
 		for (auto stream : streams)
 		{
@@ -248,6 +346,7 @@ namespace litertp
 			sdpm_remote.trans_mode_ = sdpm_local.trans_mode_;
 			sdpm_remote.ssrcs_ = sdpm_local.ssrcs_;
 			sdpm_remote.ssrc_group_ = sdpm_local.ssrc_group_;
+			sdpm_remote.reverse_simulcast();
 
 			sdp.medias_.push_back(sdpm_remote);
 		}
@@ -264,12 +363,43 @@ namespace litertp
 			return false;
 		}
 
-		for (auto& m : sdpo.medias_)
+		// m-lines are matched by mid, or else by media type in order.
+		auto streams = get_media_streams();
+		std::vector<media_stream_ptr> matched(sdpo.medias_.size());
+		for (size_t i = 0; i < sdpo.medias_.size(); i++)
+		{
+			auto& m = sdpo.medias_[i];
+			auto itr = std::find_if(streams.begin(), streams.end(), [&m](const media_stream_ptr& s) {
+				return !m.mid_.empty() && s->mid() == m.mid_ && s->media_type() == m.media_type_;
+			});
+			if (itr != streams.end())
+			{
+				matched[i] = *itr;
+				streams.erase(itr);
+			}
+		}
+		for (size_t i = 0; i < sdpo.medias_.size(); i++)
+		{
+			if (matched[i])
+			{
+				continue;
+			}
+			auto& m = sdpo.medias_[i];
+			auto itr = std::find_if(streams.begin(), streams.end(), [&m](const media_stream_ptr& s) {
+				return s->media_type() == m.media_type_;
+			});
+			if (itr != streams.end())
+			{
+				matched[i] = *itr;
+				streams.erase(itr);
+			}
+		}
+
+		for (size_t i = 0; i < sdpo.medias_.size(); i++)
 		{
-			auto s=get_media_stream(m.media_type_);
-			if (s)
+			if (matched[i])
 			{
-				if (!s->set_remote_sdp(m, sdp_type))
+				if (!matched[i]->set_remote_sdp(sdpo.medias_[i], sdp_type))
 				{
 					return false;
 				}
@@ -292,7 +422,7 @@ namespace litertp
 
 		for (auto& m : s.medias_)
 		{
-			auto s = create_media_stream(m.media_type_,m.get_default_ssrc(), m.rtp_address_.c_str(), m.rtp_port_, m.rtcp_port_);
+			auto s = create_media_stream(m.media_type_,m.get_default_ssrc(), m.rtp_address_.c_str(), m.rtp_port_, m.rtcp_port_, m.mid_);
 			if (!s)
 			{
 				clear_transports();
@@ -320,6 +450,17 @@ namespace litertp
 	}
 
 
+	void rtp_session::set_ice_lite(bool enabled)
+	{
+		ice_lite_ = enabled;
+		auto streams = get_media_streams();
+		for (auto stream : streams)
+		{
+			stream->set_ice_lite(enabled);
+		}
+	}
+
+
 	transport_ptr rtp_session::create_udp_transport(int port)
 	{
 		std::unique_lock<std::shared_mutex>lk(transports_mutex_);
@@ -342,7 +483,7 @@ namespace litertp
 		}
 
 		tp->ice_ufrag_local_ = this->ice_ufrag_;
-		tp->ice_pwd_local_ = this->ice_pwd_;
+		tp->set_ice_pwd_local(this->ice_pwd_);
 
 		transports_.insert(std::make_pair(port, tp));
 		return tp;
@@ -398,6 +539,31 @@ namespace litertp
 		transports_.clear();
 	}
 
+	void rtp_session::release_unused_transports()
+	{
+		std::unique_lock<std::shared_mutex>lk(transports_mutex_);
+		for (auto itr = transports_.begin(); itr != transports_.end();)
+		{
+			bool used = false;
+			for (auto& m : streams_)
+			{
+				if (m->transport_rtp_ == itr->second || m->transport_rtcp_ == itr->second)
+				{
+					used = true;
+					break;
+				}
+			}
+			if (used)
+			{
+				itr++;
+			}
+			else
+			{
+				itr = transports_.erase(itr);
+			}
+		}
+	}
+
 
 
 	void rtp_session::s_litertp_on_frame(void* ctx, uint32_t ssrc, uint16_t pt, int frequency, int channels, const av_frame_t* frame)
@@ -431,14 +597,24 @@ namespace litertp
 		p->litertp_on_rtcp_report_.invoke(ssrc);
 	}
 
+	void rtp_session::s_litertp_on_consent_expired(void* ctx, const char* mid)
+	{
+		rtp_session* p = (rtp_session*)ctx;
+		p->litertp_on_consent_expired_.invoke(mid);
+	}
+
 	void rtp_session::run()
 	{
 		while (active_)
 		{
-			auto ms = get_media_streams();
-			for (auto m : ms)
 			{
-				m->run_rtcp_stats();
+				// Streams removed by the callbacks, and their ports, are released before waiting.
+				auto ms = get_media_streams();
+				for (auto m : ms)
+				{
+					m->run_rtcp_stats();
+					m->check_consent();
+				}
 			}
 
 			signal_.wait(5000);
@@ -453,11 +629,11 @@ namespace litertp
 		{
 			return false;
 		}
-		auto sdpm_begin = (*itr_begin)->get_local_sdp();
+		auto sdpm_begin = (*itr_begin)->local_sdp();
 		for (auto itr = ms.begin(); itr != ms.end(); itr++)
 		{
-			auto sdpm = (*itr)->get_local_sdp();
-			if (sdpm_begin.rtp_port_ != sdpm.rtp_port_)
+			auto sdpm = (*itr)->local_sdp();
+			if (sdpm_begin->rtp_port_ != sdpm->rtp_port_)
 			{
 				return false;
 			}
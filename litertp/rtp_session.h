@@ -20,12 +20,21 @@ namespace litertp
 		bool start();
 		void stop();
 
-		media_stream_ptr create_media_stream(media_type_t mt, uint32_t ssrc, const char* local_address, int local_rtp_port, int local_rtcp_port);
-		media_stream_ptr create_media_stream(media_type_t mt, uint32_t ssrc,int port,litertp_on_send_packet on_send_packet,void* ctx);
-
+		//Streams are keyed by mid, an empty mid returns the first stream of mt if there is one,
+		//or creates it with a generated mid. Streams on the same port share the transport.
+		media_stream_ptr create_media_stream(media_type_t mt, uint32_t ssrc, const char* local_address, int local_rtp_port, int local_rtcp_port, const std::string& mid = "");
+		media_stream_ptr create_media_stream(media_type_t mt, uint32_t ssrc,int port,litertp_on_send_packet on_send_packet,void* ctx, const std::string& mid = "");
+		//Add a stream to the BUNDLE group, it shares the transports of the first stream.
+		media_stream_ptr create_bundled_media_stream(media_type_t mt, uint32_t ssrc, const std::string& mid = "");
+
+		//The first stream of mt.
 		media_stream_ptr get_media_stream(media_type_t mt);
+		media_stream_ptr get_media_stream(const std::string& mid);
+		media_stream_ptr get_media_stream_by_ssrc(uint32_t ssrc);
 		std::vector<media_stream_ptr> get_media_streams();
+		//Remove the first stream of mt, the one get_media_stream(mt) returns.
 		void remove_media_stream(media_type_t mt);
+		void remove_media_stream(const std::string& mid);
 		void clear_media_streams();
 		void clear_local_candidates();
 		void clear_remote_candidates();
@@ -41,6 +50,10 @@ namespace litertp
 
 		void require_keyframe();
 
+		//ICE-lite for a server on a public address, a=ice-lite is put in the offer and answer,
+		//binding requests are only answered and paths without consent are dropped.
+		void set_ice_lite(bool enabled);
+
 
 	private:
 		transport_ptr create_udp_transport(int port);
@@ -48,6 +61,8 @@ namespace litertp
 		transport_ptr get_transport(int port);
 		void remote_transport(int port);
 		void clear_transports();
+		//Release the transports no stream uses any more, streams_mutex_ must be locked.
+		void release_unused_transports();
 
 
 
@@ -56,15 +71,22 @@ namespace litertp
 		static void s_litertp_on_rtcp_bye(void* ctx, uint32_t* ssrcs, int ssrc_count, const char* message);
 		static void s_litertp_on_rtcp_app(void* ctx, uint32_t ssrc, uint32_t name, const char* appdata, uint32_t data_size);
 		static void s_litertp_on_rtcp_report(void* ctx, uint32_t ssrc);
+		static void s_litertp_on_consent_expired(void* ctx, const char* mid);
 		void run();
 
 		bool local_group_bundle();
+
+		media_stream_ptr add_media_stream(media_type_t mt, uint32_t ssrc, const std::string& mid, const std::string& local_address,
+			transport_ptr transport_rtp, transport_ptr transport_rtcp, bool is_tcp);
+		media_stream_ptr find_media_stream(media_type_t mt, const std::string& mid);
+		std::string make_mid(media_type_t mt);
 	public:
 		sys::callback<litertp_on_frame> litertp_on_frame_;
 		sys::callback<litertp_on_keyframe_required> litertp_on_keyframe_required_;
 		sys::callback<litertp_on_rtcp_app> litertp_on_rtcp_app_;
 		sys::callback<litertp_on_rtcp_bye> litertp_on_rtcp_bye_;
 		sys::callback<litertp_on_rtcp_report> litertp_on_rtcp_report_;
+		sys::callback<litertp_on_consent_expired> litertp_on_consent_expired_;
 	private:
 		bool active_ = true;
 		
@@ -76,9 +98,12 @@ namespace litertp
 		std::string ice_ufrag_;
 		std::string ice_pwd_;
 		std::string ice_options_;
+		std::atomic<bool> ice_lite_{ false };
 		
 		std::shared_mutex streams_mutex_;
-		std::map<media_type_t,media_stream_ptr> streams_;
+		//In the order of m-lines.
+		std::vector<media_stream_ptr> streams_;
+		std::map<std::string, media_stream_ptr> mids_;
 		
 
 		std::shared_mutex transports_mutex_;
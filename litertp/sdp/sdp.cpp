@@ -59,6 +59,11 @@ namespace litertp {
 			ss << "a=" << attr.to_string() << std::endl;
 		}
 
+		if (ice_lite_)
+		{
+			ss << "a=ice-lite" << std::endl;
+		}
+
 		if (bundle_)
 		{
 			ss << "a=group:BUNDLE";
@@ -90,6 +95,7 @@ namespace litertp {
 		attrs_.clear();
 		medias_.clear();
 		c_.clear();
+		ice_lite_ = false;
 		
 		for (auto line : lines)
 		{
@@ -130,6 +136,10 @@ namespace litertp {
 				{
 					iter->parse_a(val);
 				}
+				else if (val == "ice-lite")
+				{
+					ice_lite_ = true;
+				}
 				else
 				{
 					sdp_pair attr(":");
@@ -36,6 +36,8 @@ namespace litertp {
 
 		
 		bool bundle_ = false;
+		//a=ice-lite, the agent only answers connectivity checks.
+		bool ice_lite_ = false;
 
 		std::vector<sdp_media> medias_;
 		std::vector<sdp_pair> attrs_;
@@ -107,6 +107,10 @@ namespace litertp
 		{
 			return codec_type_h264;
 		}
+		else if (sys::string_util::icasecompare(codec, "H265"))
+		{
+			return codec_type_h265;
+		}
 		else if (sys::string_util::icasecompare(codec, "VP8"))
 		{
 			return codec_type_vp8;
@@ -183,6 +187,10 @@ namespace litertp
 		{
 			return "H264";
 		}
+		else if (codec== codec_type_h265)
+		{
+			return "H265";
+		}
 		else if (codec== codec_type_vp8)
 		{
 			return "VP8";
@@ -246,6 +246,46 @@ namespace litertp {
 				}
 			}
 		}
+		else if (attr.key_ == "rid")
+		{
+			std::vector<std::string> ss = sys::string_util::split(attr.val_, " ", 3);
+			if (ss.size() >= 2)
+			{
+				rid_t rid;
+				rid.id = ss[0];
+				rid.send = ss[1] == "send";
+				if (ss.size() >= 3)
+				{
+					rid.params = ss[2];
+				}
+				rids_.push_back(rid);
+			}
+		}
+		else if (attr.key_ == "simulcast")
+		{
+			simulcast_send_.clear();
+			simulcast_recv_.clear();
+			std::vector<std::string> ss = sys::string_util::split(attr.val_, " ");
+			for (size_t i = 0; i + 1 < ss.size(); i += 2)
+			{
+				auto& lst = ss[i] == "send" ? simulcast_send_ : simulcast_recv_;
+				std::vector<std::string> streams = sys::string_util::split(ss[i + 1], ";");
+				for (auto& stream : streams)
+				{
+					//Only the first of alternatives is used, a paused stream is still listed.
+					std::vector<std::string> alts = sys::string_util::split(stream, ",");
+					if (alts.size() > 0)
+					{
+						std::string id = alts[0];
+						if (id.find('~') == 0)
+						{
+							id.erase(0, 1);
+						}
+						lst.push_back(id);
+					}
+				}
+			}
+		}
 		else if (attr.key_ == "ssrc-group")
 		{
 			std::vector<std::string> ss = sys::string_util::split(attr.val_, " ");
@@ -491,6 +531,40 @@ namespace litertp {
 			fmt.second.to_string(ss);
 		}
 
+		for (auto& rid : rids_)
+		{
+			ss << "a=rid:" << rid.id << (rid.send ? " send" : " recv");
+			if (rid.params.size() > 0)
+			{
+				ss << " " << rid.params;
+			}
+			ss << std::endl;
+		}
+
+		if (simulcast_send_.size() > 0 || simulcast_recv_.size() > 0)
+		{
+			ss << "a=simulcast:";
+			const char* sep = "";
+			if (simulcast_send_.size() > 0)
+			{
+				ss << "send ";
+				for (size_t i = 0; i < simulcast_send_.size(); i++)
+				{
+					ss << (i > 0 ? ";" : "") << simulcast_send_[i];
+				}
+				sep = " ";
+			}
+			if (simulcast_recv_.size() > 0)
+			{
+				ss << sep << "recv ";
+				for (size_t i = 0; i < simulcast_recv_.size(); i++)
+				{
+					ss << (i > 0 ? ";" : "") << simulcast_recv_[i];
+				}
+			}
+			ss << std::endl;
+		}
+
 		if (ssrc_group_.size() > 0)
 		{
 			ss << "a=ssrc-group:" << ssrc_group_;
@@ -591,5 +665,41 @@ namespace litertp {
 		}
 		return false;
 	}
-}
 
+	int sdp_media::get_extmap_id(const std::string& uri)const
+	{
+		for (auto& itr : extmap_)
+		{
+			if (itr.second.compare(0, uri.size(), uri) == 0 && (itr.second.size() == uri.size() || itr.second[uri.size()] == ' '))
+			{
+				return itr.first;
+			}
+		}
+		return 0;
+	}
+
+	std::vector<std::string> sdp_media::get_send_rids()const
+	{
+		std::vector<std::string> vec = simulcast_send_;
+		if (vec.empty())
+		{
+			for (auto& rid : rids_)
+			{
+				if (rid.send)
+				{
+					vec.push_back(rid.id);
+				}
+			}
+		}
+		return vec;
+	}
+
+	void sdp_media::reverse_simulcast()
+	{
+		for (auto& rid : rids_)
+		{
+			rid.send = !rid.send;
+		}
+		std::swap(simulcast_send_, simulcast_recv_);
+	}
+}
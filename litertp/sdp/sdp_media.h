@@ -11,6 +11,12 @@
 #include "sdp_format.h"
 #include "candidate.h"
 
+#define SDP_EXTMAP_MID "urn:ietf:params:rtp-hdrext:sdes:mid"
+#define SDP_EXTMAP_RTP_STREAM_ID "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id"
+#define SDP_EXTMAP_REPAIRED_RTP_STREAM_ID "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id"
+#define SDP_EXTMAP_FRAME_MARKING "urn:ietf:params:rtp-hdrext:framemarking"
+#define SDP_EXTMAP_DEPENDENCY_DESCRIPTOR "https://aomediacodec.github.io/av1-rtp-spec/#dependency-descriptor-rtp-header-extension"
+
 namespace litertp {
 
 	struct ssrc_t
@@ -18,6 +24,15 @@ namespace litertp {
 		uint32_t ssrc=0;
 		std::string cname;
 		std::string msid;
+		std::string rid; //simulcast layer of local ssrc, not written to sdp.
+	};
+
+	//a=rid:<id> <send|recv> [restrictions]
+	struct rid_t
+	{
+		std::string id;
+		bool send = true;
+		std::string params;
 	};
 
 	class sdp_media
@@ -37,6 +52,13 @@ namespace litertp {
 		uint32_t get_default_ssrc()const;
 
 		bool has_ssrc(uint32_t ssrc)const;
+
+		//Return the id of extmap uri, 0 if not found.
+		int get_extmap_id(const std::string& uri)const;
+		//rids are sent by this end, in order of a=simulcast.
+		std::vector<std::string> get_send_rids()const;
+		//Swap send and recv of rids and simulcast, used to answer an offer.
+		void reverse_simulcast();
 	private:
 		void to_protocols_string(std::stringstream& ss)const;
 		
@@ -78,6 +100,10 @@ namespace litertp {
 		std::string ssrc_group_;// = "FID";
 		std::vector<ssrc_t> ssrcs_;
 
+		std::vector<rid_t> rids_;
+		std::vector<std::string> simulcast_send_;
+		std::vector<std::string> simulcast_recv_;
+
 		std::vector<sdp_pair> attrs_;
 		std::vector<candidate> candidates_;
 	};
@@ -9,6 +9,7 @@
 #include "sender.h"
 
 #include "../util/time.h"
+#include "../util/sn.hpp"
 #include <sys2/util.h>
 #include <string.h>
 
@@ -29,9 +30,140 @@ namespace litertp
 	{
 	}
 
+	void sender::set_rid(const std::string& rid, uint8_t ext_id)
+	{
+		std::unique_lock<std::shared_mutex>lk(rid_mutex_);
+		rid_ = rid;
+		rid_ext_id_ = rid.empty() ? 0 : ext_id;
+	}
+
+	std::string sender::rid()
+	{
+		std::shared_lock<std::shared_mutex>lk(rid_mutex_);
+		return rid_;
+	}
+
+	void sender::add_rid(packet_ptr pkt)
+	{
+		uint8_t ext_id = rid_ext_id_;
+		if (ext_id == 0)
+		{
+			return;
+		}
+
+		std::shared_lock<std::shared_mutex>lk(rid_mutex_);
+		rtp_header_add_ext_element(pkt->handle_->header, ext_id, (const uint8_t*)rid_.data(), rid_.size());
+	}
+
+	void sender::set_frame_marking(uint8_t ext_id)
+	{
+		frame_marking_ext_id_ = ext_id;
+	}
+
+	void sender::add_frame_marking(packet_ptr pkt)
+	{
+		uint8_t ext_id = frame_marking_ext_id_;
+		if (ext_id == 0)
+		{
+			return;
+		}
+
+		// Called with mutex_ locked by send_frame, so the frame state can be read here.
+		uint8_t v = 0;
+		v |= (frame_start_ ? 1 : 0) << 7;
+		v |= (pkt->handle_->header->m & 0x01) << 6;
+		v |= (frame_keyframe_ ? 1 : 0) << 5;
+		frame_start_ = pkt->handle_->header->m != 0;
+		if (!has_layer_)
+		{
+			// Short form: |S|E|I|D|0 0 0 0|
+			v |= (frame_discardable_ ? 1 : 0) << 4;
+			rtp_header_add_ext_element(pkt->handle_->header, ext_id, &v, 1);
+			return;
+		}
+
+		// Long form: |S|E|I|D|B| TID |   LID   |  TL0PICIDX  |
+		v |= (layer_.non_reference & 0x01) << 4;
+		v |= (layer_.layer_sync & 0x01) << 3;
+		v |= (layer_.tid & 0x07);
+		uint8_t data[3] = { v,0,layer_tl0_pic_idx_ };
+		rtp_header_add_ext_element(pkt->handle_->header, ext_id, data, sizeof(data));
+	}
+
+	bool sender::send_layer_frame(const uint8_t* frame, uint32_t size, uint32_t duration, const temporal_layer_t& layer)
+	{
+		// Layered frames are sent one by one, the layer state lives until send_frame returns.
+		std::unique_lock<std::mutex>lk(layer_mutex_);
+		{
+			std::unique_lock<std::shared_mutex>lk2(mutex_);
+			has_layer_ = true;
+			layer_ = layer;
+			if (layer.tid == 0)
+			{
+				layer_tl0_pic_idx_++;
+			}
+		}
+
+		bool ret = send_frame(frame, size, duration);
+
+		{
+			std::unique_lock<std::shared_mutex>lk2(mutex_);
+			has_layer_ = false;
+		}
+		return ret;
+	}
+
+	bool sender::forward_source_seq(uint16_t seq, uint32_t* src_ssrc, uint16_t* src_seq)
+	{
+		std::shared_lock<std::shared_mutex>lk(mutex_);
+		const forward_seq_t& e = forward_out_seqs_[seq % PACKET_BUFFER_SIZE];
+		if (!e.valid || e.seq != seq)
+		{
+			return false;
+		}
+		*src_ssrc = e.src_ssrc;
+		*src_seq = e.src_seq;
+		return true;
+	}
+
+	void sender::map_forward_seq(uint32_t src_ssrc, uint16_t src_seq, uint16_t seq)
+	{
+		forward_seq_t e;
+		e.valid = true;
+		e.src_ssrc = src_ssrc;
+		e.src_seq = src_seq;
+		e.seq = seq;
+		forward_out_seqs_[seq % PACKET_BUFFER_SIZE] = e;
+		forward_src_seqs_[src_seq % PACKET_BUFFER_SIZE] = e;
+	}
+
+	void sender::set_max_temporal_layer(int tid)
+	{
+		std::unique_lock<std::shared_mutex>lk(mutex_);
+		max_temporal_layer_ = tid < 0 ? 255 : tid;
+	}
+
+	bool sender::send_nals(const uint8_t* const*, const uint32_t*, int, uint32_t)
+	{
+		return false;
+	}
+
 	bool sender::send_packet(packet_ptr pkt)
 	{
-		send_rtp_packet_event_.invoke(pkt);
+		add_rid(pkt);
+		add_frame_marking(pkt);
+
+		// A packetizer that gave up in the middle of a frame leaves packets behind, they go before the next frame.
+		if (!frame_packets_.empty() && frame_packets_.back()->handle_->header->ts != pkt->handle_->header->ts)
+		{
+			flush_packets();
+		}
+		frame_packets_.push_back(pkt);
+		// A video frame is handed over with its last packet.
+		if (pkt->handle_->header->m || media_type_ != media_type_video)
+		{
+			flush_packets();
+		}
 		
 		stats_.packets_sent_period++;
 		stats_.packets_sent++;
@@ -48,6 +180,148 @@ namespace litertp
 		return true;
 	}
 
+	void sender::flush_packets()
+	{
+		if (frame_packets_.empty())
+		{
+			return;
+		}
+		send_rtp_packets_event_.invoke<const std::vector<packet_ptr>&>(frame_packets_);
+		frame_packets_.clear();
+	}
+
+	bool sender::forward_packet(packet_ptr pkt, bool keyframe, int tid)
+	{
+		packet_ptr out;
+		{
+			std::unique_lock<std::shared_mutex>lk(mutex_);
+			double now = time_util::cur_time();
+			uint32_t src_ssrc = pkt->handle_->header->ssrc;
+			uint16_t src_seq = pkt->handle_->header->seq;
+			bool switched = !forwarding_ || src_ssrc != forward_ssrc_;
+			if (switched)
+			{
+				// Switch to the new source only at a keyframe, so the subscriber can decode at once.
+				if (!keyframe)
+				{
+					return false;
+				}
+
+				uint32_t ts = timestamp_;
+				if (forwarding_)
+				{
+					// Keep the timestamp moving forward by the wall clock since the last forwarded packet.
+					uint32_t elapsed = (uint32_t)ms_to_ts((now - forward_time_) * 1000);
+					ts += elapsed > 0 ? elapsed : 1;
+				}
+
+				forwarding_ = true;
+				forward_ssrc_ = src_ssrc;
+				forward_seq_offset_ = seq_ - src_seq;
+				forward_ts_offset_ = ts - pkt->handle_->header->ts;
+				layer_decision_valid_ = false;
+			}
+
+			uint16_t seq = 0;
+			if (switched || sn::ahead_of<uint16_t>(src_seq, forward_src_seq_))
+			{
+				if (!switched)
+				{
+					// Source packets not received yet keep their output seqs, so they can be nacked upstream
+					// and sent there when they arrive late.
+					uint16_t gap = src_seq - forward_src_seq_ - 1;
+					uint16_t first = gap > PACKET_BUFFER_SIZE ? src_seq - PACKET_BUFFER_SIZE : forward_src_seq_ + 1;
+					for (uint16_t s = first; s != src_seq; s++)
+					{
+						map_forward_seq(src_ssrc, s, s + forward_seq_offset_);
+					}
+				}
+				forward_src_seq_ = src_seq;
+
+				if (!forward_layer(pkt, tid))
+				{
+					// Close the seq gap of the dropped packet, so the subscriber does not nack it.
+					forward_seq_offset_--;
+					forward_src_seqs_[src_seq % PACKET_BUFFER_SIZE].valid = false;
+					return false;
+				}
+				seq = src_seq + forward_seq_offset_;
+				map_forward_seq(src_ssrc, src_seq, seq);
+			}
+			else
+			{
+				// A late or retransmitted packet goes out with the seq kept for it, or not at all.
+				const forward_seq_t& e = forward_src_seqs_[src_seq % PACKET_BUFFER_SIZE];
+				if (!e.valid || e.src_ssrc != src_ssrc || e.src_seq != src_seq || !forward_layer(pkt, tid))
+				{
+					return false;
+				}
+				seq = e.seq;
+			}
+			uint32_t ts = pkt->handle_->header->ts + forward_ts_offset_;
+
+			out = std::make_shared<packet>(format_.payload_type_, ssrc_, seq, ts);
+			out->handle_->header->m = pkt->handle_->header->m;
+			// Only the header is rewritten, the payload is shared with the source packet.
+			if (!out->share_payload(pkt))
+			{
+				return false;
+			}
+
+			// Retransmitted or reordered packets must not move seq and timestamp backward.
+			if (!sn::ahead_of<uint16_t>(seq_, seq))
+			{
+				seq_ = seq + 1;
+				timestamp_ = ts;
+				timestamp_now_ = ms_to_ts(now * 1000);
+			}
+			forward_time_ = now;
+
+			stats_.packets_sent_period++;
+			stats_.packets_sent++;
+			stats_.bytes_sent_period += out->payload_size();
+			stats_.bytes_sent += out->payload_size();
+		}
+
+		add_rid(out);
+		send_rtp_packet_event_.invoke(out);
+		set_history(out);
+
+		return true;
+	}
+
+	bool sender::forward_layer(packet_ptr pkt, int tid)
+	{
+		if (tid < 0)
+		{
+			return true;
+		}
+		if (tid > highest_tid_)
+		{
+			highest_tid_ = tid;
+		}
+
+		// All packets of a frame share the decision made at its first packet.
+		uint32_t ts = pkt->handle_->header->ts;
+		if (layer_decision_valid_ && ts == layer_decision_ts_)
+		{
+			return layer_decision_forward_;
+		}
+
+		int limit = max_temporal_layer_ < temporal_layer_cap_ ? max_temporal_layer_ : temporal_layer_cap_;
+		if (tid == 0 || limit < forward_temporal_layer_)
+		{
+			// Lowering takes effect at once, raising waits for a base layer frame,
+			// the frames of upper layers before it may refer to dropped frames.
+			forward_temporal_layer_ = limit;
+		}
+
+		layer_decision_valid_ = true;
+		layer_decision_ts_ = ts;
+		layer_decision_forward_ = tid <= forward_temporal_layer_;
+		return layer_decision_forward_;
+	}
+
 	uint16_t sender::last_rtp_seq()
 	{
 		std::shared_lock<std::shared_mutex>lk(mutex_);
@@ -90,7 +364,13 @@ namespace litertp
 		std::shared_lock<std::shared_mutex> lk(history_packets_mutex_);
 		int idx = seq % PACKET_BUFFER_SIZE;
 
-		return history_packets_[idx];
+		// The slot may hold an older packet when seq itself was never sent.
+		const packet_ptr& pkt = history_packets_[idx];
+		if (pkt && pkt->handle_->header->seq != seq)
+		{
+			return nullptr;
+		}
+		return pkt;
 	}
 
 	void sender::update_remote_report(const rtcp_report& report)
@@ -100,6 +380,27 @@ namespace litertp
 		stats_.lost = report.lost;
 		stats_.lost_period = report.fraction;
 		stats_.jitter = report.jitter;
+
+		if (!forwarding_ || highest_tid_ == 0)
+		{
+			return;
+		}
+
+		// Shed the top temporal layer while loss is above 10%, add it back after 3 clean reports.
+		if (report.fraction > 25)
+		{
+			int cap = temporal_layer_cap_ > highest_tid_ ? highest_tid_ : temporal_layer_cap_;
+			temporal_layer_cap_ = cap > 0 ? cap - 1 : 0;
+			clean_reports_ = 0;
+		}
+		else if (report.fraction < 5 && temporal_layer_cap_ < highest_tid_)
+		{
+			if (++clean_reports_ >= 3)
+			{
+				temporal_layer_cap_++;
+				clean_reports_ = 0;
+			}
+		}
 	}
 
 	void sender::prepare_sr(rtcp_sr& sr)
@@ -17,11 +17,13 @@
 #include <mutex>
 #include <shared_mutex>
 #include <atomic>
+#include <vector>
 
 
 namespace litertp
 {
 	typedef void (*send_rtp_packet_event)(void* ctx,packet_ptr packet);
+	typedef void (*send_rtp_packets_event)(void* ctx, const std::vector<packet_ptr>& packets);
 
 	class sender
 	{
@@ -30,11 +32,33 @@ namespace litertp
 		virtual ~sender();
 
 		virtual bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration) = 0;
+		//Send a frame already split into nals (without start code) for h26x, or into spatial layer frames for vp9.
+		virtual bool send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
 		virtual bool send_packet(packet_ptr pkt);
+		//Send a frame of a temporal layer, the layer is written in the vp8 descriptor or the frame marking extension.
+		bool send_layer_frame(const uint8_t* frame, uint32_t size, uint32_t duration, const temporal_layer_t& layer);
+
+		//Relay a packet received by another stream or packetized by a fanout group,
+		//ssrc, seq and timestamp are rewritten and the payload is shared without copy.
+		//When the source ssrc changes, packets are dropped until a keyframe arrives.
+		//tid is the temporal layer of packet, -1 if unknown.
+		bool forward_packet(packet_ptr pkt, bool keyframe, int tid = -1);
+		//Map a seq sent or skipped by forward_packet back to the source stream, false if it has no source packet.
+		bool forward_source_seq(uint16_t seq, uint32_t* src_ssrc, uint16_t* src_seq);
+
+		//Frames of forwarded temporal layers above tid are dropped, and seq is kept continuous.
+		//The limit is also lowered while the remote end reports loss, and raised back when loss is gone.
+		void set_max_temporal_layer(int tid);
 
 		uint32_t ssrc()const { return ssrc_; }
 		const sdp_format& format()const { return format_; }
 
+		//Tag sent packets with the rtp-stream-id header extension of a simulcast layer, ext_id 0 disables it.
+		void set_rid(const std::string& rid, uint8_t ext_id);
+		std::string rid();
+		//Tag sent packets with the frame marking header extension, ext_id 0 disables it.
+		void set_frame_marking(uint8_t ext_id);
+
 		uint16_t last_rtp_seq();
 		uint32_t last_rtp_timestamp();
 		double last_timestamp();
@@ -59,9 +83,19 @@ namespace litertp
 
 	protected:
 		uint32_t now_timestamp();
+		void add_rid(packet_ptr pkt);
+		void add_frame_marking(packet_ptr pkt);
+		//Hand the packets of the current frame to send_rtp_packets_event_.
+		void flush_packets();
+	private:
+		bool forward_layer(packet_ptr pkt, int tid);
+		void map_forward_seq(uint32_t src_ssrc, uint16_t src_seq, uint16_t seq);
 	public:
 
+		//Forwarded packets, one at a time.
 		sys::callback<send_rtp_packet_event> send_rtp_packet_event_;
+		//Packetized frames, all packets of a video frame together, so the transport sends them in one batch.
+		sys::callback<send_rtp_packets_event> send_rtp_packets_event_;
 
 	protected:
 		double ms_to_ts(double ms);
@@ -83,6 +117,53 @@ namespace litertp
 		uint16_t seq_ = 0;
 		double timestamp_now_ = 0;
 
+		//forwarding state
+		bool forwarding_ = false;
+		uint32_t forward_ssrc_ = 0;
+		uint16_t forward_seq_offset_ = 0;
+		uint32_t forward_ts_offset_ = 0;
+		double forward_time_ = 0;
+		uint16_t forward_src_seq_ = 0;
+		//Output seq of each forwarded source packet, and of source packets not received yet.
+		//Indexed by output seq for nacks and by source seq for late packets.
+		struct forward_seq_t
+		{
+			bool valid = false;
+			uint32_t src_ssrc = 0;
+			uint16_t src_seq = 0;
+			uint16_t seq = 0;
+		};
+		std::array<forward_seq_t, PACKET_BUFFER_SIZE> forward_out_seqs_;
+		std::array<forward_seq_t, PACKET_BUFFER_SIZE> forward_src_seqs_;
+
+		//temporal layer filter of forwarding
+		int max_temporal_layer_ = 255;
+		int temporal_layer_cap_ = 255;
+		int forward_temporal_layer_ = 255;
+		int highest_tid_ = 0;
+		int clean_reports_ = 0;
+		bool layer_decision_valid_ = false;
+		bool layer_decision_forward_ = true;
+		uint32_t layer_decision_ts_ = 0;
+
+		//temporal layer of the frame being sent, guarded by mutex_.
+		//frame_keyframe_ and frame_discardable_ are set by the packetizer before the packets of a frame are sent.
+		std::mutex layer_mutex_;
+		bool has_layer_ = false;
+		temporal_layer_t layer_ = {};
+		uint8_t layer_tl0_pic_idx_ = 0;
+		bool frame_start_ = true;
+		bool frame_keyframe_ = false;
+		bool frame_discardable_ = false;
+		//Packets of the frame being sent, guarded by mutex_.
+		std::vector<packet_ptr> frame_packets_;
+		std::atomic<uint8_t> frame_marking_ext_id_ = 0;
+
+		//Not guarded by mutex_, packets are sent with mutex_ locked.
+		std::shared_mutex rid_mutex_;
+		std::string rid_;
+		std::atomic<uint8_t> rid_ext_id_ = 0;
+
 		std::shared_mutex history_packets_mutex_;
 		std::array<packet_ptr, PACKET_BUFFER_SIZE> history_packets_;
 	};
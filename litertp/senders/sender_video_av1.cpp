@@ -0,0 +1,186 @@
+/**
+ * @file sender_video_av1.cpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+
+#include "sender_video_av1.h"
+#include "../av1/obu.h"
+
+#include <string.h>
+
+namespace litertp
+{
+    sender_video_av1::sender_video_av1(uint32_t ssrc, media_type_t mt, const sdp_format& fmt)
+		:sender(ssrc,mt,fmt)
+	{
+	}
+
+    sender_video_av1::~sender_video_av1()
+	{
+	}
+
+
+	bool sender_video_av1::send_frame(const uint8_t* frame, uint32_t size, uint32_t duration)
+	{
+        std::unique_lock<std::shared_mutex>lk(mutex_);
+
+        elements_.clear();
+        bool new_sequence = false;
+        int pos = 0;
+        while (pos < (int)size)
+        {
+            av1_obu_t obu;
+            int obu_size = av1_obu_parse(&obu, frame + pos, size - pos);
+            if (obu_size == 0)
+            {
+                return false;
+            }
+            pos += obu_size;
+
+            // Temporal delimiters, tile lists and padding are not transmitted.
+            if (obu.type == AV1_OBU_TEMPORAL_DELIMITER || obu.type == AV1_OBU_TILE_LIST || obu.type == AV1_OBU_PADDING)
+            {
+                continue;
+            }
+            if (obu.type == AV1_OBU_SEQUENCE_HEADER)
+            {
+                new_sequence = true;
+            }
+
+            obu_element e;
+            memcpy(e.header, obu.header, obu.header_size);
+            e.header[0] &= ~0x02; //clear obu_has_size_field
+            e.header_size = obu.header_size;
+            e.payload = obu.payload;
+            e.payload_size = obu.payload_size;
+            elements_.push_back(e);
+        }
+
+        if (elements_.empty())
+        {
+            timestamp_ += duration;
+            return false;
+        }
+
+        // Fill packets with length prefixed elements, an element which does not fit is fragmented.
+        std::vector<obu_segment> segments;
+        const int capacity = MAX_RTP_PAYLOAD_SIZE - 1; //aggregation header
+        int remaining = capacity;
+        bool z = false;
+        bool first = true;
+        for (int i = 0; i < (int)elements_.size(); i++)
+        {
+            int offset = 0;
+            int left = elements_[i].size();
+            while (left > 0)
+            {
+                int need = av1_leb128_size(left) + left;
+                if (need <= remaining)
+                {
+                    segments.push_back({ i,offset,left });
+                    remaining -= need;
+                    break;
+                }
+
+                int len = remaining - av1_leb128_size(remaining);
+                if (len > 0)
+                {
+                    segments.push_back({ i,offset,len });
+                    offset += len;
+                    left -= len;
+                }
+
+                bool y = len > 0;
+                if (!send_segments(segments, z, y, first && new_sequence, false))
+                {
+                    return false;
+                }
+                first = false;
+                z = y;
+                segments.clear();
+                remaining = capacity;
+            }
+        }
+
+        bool ret = send_segments(segments, z, false, first && new_sequence, true);
+
+        timestamp_ += duration;
+
+        return ret;
+	}
+
+    bool sender_video_av1::send_segments(const std::vector<obu_segment>& segments, bool z, bool y, bool n, bool marker)
+    {
+        if (segments.empty())
+        {
+            return true;
+        }
+
+        // W is used when there are up to 3 elements, the last one has no length field.
+        int w = segments.size() <= 3 ? (int)segments.size() : 0;
+        int payload_size = 1;
+        for (int i = 0; i < (int)segments.size(); i++)
+        {
+            if (w == 0 || i < w - 1)
+            {
+                payload_size += av1_leb128_size(segments[i].size);
+            }
+            payload_size += segments[i].size;
+        }
+
+        packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+        pkt->handle_->header->m = marker ? 1 : 0;
+        uint8_t* payload = pkt->alloc_payload(payload_size);
+        if (!payload)
+        {
+            return false;
+        }
+
+        av1_aggregation_header_t ah = {};
+        ah.z = z ? 1 : 0;
+        ah.y = y ? 1 : 0;
+        ah.w = w;
+        ah.n = n ? 1 : 0;
+        int pos = 0;
+        payload[pos++] = av1_aggregation_header_get(&ah);
+        for (int i = 0; i < (int)segments.size(); i++)
+        {
+            if (w == 0 || i < w - 1)
+            {
+                pos += av1_leb128_write(payload + pos, segments[i].size);
+            }
+            copy_segment(payload + pos, segments[i]);
+            pos += segments[i].size;
+        }
+
+        return this->send_packet(pkt);
+    }
+
+    void sender_video_av1::copy_segment(uint8_t* dst, const obu_segment& seg)
+    {
+        const obu_element& e = elements_[seg.element];
+        int offset = seg.offset;
+        int size = seg.size;
+        if (offset < e.header_size)
+        {
+            int n = e.header_size - offset;
+            if (n > size)
+            {
+                n = size;
+            }
+            memcpy(dst, e.header + offset, n);
+            dst += n;
+            offset += n;
+            size -= n;
+        }
+        if (size > 0)
+        {
+            memcpy(dst, e.payload + (offset - e.header_size), size);
+        }
+    }
+
+}
@@ -0,0 +1,53 @@
+/**
+ * @file sender_video_av1.h
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include "sender.h"
+#include <vector>
+
+namespace litertp
+{
+	class sender_video_av1:public sender
+	{
+	public:
+		sender_video_av1(uint32_t ssrc, media_type_t mt, const sdp_format& fmt);
+		virtual ~sender_video_av1();
+
+		//frame is a temporal unit in low overhead bitstream format.
+		bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration);
+
+	private:
+		//An OBU element, the header has obu_has_size_field cleared.
+		struct obu_element
+		{
+			uint8_t header[2];
+			int header_size;
+			const uint8_t* payload;
+			int payload_size;
+
+			int size()const { return header_size + payload_size; }
+		};
+
+		//A piece of an OBU element in a packet.
+		struct obu_segment
+		{
+			int element;
+			int offset;
+			int size;
+		};
+
+		bool send_segments(const std::vector<obu_segment>& segments, bool z, bool y, bool n, bool marker);
+		void copy_segment(uint8_t* dst, const obu_segment& seg);
+
+	private:
+		std::vector<obu_element> elements_;
+	};
+
+
+}
@@ -9,12 +9,21 @@
 
 #include "sender_video_h264.h"
 #include "../h264/nal_header.h"
+#include "../h264/annexb.h"
+
+#include <string.h>
 
 namespace litertp
 {
 	sender_video_h264::sender_video_h264(uint32_t ssrc, media_type_t mt, const sdp_format& fmt)
 		:sender(ssrc,mt,fmt)
 	{
+		int level_asymmetry_allowed = 0, packetization_mode = 0;
+		int64_t profile_level_id = 0;
+		if (fmt.extract_h264_fmtp(&level_asymmetry_allowed, &packetization_mode, &profile_level_id))
+		{
+			aggregate_ = packetization_mode == 1;
+		}
 	}
 
 	sender_video_h264::~sender_video_h264()
@@ -25,81 +34,105 @@ namespace litertp
 	bool sender_video_h264::send_frame(const uint8_t* frame, uint32_t size, uint32_t duration)
 	{
         std::unique_lock<std::shared_mutex>lk(mutex_);
+        // Split the access unit first, so the last nal is known even when the frame ends with a start code.
+        frame_nals_.clear();
+        frame_sizes_.clear();
         int offset = 0;
         int nal_start = 0, nal_size = 0;
         bool islast = false;
-        while (find_next_nal(frame, size, offset, nal_start, nal_size, islast))
+        while (annexb_find_next_nal(frame, size, offset, nal_start, nal_size, islast))
         {
-            send_nal(duration, frame + nal_start, nal_size, islast);
+            frame_nals_.push_back(frame + nal_start);
+            frame_sizes_.push_back((uint32_t)nal_size);
         }
-        return true;
+        return send_nal_list(frame_nals_.data(), frame_sizes_.data(), (int)frame_nals_.size(), duration);
 	}
 
-    void sender_video_h264::send_nal(uint32_t duration, const uint8_t* nal, uint32_t nal_size, bool islast)
+    bool sender_video_h264::send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+    {
+        std::unique_lock<std::shared_mutex>lk(mutex_);
+        return send_nal_list(nals, sizes, count, duration);
+    }
+
+    bool sender_video_h264::send_nal_list(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
     {
-        if (nal_size <=MAX_RTP_PAYLOAD_SIZE)
+        // Find the last nal and classify the frame in one walk, before the first packet goes out.
+        int last = -1;
+        bool keyframe = false, has_slice = false, referenced = false;
+        for (int i = 0; i < count; i++)
         {
-            // Send as Single-Time Aggregation Packet (STAP-A).
-            packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
-            pkt->handle_->header->m = islast ? 1 : 0;
-            pkt->set_payload(nal, nal_size);
-            this->send_packet(pkt);
+            if (!nals[i] || sizes[i] == 0)
+            {
+                continue;
+            }
+            last = i;
+            uint8_t type = nals[i][0] & 0x1F;
+            if (type >= 1 && type <= 5)
+            {
+                has_slice = true;
+                keyframe |= type == 5;
+                referenced |= (nals[i][0] & 0x60) != 0;
+            }
         }
-        else // Send as Fragmentation Unit A (FU-A):
-        {
-            uint8_t nal0 = nal[0];
-            nal_header_t nal_header;
-            nal_header_set(&nal_header, nal0);
-            int pos = 1; //skip nal0
-
-            nal_header_t fu_ind;
-            fu_ind.f = nal_header.f;
-            fu_ind.nri = nal_header.nri;
-            fu_ind.t = 28;  //FU-A
-            uint8_t fu_ind_v = nal_header_get(&fu_ind);
+        frame_keyframe_ = keyframe;
+        // nal_ref_idc 0 on every slice, no other picture refers to this one.
+        frame_discardable_ = has_slice && !referenced;
 
-
-            for (int index = 0; index * MAX_RTP_PAYLOAD_SIZE < nal_size; index++)
+        for (int i = 0; i <= last; i++)
+        {
+            if (!nals[i] || sizes[i] == 0)
             {
-                int offset = index * MAX_RTP_PAYLOAD_SIZE;
-                int payload_length = ((index + 1) * MAX_RTP_PAYLOAD_SIZE < nal_size) ? MAX_RTP_PAYLOAD_SIZE : nal_size - index * MAX_RTP_PAYLOAD_SIZE;
-
-                bool is_first_packet = index == 0;
-                bool is_final_packet = (index + 1) * MAX_RTP_PAYLOAD_SIZE >= nal_size;
+                continue;
+            }
+            send_nal(duration, nals[i], sizes[i], i == last);
+        }
 
-                packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
-                pkt->handle_->header->m= (islast && is_final_packet) ? 1 : 0;
+        // stap_nals_ points into the caller buffer, nothing may be left once the frame is sent.
+        flush_stap_a(true);
+        return last >= 0;
+    }
 
-                fu_header_t fu;
-                fu.t = nal_header.t;
-                if (is_first_packet) {
-                    fu.s = 1;
-                    fu.e = 0;
-                    fu.r = 0;
+    void sender_video_h264::send_nal(uint32_t duration, const uint8_t* nal, uint32_t nal_size, bool islast)
+    {
+        if (aggregate_)
+        {
+            // STAP-A header byte and 16 bits size for each nal.
+            uint32_t stap_header = stap_nals_.empty() ? 1 : 0;
+            if (stap_size_ + stap_header + 2 + nal_size <= MAX_RTP_PAYLOAD_SIZE)
+            {
+                stap_nals_.push_back(std::make_pair(nal, nal_size));
+                stap_size_ += stap_header + 2 + nal_size;
+                if (islast)
+                {
+                    flush_stap_a(true);
                 }
-                else if (is_final_packet) {
-                    fu.s = 0;
-                    fu.e = 1;
-                    fu.r = 0;
+            }
+            else
+            {
+                flush_stap_a(false);
+                if (!islast && 3 + nal_size <= MAX_RTP_PAYLOAD_SIZE)
+                {
+                    stap_nals_.push_back(std::make_pair(nal, nal_size));
+                    stap_size_ = 3 + nal_size;
                 }
-                else {
-                    fu.s = 0;
-                    fu.e = 0;
-                    fu.r = 0;
+                else if (nal_size <= MAX_RTP_PAYLOAD_SIZE)
+                {
+                    send_single_nal(nal, nal_size, islast);
+                }
+                else
+                {
+                    send_fu_a(nal, nal_size, islast);
                 }
-
-                std::string s;
-                s.reserve(MAX_RTP_PAYLOAD_SIZE);
-                s.append(1, fu_ind_v);
-                s.append(1, fu_header_get(&fu));
-                s.append((const char*)nal + pos, payload_length);
-                pos += payload_length;
-                pkt->set_payload((const uint8_t*)s.data(), s.size());
-
-                this->send_packet(pkt);
-
             }
         }
+        else if (nal_size <= MAX_RTP_PAYLOAD_SIZE)
+        {
+            send_single_nal(nal, nal_size, islast);
+        }
+        else
+        {
+            send_fu_a(nal, nal_size, islast);
+        }
 
         if (islast)
         {
@@ -107,56 +140,124 @@ namespace litertp
         }
     }
 
-	bool sender_video_h264::find_next_nal(const uint8_t* buffer, int size, int& offset, int& nal_start, int& nal_size,bool& islast)
-	{
-        int zeroes = 0;
-        // Parse NALs from H264 access unit, encoded as an Annex B bitstream.
-        // NALs are delimited by 0x000001 or 0x00000001.
-        int cur_pos = offset;
-        nal_start = 0;
-        nal_size = 0;
-        islast = false;
-        for (int i = offset; i < size; i++)
+    void sender_video_h264::send_single_nal(const uint8_t* nal, uint32_t nal_size, bool marker)
+    {
+        // Single NAL unit packet.
+        packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+        pkt->handle_->header->m = marker ? 1 : 0;
+        pkt->set_payload(nal, nal_size);
+        this->send_packet(pkt);
+    }
+
+    void sender_video_h264::flush_stap_a(bool marker)
+    {
+        if (stap_nals_.empty())
         {
-            if (buffer[i] == 0x00)
-            {
-                zeroes++;
-            }
-            else if (buffer[i] == 0x01 && zeroes >= 2)
+            return;
+        }
+
+        if (stap_nals_.size() == 1)
+        {
+            send_single_nal(stap_nals_[0].first, stap_nals_[0].second, marker);
+        }
+        else
+        {
+            // Single-Time Aggregation Packet (STAP-A), F is OR of all nals and NRI is the maximum.
+            nal_header_t stap;
+            stap.f = 0;
+            stap.nri = 0;
+            stap.t = 24;
+            for (auto& itr : stap_nals_)
             {
-                // This is a NAL start sequence.
-                int nal_start2 = i + 1;
-                if (nal_start > 0)
+                nal_header_t nal_header;
+                nal_header_set(&nal_header, itr.first[0]);
+                stap.f |= nal_header.f;
+                if (nal_header.nri > stap.nri)
                 {
-                    int end_pos = nal_start2 - (zeroes == 2 ? 3 : 4);
-                    nal_size = end_pos - cur_pos;
-                    islast = cur_pos + nal_size == size;
-                    offset = end_pos;
-                    return true;
+                    stap.nri = nal_header.nri;
                 }
-                else
+            }
+
+            packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+            pkt->handle_->header->m = marker ? 1 : 0;
+            uint8_t* payload = pkt->alloc_payload(stap_size_);
+            if (payload)
+            {
+                int pos = 0;
+                payload[pos++] = nal_header_get(&stap);
+                for (auto& itr : stap_nals_)
                 {
-                    nal_start = nal_start2;
+                    payload[pos++] = (uint8_t)(itr.second >> 8);
+                    payload[pos++] = (uint8_t)(itr.second & 0xff);
+                    memcpy(payload + pos, itr.first, itr.second);
+                    pos += itr.second;
                 }
+                this->send_packet(pkt);
+            }
+        }
+
+        stap_nals_.clear();
+        stap_size_ = 0;
+    }
 
-                cur_pos = nal_start;
+    void sender_video_h264::send_fu_a(const uint8_t* nal, uint32_t nal_size, bool marker)
+    {
+        // Fragmentation Unit A (FU-A)
+        uint8_t nal0 = nal[0];
+        nal_header_t nal_header;
+        nal_header_set(&nal_header, nal0);
+        // nal0 is carried by FU indicator and FU header.
+        const uint8_t* fu_data = nal + 1;
+        uint32_t fu_size = nal_size - 1;
+
+        nal_header_t fu_ind;
+        fu_ind.f = nal_header.f;
+        fu_ind.nri = nal_header.nri;
+        fu_ind.t = 28;  //FU-A
+        uint8_t fu_ind_v = nal_header_get(&fu_ind);
+
+
+        for (uint32_t offset = 0; offset < fu_size; offset += MAX_RTP_PAYLOAD_SIZE)
+        {
+            uint32_t payload_length = (offset + MAX_RTP_PAYLOAD_SIZE < fu_size) ? MAX_RTP_PAYLOAD_SIZE : fu_size - offset;
+
+            bool is_first_packet = offset == 0;
+            bool is_final_packet = offset + payload_length >= fu_size;
+
+            packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+            pkt->handle_->header->m= (marker && is_final_packet) ? 1 : 0;
+
+            fu_header_t fu;
+            fu.t = nal_header.t;
+            if (is_first_packet) {
+                fu.s = 1;
+                fu.e = 0;
+                fu.r = 0;
             }
-            else
+            else if (is_final_packet) {
+                fu.s = 0;
+                fu.e = 1;
+                fu.r = 0;
+            }
+            else {
+                fu.s = 0;
+                fu.e = 0;
+                fu.r = 0;
+            }
+
+            // FU indicator and header, then the nal slice copied straight into the packet buffer.
+            uint8_t* payload = pkt->alloc_payload(payload_length + 2);
+            if (!payload)
             {
-                zeroes = 0;
+                return;
             }
-        }
+            payload[0] = fu_ind_v;
+            payload[1] = fu_header_get(&fu);
+            memcpy(payload + 2, fu_data + offset, payload_length);
 
-        if (cur_pos < size)
-        {
-            nal_start = cur_pos;
-            nal_size = size - nal_start;
-            offset = size;
-            islast = true;
-            return true;
-        }
+            this->send_packet(pkt);
 
-        return false;
-	}
+        }
+    }
 
 }
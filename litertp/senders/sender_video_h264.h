@@ -10,6 +10,7 @@
 #pragma once
 
 #include "sender.h"
+#include <vector>
 
 namespace litertp
 {
@@ -20,11 +21,23 @@ namespace litertp
 		virtual ~sender_video_h264();
 		
 		bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration);
+		bool send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
 
 	private:
+		bool send_nal_list(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
 		void send_nal(uint32_t duration,const uint8_t* nal, uint32_t nal_size, bool islast);
+		void send_single_nal(const uint8_t* nal, uint32_t nal_size, bool marker);
+		void send_fu_a(const uint8_t* nal, uint32_t nal_size, bool marker);
+		void flush_stap_a(bool marker);
 
-		static bool find_next_nal(const uint8_t* buffer, int size, int& offset, int& nal_start, int& nal_size,bool& islast);
+	private:
+		// packetization-mode=1, small nals are aggregated into STAP-A.
+		bool aggregate_ = false;
+		std::vector<std::pair<const uint8_t*, uint32_t>> stap_nals_;
+		uint32_t stap_size_ = 0;
+		//nals of the frame being sent by send_frame, kept to reuse the memory.
+		std::vector<const uint8_t*> frame_nals_;
+		std::vector<uint32_t> frame_sizes_;
 	};
 
 
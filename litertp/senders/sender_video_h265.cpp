@@ -0,0 +1,244 @@
+/**
+ * @file sender_video_h265.cpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+
+#include "sender_video_h265.h"
+#include "../h265/nal_header.h"
+#include "../h264/annexb.h"
+
+#include <string.h>
+
+namespace litertp
+{
+	sender_video_h265::sender_video_h265(uint32_t ssrc, media_type_t mt, const sdp_format& fmt)
+		:sender(ssrc,mt,fmt)
+	{
+	}
+
+	sender_video_h265::~sender_video_h265()
+	{
+	}
+
+
+	bool sender_video_h265::send_frame(const uint8_t* frame, uint32_t size, uint32_t duration)
+	{
+        std::unique_lock<std::shared_mutex>lk(mutex_);
+        // Split the access unit first, so the last nal is known even when the frame ends with a start code.
+        frame_nals_.clear();
+        frame_sizes_.clear();
+        int offset = 0;
+        int nal_start = 0, nal_size = 0;
+        bool islast = false;
+        while (annexb_find_next_nal(frame, size, offset, nal_start, nal_size, islast))
+        {
+            frame_nals_.push_back(frame + nal_start);
+            frame_sizes_.push_back((uint32_t)nal_size);
+        }
+        return send_nal_list(frame_nals_.data(), frame_sizes_.data(), (int)frame_nals_.size(), duration);
+	}
+
+    bool sender_video_h265::send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+    {
+        std::unique_lock<std::shared_mutex>lk(mutex_);
+        return send_nal_list(nals, sizes, count, duration);
+    }
+
+    bool sender_video_h265::send_nal_list(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+    {
+        // Find the last nal and classify the frame in one walk, before the first packet goes out.
+        int last = -1;
+        bool keyframe = false, has_slice = false, referenced = false;
+        for (int i = 0; i < count; i++)
+        {
+            if (!nals[i] || sizes[i] < 2)
+            {
+                continue;
+            }
+            last = i;
+            uint8_t type = (nals[i][0] >> 1) & 0x3F;
+            if (type < H265_NAL_VPS)
+            {
+                has_slice = true;
+                // IRAP pictures: BLA, IDR and CRA.
+                keyframe |= type >= 16 && type <= 21;
+                referenced |= !h265_nal_is_non_reference(type);
+            }
+        }
+        frame_keyframe_ = keyframe;
+        frame_discardable_ = has_slice && !referenced;
+
+        for (int i = 0; i <= last; i++)
+        {
+            if (!nals[i] || sizes[i] < 2)
+            {
+                continue;
+            }
+            send_nal(duration, nals[i], sizes[i], i == last);
+        }
+
+        // ap_nals_ points into the caller buffer, nothing may be left once the frame is sent.
+        flush_ap(true);
+        return last >= 0;
+    }
+
+    void sender_video_h265::send_nal(uint32_t duration, const uint8_t* nal, uint32_t nal_size, bool islast)
+    {
+        if (nal_size < 2)
+        {
+            // Not even a nal header, flush what we have to keep the marker and timestamp right.
+            if (islast)
+            {
+                flush_ap(true);
+                timestamp_ += duration;
+            }
+            return;
+        }
+
+        // AP payload header and 16 bits size for each nal.
+        uint32_t ap_header = ap_nals_.empty() ? 2 : 0;
+        if (ap_size_ + ap_header + 2 + nal_size <= MAX_RTP_PAYLOAD_SIZE)
+        {
+            ap_nals_.push_back(std::make_pair(nal, nal_size));
+            ap_size_ += ap_header + 2 + nal_size;
+            if (islast)
+            {
+                flush_ap(true);
+            }
+        }
+        else
+        {
+            flush_ap(false);
+            if (!islast && 4 + nal_size <= MAX_RTP_PAYLOAD_SIZE)
+            {
+                ap_nals_.push_back(std::make_pair(nal, nal_size));
+                ap_size_ = 4 + nal_size;
+            }
+            else if (nal_size <= MAX_RTP_PAYLOAD_SIZE)
+            {
+                send_single_nal(nal, nal_size, islast);
+            }
+            else
+            {
+                send_fu(nal, nal_size, islast);
+            }
+        }
+
+        if (islast)
+        {
+            timestamp_ += duration;
+        }
+    }
+
+    void sender_video_h265::send_single_nal(const uint8_t* nal, uint32_t nal_size, bool marker)
+    {
+        // Single NAL unit packet.
+        packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+        pkt->handle_->header->m = marker ? 1 : 0;
+        pkt->set_payload(nal, nal_size);
+        this->send_packet(pkt);
+    }
+
+    void sender_video_h265::flush_ap(bool marker)
+    {
+        if (ap_nals_.empty())
+        {
+            return;
+        }
+
+        if (ap_nals_.size() == 1)
+        {
+            send_single_nal(ap_nals_[0].first, ap_nals_[0].second, marker);
+        }
+        else
+        {
+            // Aggregation Packet (AP), F is OR of all nals, LayerId and TID are the lowest.
+            h265_nal_header_t ap;
+            h265_nal_header_set(&ap, ap_nals_[0].first);
+            ap.t = H265_NAL_AP;
+            for (auto& itr : ap_nals_)
+            {
+                h265_nal_header_t nal_header;
+                h265_nal_header_set(&nal_header, itr.first);
+                ap.f |= nal_header.f;
+                if (nal_header.layer_id < ap.layer_id)
+                {
+                    ap.layer_id = nal_header.layer_id;
+                }
+                if (nal_header.tid < ap.tid)
+                {
+                    ap.tid = nal_header.tid;
+                }
+            }
+
+            packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+            pkt->handle_->header->m = marker ? 1 : 0;
+            uint8_t* payload = pkt->alloc_payload(ap_size_);
+            if (payload)
+            {
+                h265_nal_header_get(&ap, payload);
+                int pos = 2;
+                for (auto& itr : ap_nals_)
+                {
+                    payload[pos++] = (uint8_t)(itr.second >> 8);
+                    payload[pos++] = (uint8_t)(itr.second & 0xff);
+                    memcpy(payload + pos, itr.first, itr.second);
+                    pos += itr.second;
+                }
+                this->send_packet(pkt);
+            }
+        }
+
+        ap_nals_.clear();
+        ap_size_ = 0;
+    }
+
+    void sender_video_h265::send_fu(const uint8_t* nal, uint32_t nal_size, bool marker)
+    {
+        // Fragmentation Unit (FU)
+        h265_nal_header_t nal_header;
+        h265_nal_header_set(&nal_header, nal);
+        // The 2 bytes nal header is carried by payload header and FU header.
+        const uint8_t* fu_data = nal + 2;
+        uint32_t fu_size = nal_size - 2;
+
+        h265_nal_header_t fu_ind = nal_header;
+        fu_ind.t = H265_NAL_FU;
+        uint8_t fu_ind_v[2];
+        h265_nal_header_get(&fu_ind, fu_ind_v);
+
+        for (uint32_t offset = 0; offset < fu_size; offset += MAX_RTP_PAYLOAD_SIZE)
+        {
+            uint32_t payload_length = (offset + MAX_RTP_PAYLOAD_SIZE < fu_size) ? MAX_RTP_PAYLOAD_SIZE : fu_size - offset;
+
+            bool is_first_packet = offset == 0;
+            bool is_final_packet = offset + payload_length >= fu_size;
+
+            packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+            pkt->handle_->header->m = (marker && is_final_packet) ? 1 : 0;
+
+            h265_fu_header_t fu;
+            fu.s = is_first_packet ? 1 : 0;
+            fu.e = is_final_packet ? 1 : 0;
+            fu.t = nal_header.t;
+
+            // Payload header and FU header, then the nal slice copied straight into the packet buffer.
+            uint8_t* payload = pkt->alloc_payload(payload_length + 3);
+            if (!payload)
+            {
+                return;
+            }
+            payload[0] = fu_ind_v[0];
+            payload[1] = fu_ind_v[1];
+            payload[2] = h265_fu_header_get(&fu);
+            memcpy(payload + 3, fu_data + offset, payload_length);
+
+            this->send_packet(pkt);
+        }
+    }
+
+}
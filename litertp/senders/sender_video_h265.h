@@ -0,0 +1,43 @@
+/**
+ * @file sender_video_h265.h
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+
+#pragma once
+
+#include "sender.h"
+#include <vector>
+
+namespace litertp
+{
+	class sender_video_h265:public sender
+	{
+	public:
+		sender_video_h265(uint32_t ssrc, media_type_t mt, const sdp_format& fmt);
+		virtual ~sender_video_h265();
+		
+		bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration);
+		bool send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+
+	private:
+		bool send_nal_list(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+		void send_nal(uint32_t duration,const uint8_t* nal, uint32_t nal_size, bool islast);
+		void send_single_nal(const uint8_t* nal, uint32_t nal_size, bool marker);
+		void send_fu(const uint8_t* nal, uint32_t nal_size, bool marker);
+		void flush_ap(bool marker);
+
+	private:
+		// Small nals are aggregated into AP.
+		std::vector<std::pair<const uint8_t*, uint32_t>> ap_nals_;
+		uint32_t ap_size_ = 0;
+		//nals of the frame being sent by send_frame, kept to reuse the memory.
+		std::vector<const uint8_t*> frame_nals_;
+		std::vector<uint32_t> frame_sizes_;
+	};
+
+
+}
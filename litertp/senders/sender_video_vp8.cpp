@@ -10,6 +10,7 @@
 #include "sender_video_vp8.h"
 #include "../vpx/vpx_header.h"
 
+#include <sys2/util.h>
 #include <string.h>
 
 namespace litertp
@@ -17,6 +18,7 @@ namespace litertp
     sender_video_vp8::sender_video_vp8(uint32_t ssrc, media_type_t mt, const sdp_format& fmt)
 		:sender(ssrc,mt,fmt)
 	{
+        picture_id_ = sys::util::random_number<uint16_t>(0, 0x7FFF);
 	}
 
     sender_video_vp8::~sender_video_vp8()
@@ -28,21 +30,48 @@ namespace litertp
 	{
         std::unique_lock<std::shared_mutex>lk(mutex_);
 
-        for (int index = 0; index * MAX_RTP_PAYLOAD_SIZE < size; index++)
+        // Bit 0 of the frame tag is 0 for a key frame.
+        frame_keyframe_ = size > 0 && (frame[0] & 0x01) == 0;
+        frame_discardable_ = has_layer_ && layer_.non_reference;
+
+        // Always carry a 15 bits PictureID, so a forwarder or receiver can tell frames apart.
+        vp8_header h = {};
+        h.extended_present = 1;
+        h.pic_idx_present = 1;
+        h.pic_idx_len = 1;
+        h.pic_idx = picture_id_;
+        if (has_layer_)
+        {
+            h.non_reference = layer_.non_reference;
+            h.tl0_pic_idx_present = 1;
+            h.tl0_pic_idx = layer_tl0_pic_idx_;
+            h.tid_present = 1;
+            h.tid = layer_.tid;
+            h.layer = layer_.layer_sync;
+        }
+        picture_id_ = (picture_id_ + 1) & 0x7FFF;
+
+        for (uint32_t offset = 0; offset < size; offset += MAX_RTP_PAYLOAD_SIZE)
         {
-            int offset = index * MAX_RTP_PAYLOAD_SIZE;
-            int payload_length = (offset + MAX_RTP_PAYLOAD_SIZE < size) ? MAX_RTP_PAYLOAD_SIZE : size - offset;
+            uint32_t payload_length = (offset + MAX_RTP_PAYLOAD_SIZE < size) ? MAX_RTP_PAYLOAD_SIZE : size - offset;
 
-            uint8_t vp8_header = (index == 0) ? 0x10 : 0x00;
-            uint8_t* payload = new uint8_t[payload_length + 1];
-            payload[0] = vp8_header;
-            memcpy(payload + 1, frame + offset, payload_length);
+            h.startof_vp8_partition = (offset == 0) ? 1 : 0;
 
             packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
             pkt->handle_->header->m = ((offset + payload_length) >= size) ? 1 : 0; // Set marker bit for the last packet in the frame.
-            pkt->set_payload(payload, payload_length + 1);
+
+            uint8_t descriptor[8];
+            int descriptor_size = 0;
+            vp8_header_serialize(&h, &descriptor_size, descriptor, sizeof(descriptor));
+
+            uint8_t* payload = pkt->alloc_payload(payload_length + descriptor_size);
+            if (!payload)
+            {
+                return false;
+            }
+            memcpy(payload, descriptor, descriptor_size);
+            memcpy(payload + descriptor_size, frame + offset, payload_length);
             this->send_packet(pkt);
-            delete[] payload;
         }
 
         timestamp_ += duration;
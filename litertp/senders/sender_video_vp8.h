@@ -24,6 +24,8 @@ namespace litertp
 		bool send_nal(uint32_t duration, int pt, const uint8_t* nal, uint32_t nal_size, bool islast);
 
 		static bool find_next_nal(const uint8_t* buffer, int size, int& offset, int& nal_start, int& nal_size,bool& islast);
+
+		uint16_t picture_id_ = 0;
 	};
 
 
@@ -0,0 +1,147 @@
+/**
+ * @file sender_video_vp9.cpp
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+
+#include "sender_video_vp9.h"
+#include "../vpx/vpx_header.h"
+
+#include <string.h>
+
+namespace litertp
+{
+    sender_video_vp9::sender_video_vp9(uint32_t ssrc, media_type_t mt, const sdp_format& fmt)
+		:sender(ssrc,mt,fmt)
+	{
+	}
+
+    sender_video_vp9::~sender_video_vp9()
+	{
+	}
+
+
+	bool sender_video_vp9::send_frame(const uint8_t* frame, uint32_t size, uint32_t duration)
+	{
+        std::unique_lock<std::shared_mutex>lk(mutex_);
+        return send_layers(&frame, &size, 1, duration);
+	}
+
+    bool sender_video_vp9::send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration)
+    {
+        std::unique_lock<std::shared_mutex>lk(mutex_);
+        return send_layers(nals, sizes, count, duration);
+    }
+
+    //https://datatracker.ietf.org/doc/html/rfc9628#section-4.2, non-flexible mode.
+    bool sender_video_vp9::send_layers(const uint8_t* const* frames, const uint32_t* sizes, int count, uint32_t duration)
+    {
+        if (count <= 0 || count > VP9_MAX_SPATIAL_LAYERS)
+        {
+            return false;
+        }
+
+        int keyframe = 0, width = 0, height = 0;
+        vp9_frame_info(frames[0], sizes[0], &keyframe, &width, &height);
+        frame_keyframe_ = keyframe != 0;
+
+        // TL0PICIDX counts the base temporal layer pictures, upper layers repeat the last one.
+        int tid = has_layer_ ? layer_.tid : 0;
+        if (tid == 0)
+        {
+            tl0_pic_idx_++;
+        }
+
+        vp9_header h;
+        memset(&h, 0, sizeof(h));
+        h.pic_idx_present = 1;
+        h.pic_idx_len = 1;
+        h.pic_idx = pic_idx_;
+        h.layer_idx_present = 1;
+        h.tid = tid;
+        h.switching_up = has_layer_ ? layer_.layer_sync : 0;
+        h.tl0_pic_idx = tl0_pic_idx_;
+        h.inter_picture = keyframe ? 0 : 1;
+
+        // Scalability structure is sent with every key picture.
+        vp9_header ss = h;
+        if (keyframe)
+        {
+            ss.ss_present = 1;
+            ss.num_spatial_layers = count;
+            ss.resolution_present = 1;
+            for (int i = 0; i < count; i++)
+            {
+                int k = 0, w = 0, hh = 0;
+                vp9_frame_info(frames[i], sizes[i], &k, &w, &hh);
+                if (w == 0 || hh == 0)
+                {
+                    ss.resolution_present = 0;
+                    break;
+                }
+                ss.width[i] = w;
+                ss.height[i] = hh;
+            }
+        }
+
+        bool ret = true;
+        for (int sid = 0; sid < count && ret; sid++)
+        {
+            const uint8_t* frame = frames[sid];
+            uint32_t size = sizes[sid];
+            uint32_t offset = 0;
+            while (offset < size)
+            {
+                vp9_header& desc = (sid == 0 && offset == 0) ? ss : h;
+                desc.sid = sid;
+                desc.inter_layer = sid > 0 ? 1 : 0;
+                desc.start_of_frame = offset == 0 ? 1 : 0;
+                desc.not_reference = sid + 1 == count ? 1 : 0;
+
+                uint8_t header[64];
+                int header_size = 0;
+                desc.end_of_frame = 0;
+                if (vp9_header_serialize(&desc, &header_size, header, sizeof(header)) < 0)
+                {
+                    ret = false;
+                    break;
+                }
+
+                uint32_t payload_length = size - offset;
+                if (payload_length + header_size > MAX_RTP_PAYLOAD_SIZE)
+                {
+                    payload_length = MAX_RTP_PAYLOAD_SIZE - header_size;
+                }
+                if (offset + payload_length >= size)
+                {
+                    desc.end_of_frame = 1;
+                    vp9_header_serialize(&desc, &header_size, header, sizeof(header));
+                }
+
+                packet_ptr pkt = std::make_shared<packet>(format_.payload_type_, ssrc_, seq_, timestamp_);
+                pkt->handle_->header->m = (desc.end_of_frame && sid + 1 == count) ? 1 : 0;
+
+                uint8_t* payload = pkt->alloc_payload(header_size + payload_length);
+                if (!payload)
+                {
+                    ret = false;
+                    break;
+                }
+                memcpy(payload, header, header_size);
+                memcpy(payload + header_size, frame + offset, payload_length);
+                this->send_packet(pkt);
+
+                offset += payload_length;
+            }
+        }
+
+        pic_idx_ = (pic_idx_ + 1) & 0x7FFF;
+        timestamp_ += duration;
+
+        return ret;
+    }
+
+}
@@ -0,0 +1,35 @@
+/**
+ * @file sender_video_vp9.h
+ * @brief
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include "sender.h"
+
+namespace litertp
+{
+	class sender_video_vp9:public sender
+	{
+	public:
+		sender_video_vp9(uint32_t ssrc, media_type_t mt, const sdp_format& fmt);
+		virtual ~sender_video_vp9();
+
+		//Send a frame or superframe as a single layer.
+		bool send_frame(const uint8_t* frame, uint32_t size, uint32_t duration);
+		//Send a picture already split into spatial layer frames, from the lowest layer.
+		bool send_nals(const uint8_t* const* nals, const uint32_t* sizes, int count, uint32_t duration);
+
+	private:
+		bool send_layers(const uint8_t* const* frames, const uint32_t* sizes, int count, uint32_t duration);
+
+	private:
+		uint16_t pic_idx_ = 0;
+		uint8_t tl0_pic_idx_ = 0;
+	};
+
+
+}
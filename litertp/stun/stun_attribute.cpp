@@ -11,6 +11,7 @@
 #include <sys2/security/md5.h>
 #include <sys2/security/hmac_sha1.h>
 #include <sys2/security/util.h>
+#include <string.h>
 
 stun_attribute::stun_attribute()
 {
@@ -233,11 +234,9 @@ stun_attribute_xor_mapped_address stun_attribute_xor_mapped_address::create(cons
 
 std::string stun_attribute_message_integrity::create_short_turn(const char* data, int data_size,const std::string& password)
 {
-
-	sasl_prep((uint8_t*)password.data());
-	hmac_sha1 ms;
-	BYTE ret[20] = { 0 };
-	ms.make_bytes((const BYTE*)data, data_size, (const BYTE*)password.data(), password.size(), ret);
+	stun_integrity_key key(password);
+	uint8_t ret[20] = { 0 };
+	key.sign(data, data_size, ret);
 
 	return std::string((const char*)ret, 20);
 }
@@ -254,9 +253,80 @@ std::string stun_attribute_message_integrity::create_long_turn(const char* data,
 	MD5 m5 = { 0 };
 	md5((const unsigned char*)key.c_str(),key.size(), &m5);
 
-	hmac_sha1 ms;
+	hmac_sha1_key ms(m5.bv, 16);
 	BYTE ret[20] = { 0 };
-	ms.make_bytes((const BYTE*)data, data_size, m5.bv, 16, ret);
+	ms.make_bytes((const BYTE*)data, data_size, ret);
 
 	return std::string((const char*)ret, 20);
 }
+
+stun_integrity_key::stun_integrity_key(const std::string& password)
+{
+	password_ = password;
+	sasl_prep((uint8_t*)&password_[0]);
+	password_.resize(strlen(password_.c_str()));
+
+#ifdef LITERTP_SSL_SHA1
+	uint8_t block[SHA_CBLOCK] = { 0 };
+	if (password_.size() > sizeof(block))
+	{
+		SHA1((const unsigned char*)password_.data(), password_.size(), block);
+	}
+	else
+	{
+		memcpy(block, password_.data(), password_.size());
+	}
+
+	uint8_t pad[SHA_CBLOCK];
+	for (int i = 0; i < SHA_CBLOCK; i++)
+	{
+		pad[i] = block[i] ^ 0x36;
+	}
+	inner_ = EVP_MD_CTX_new();
+	EVP_DigestInit_ex(inner_, EVP_sha1(), nullptr);
+	EVP_DigestUpdate(inner_, pad, sizeof(pad));
+
+	for (int i = 0; i < SHA_CBLOCK; i++)
+	{
+		pad[i] = block[i] ^ 0x5c;
+	}
+	outer_ = EVP_MD_CTX_new();
+	EVP_DigestInit_ex(outer_, EVP_sha1(), nullptr);
+	EVP_DigestUpdate(outer_, pad, sizeof(pad));
+#else
+	key_.set_key((const BYTE*)password_.data(), (int)password_.size());
+#endif
+}
+
+stun_integrity_key::~stun_integrity_key()
+{
+#ifdef LITERTP_SSL_SHA1
+	EVP_MD_CTX_free(inner_);
+	EVP_MD_CTX_free(outer_);
+#endif
+}
+
+void stun_integrity_key::sign(const char* data, int data_size, uint8_t* digest)const
+{
+#ifdef LITERTP_SSL_SHA1
+	// One context per thread, reset from the cached states, so signing does not allocate.
+	struct ctx_holder
+	{
+		EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+		~ctx_holder() { EVP_MD_CTX_free(ctx); }
+	};
+	static thread_local ctx_holder holder;
+	EVP_MD_CTX* ctx = holder.ctx;
+
+	uint8_t inner_hash[SHA_DIGEST_LENGTH];
+	EVP_MD_CTX_copy_ex(ctx, inner_);
+	EVP_DigestUpdate(ctx, data, data_size);
+	EVP_DigestFinal_ex(ctx, inner_hash, nullptr);
+
+	EVP_MD_CTX_copy_ex(ctx, outer_);
+	EVP_DigestUpdate(ctx, inner_hash, sizeof(inner_hash));
+	EVP_DigestFinal_ex(ctx, digest, nullptr);
+#else
+	key_.make_bytes((const BYTE*)data, data_size, digest);
+#endif
+}
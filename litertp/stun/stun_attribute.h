@@ -10,6 +10,15 @@
 
 #pragma once
 #include <string>
+#include <memory>
+#include <stdint.h>
+
+#ifdef LITERTP_SSL_SHA1
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+#else
+#include <sys2/security/hmac_sha1.h>
+#endif
 
 
 
@@ -123,3 +132,28 @@ public:
 
 };
 
+//Short term credential of one password, hmac states of the prepared password are made once,
+//so signing a message only hashes the message. sign may be called by many threads.
+class stun_integrity_key
+{
+public:
+	explicit stun_integrity_key(const std::string& password);
+	~stun_integrity_key();
+
+	stun_integrity_key(const stun_integrity_key&) = delete;
+	stun_integrity_key& operator=(const stun_integrity_key&) = delete;
+
+	const std::string& password()const { return password_; }
+	void sign(const char* data, int data_size, uint8_t* digest)const;
+
+private:
+	std::string password_;
+#ifdef LITERTP_SSL_SHA1
+	EVP_MD_CTX* inner_ = nullptr;
+	EVP_MD_CTX* outer_ = nullptr;
+#else
+	hmac_sha1_key key_;
+#endif
+};
+
+
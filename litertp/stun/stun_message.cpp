@@ -47,9 +47,14 @@ std::string stun_message::serialize(int placeholder)const
 }
 
 std::string stun_message::serialize(const std::string& password)const
+{
+	return serialize(stun_integrity_key(password));
+}
+
+std::string stun_message::serialize(const stun_integrity_key& key)const
 {
 	std::string s = serialize(24);
-	add_message_integrity_short_turn(s, password);
+	add_message_integrity(s, key);
 
 	uint16_t len = s.size() - 20 + 8;
 	//len = sys::socket::hton16(len);
@@ -139,6 +144,14 @@ void stun_message::add_message_integrity_short_turn(std::string& data, const std
 	
 }
 
+void stun_message::add_message_integrity(std::string& data, const stun_integrity_key& key)
+{
+	uint8_t code[20];
+	key.sign(data.data(), (int)data.size(), code);
+	stun_attribute mi_attr(stun_attribute_type_message_integrity, (const char*)code, sizeof(code));
+	data.append(mi_attr.serialize());
+}
+
 void stun_message::add_message_integrity_long_turn(std::string& data, const std::string& username, const std::string& realm, const std::string& password)
 {
 	std::string code = stun_attribute_message_integrity::create_long_turn(data.c_str(), data.size(), username,realm, password);
@@ -37,6 +37,8 @@ public:
 
 	
 	std::string serialize(const std::string& password)const;
+	//Sign with a key made once for the password, see stun_integrity_key.
+	std::string serialize(const stun_integrity_key& key)const;
 	std::string serialize(const std::string& username, const std::string& realm, const std::string& password)const;
 
 	bool deserialize(const char* buffer, int size,uint32_t& fingerprint);
@@ -51,6 +53,7 @@ public:
 private:
 	std::string serialize(int placeholder = 0)const;
 	static void add_message_integrity_short_turn(std::string& data, const std::string& password);
+	static void add_message_integrity(std::string& data, const stun_integrity_key& key);
 	static void add_message_integrity_long_turn(std::string& data, const std::string& username, const std::string& realm, const std::string& password);
 	static void add_fingerprint(std::string& data);
 	static uint32_t calculate_fingerprint(const char* data,int data_size);
@@ -0,0 +1,139 @@
+/**
+ * @file stun_test.hpp
+ * @brief Checks of the stun writer and view, throughput of the crc32 used by stun fingerprints.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include <string.h>
+#include <sys2/security/crc32.h>
+
+#include "stun_view.h"
+#include "stun_writer.h"
+
+static uint32_t test_crc32_bitwise(const unsigned char* s, size_t len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < len; i++)
+	{
+		crc ^= s[i];
+		for (int j = 0; j < 8; j++)
+		{
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+		}
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+static double test_crc32_ns(uint32_t(*fn)(const unsigned char*, size_t), const std::vector<unsigned char>& data, size_t size, int count, volatile uint32_t& sink)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		sink ^= fn(data.data() + (i & 7), size);
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+}
+
+static uint32_t test_crc32_slice8(const unsigned char* s, size_t len)
+{
+	return crc32_update_slice8(0xFFFFFFFF, s, len) ^ 0xFFFFFFFF;
+}
+
+static uint32_t test_crc32_dispatch(const unsigned char* s, size_t len)
+{
+	return cyg_ether_crc32(s, (int)len);
+}
+
+// Every length up to 300 with every alignment matches the bitwise crc,
+// then time the sizes of binding requests and responses and a large buffer.
+static bool test_stun_crc32(int count = 1000000)
+{
+	std::vector<unsigned char> data(4096 + 8);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = (unsigned char)(i * 131 + 7);
+	}
+
+	int failed = 0;
+	for (size_t offset = 0; offset < 8; offset++)
+	{
+		for (size_t len = 0; len <= 300; len++)
+		{
+			uint32_t expect = test_crc32_bitwise(data.data() + offset, len);
+			if (test_crc32_slice8(data.data() + offset, len) != expect || test_crc32_dispatch(data.data() + offset, len) != expect)
+			{
+				failed++;
+			}
+		}
+	}
+	if (cyg_ether_crc32_accumulate(cyg_ether_crc32(data.data(), 100), data.data() + 100, 900) != test_crc32_bitwise(data.data(), 1000))
+	{
+		failed++;
+	}
+	printf("crc32 %s, %d mismatches\n", crc32_implementation(), failed);
+
+	volatile uint32_t sink = 0;
+	const size_t sizes[] = { 68, 100, 152, 1200, 4096 };
+	for (size_t size : sizes)
+	{
+		int n = size > 1000 ? count / 10 : count;
+		double bitwise = test_crc32_ns(test_crc32_bitwise, data, size, n / 10, sink);
+		double slice8 = test_crc32_ns(test_crc32_slice8, data, size, n, sink);
+		double dispatch = test_crc32_ns(test_crc32_dispatch, data, size, n, sink);
+		printf("%5zu bytes: bitwise %8.1f ns, slice8 %8.1f ns, %s %8.1f ns\n", size, bitwise, slice8, crc32_implementation(), dispatch);
+	}
+	return failed == 0;
+}
+
+// A request written by stun_writer is the same as one serialized by stun_message,
+// and stun_view reads it back and checks its integrity.
+static bool test_stun_writer()
+{
+	uint8_t tid[12];
+	stun_writer::make_transaction_id(tid);
+	const std::string pwd = "asd88fgpdd777uzjYhagZg";
+	const uint32_t priority = 1853766911;
+
+	stun_message msg;
+	msg.type_ = stun_message_type_binding_request;
+	memcpy(msg.transaction_id_, tid, 12);
+	msg.attributes_.emplace_back(stun_attribute_type_username, std::string("remote:local"));
+	uint8_t v[4] = { (uint8_t)(priority >> 24), (uint8_t)(priority >> 16), (uint8_t)(priority >> 8), (uint8_t)priority };
+	msg.attributes_.emplace_back(stun_attribute_type_use_candidate, "");
+	msg.attributes_.emplace_back(stun_attribute_type_priority, (const char*)v, sizeof(v));
+	std::string expect = msg.serialize(pwd);
+
+	uint8_t buf[STUN_WRITER_BUFFER_SIZE];
+	stun_writer writer(buf, sizeof(buf));
+	writer.begin(stun_message_type_binding_request, tid);
+	writer.add_attribute(stun_attribute_type_username, "remote:local", 12);
+	writer.add_attribute(stun_attribute_type_use_candidate, nullptr, 0);
+	writer.add_uint32(stun_attribute_type_priority, priority);
+	writer.finish(stun_integrity_key(pwd));
+
+	bool same = writer.size() == (int)expect.size() && memcmp(writer.data(), expect.data(), expect.size()) == 0;
+
+	stun_view view;
+	uint32_t value = 0;
+	bool parsed = view.parse(writer.data(), writer.size()) && view.type() == stun_message_type_binding_request
+		&& view.get_uint32(stun_attribute_type_priority, &value) && value == priority
+		&& view.has(stun_attribute_type_use_candidate) && view.check_integrity(stun_integrity_key(pwd))
+		&& !view.check_integrity(stun_integrity_key("wrong")) && !view.parse(writer.data(), writer.size() - 1);
+
+	stun_writer small(buf, 32);
+	small.begin(stun_message_type_binding_request, tid);
+	small.finish(stun_integrity_key(pwd));
+
+	printf("stun writer same %d, view %d, overflow %d\n", same, parsed, small.size() < 0);
+	return same && parsed && small.size() < 0;
+}
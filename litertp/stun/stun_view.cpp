@@ -0,0 +1,126 @@
+/**
+ * @file stun_view.cpp
+ * @brief Read a stun message in place, nothing is copied or allocated.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "stun_view.h"
+#include "stun_writer.h"
+
+#include <string.h>
+
+#ifdef LITERTP_SSL
+#include <openssl/crypto.h>
+#endif
+
+static inline uint16_t read16(const uint8_t* p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t read32(const uint8_t* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+bool stun_view::parse(const uint8_t* data, int size)
+{
+	data_ = nullptr;
+	size_ = 0;
+	if (size < 20 || (data[0] & 0xC0) != 0) {
+		return false;
+	}
+
+	int len = read16(data + 2);
+	if ((len & 3) != 0 || size < len + 20 || read32(data + 4) != MAGIC_COOKIE) {
+		return false;
+	}
+
+	// Attributes must end exactly at the message end, so find needs no bounds checks.
+	int offset = 20;
+	while (offset < len + 20) {
+		if (offset + 4 > len + 20) {
+			return false;
+		}
+		int attr_len = read16(data + offset + 2);
+		offset += 4 + ((attr_len + 3) & ~3);
+	}
+	if (offset != len + 20) {
+		return false;
+	}
+
+	data_ = data;
+	size_ = len + 20;
+	type_ = (stun_message_type)read16(data);
+	return true;
+}
+
+bool stun_view::find(stun_attribute_type type, const uint8_t** value, int* size)const
+{
+	int offset = 20;
+	while (offset < size_) {
+		int attr_type = read16(data_ + offset);
+		int attr_len = read16(data_ + offset + 2);
+		if (attr_type == type) {
+			*value = data_ + offset + 4;
+			*size = attr_len;
+			return true;
+		}
+		offset += 4 + ((attr_len + 3) & ~3);
+	}
+	return false;
+}
+
+bool stun_view::has(stun_attribute_type type)const
+{
+	const uint8_t* value = nullptr;
+	int size = 0;
+	return find(type, &value, &size);
+}
+
+bool stun_view::get_uint32(stun_attribute_type type, uint32_t* value)const
+{
+	const uint8_t* p = nullptr;
+	int size = 0;
+	if (!find(type, &p, &size) || size < 4) {
+		return false;
+	}
+	*value = read32(p);
+	return true;
+}
+
+bool stun_view::check_integrity(const stun_integrity_key& key)const
+{
+	const uint8_t* value = nullptr;
+	int size = 0;
+	if (!find(stun_attribute_type_message_integrity, &value, &size) || size != 20) {
+		return false;
+	}
+
+	// The digest covers the message up to the attribute, with the length ending at the attribute.
+	int offset = (int)(value - 4 - data_);
+	uint8_t buf[STUN_WRITER_BUFFER_SIZE];
+	if (offset > (int)sizeof(buf)) {
+		return false;
+	}
+	memcpy(buf, data_, offset);
+	int length = offset + 24 - 20;
+	buf[2] = (uint8_t)(length >> 8);
+	buf[3] = (uint8_t)length;
+
+	uint8_t digest[20];
+	key.sign((const char*)buf, offset, digest);
+#ifdef LITERTP_SSL
+	return CRYPTO_memcmp(digest, value, 20) == 0;
+#else
+	// Constant time, so the digest can not be guessed byte by byte.
+	uint8_t diff = 0;
+	for (int i = 0; i < 20; i++)
+	{
+		diff |= digest[i] ^ value[i];
+	}
+	return diff == 0;
+#endif
+}
@@ -0,0 +1,37 @@
+/**
+ * @file stun_view.h
+ * @brief Read a stun message in place, nothing is copied or allocated.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include "stun_message.h"
+
+#include <stdint.h>
+
+class stun_view
+{
+public:
+	//Check the header and the bounds of all attributes, data must outlive the view.
+	bool parse(const uint8_t* data, int size);
+
+	stun_message_type type()const { return type_; }
+	const uint8_t* transaction_id()const { return data_ + 8; }
+	const uint8_t* data()const { return data_; }
+	int size()const { return size_; }
+
+	//value points into the message, the first attribute of type is found.
+	bool find(stun_attribute_type type, const uint8_t** value, int* size)const;
+	bool has(stun_attribute_type type)const;
+	bool get_uint32(stun_attribute_type type, uint32_t* value)const;
+	//Check MESSAGE-INTEGRITY with key, false if it is missing or does not match.
+	bool check_integrity(const stun_integrity_key& key)const;
+
+private:
+	const uint8_t* data_ = nullptr;
+	int size_ = 0;
+	stun_message_type type_ = stun_message_type_binding_request;
+};
@@ -0,0 +1,177 @@
+/**
+ * @file stun_writer.cpp
+ * @brief Write a stun message into a caller buffer, nothing is allocated.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "stun_writer.h"
+
+#include <sys2/socket.h>
+#include <sys2/security/crc32.h>
+#include <string.h>
+#include <random>
+
+#ifdef LITERTP_SSL
+#include <openssl/rand.h>
+#endif
+
+static inline void write16(uint8_t* p, uint16_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+static inline void write32(uint8_t* p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+stun_writer::stun_writer(uint8_t* buffer, int capacity)
+{
+	buffer_ = buffer;
+	capacity_ = capacity;
+}
+
+void stun_writer::begin(stun_message_type type, const uint8_t* transaction_id)
+{
+	size_ = 0;
+	failed_ = false;
+	uint8_t* p = reserve(20);
+	if (!p) {
+		return;
+	}
+	write16(p, (uint16_t)type & 0x3FFF);
+	write16(p + 2, 0);
+	write32(p + 4, MAGIC_COOKIE);
+	memcpy(p + 8, transaction_id, 12);
+}
+
+uint8_t* stun_writer::reserve(int size)
+{
+	if (failed_ || size_ + size > capacity_) {
+		failed_ = true;
+		return nullptr;
+	}
+	uint8_t* p = buffer_ + size_;
+	size_ += size;
+	return p;
+}
+
+void stun_writer::set_length(int length)
+{
+	if (!failed_) {
+		write16(buffer_ + 2, (uint16_t)length);
+	}
+}
+
+void stun_writer::add_attribute(stun_attribute_type type, const void* value, int size)
+{
+	int padded = (size + 3) & ~3;
+	uint8_t* p = reserve(4 + padded);
+	if (!p) {
+		return;
+	}
+	write16(p, (uint16_t)type);
+	write16(p + 2, (uint16_t)size);
+	if (size > 0) {
+		memcpy(p + 4, value, size);
+	}
+	memset(p + 4 + size, 0, padded - size);
+	set_length(size_ - 20);
+}
+
+void stun_writer::add_uint32(stun_attribute_type type, uint32_t value)
+{
+	uint8_t v[4];
+	write32(v, value);
+	add_attribute(type, v, sizeof(v));
+}
+
+void stun_writer::add_uint64(stun_attribute_type type, uint64_t value)
+{
+	uint8_t v[8];
+	write32(v, (uint32_t)(value >> 32));
+	write32(v + 4, (uint32_t)value);
+	add_attribute(type, v, sizeof(v));
+}
+
+void stun_writer::add_xor_mapped_address(const sockaddr* addr)
+{
+	// Port is xored with the high half of the cookie, address with the cookie and the transaction id.
+	uint8_t v[20] = { 0 };
+	uint8_t mask[16];
+	write32(mask, MAGIC_COOKIE);
+	memcpy(mask + 4, buffer_ + 8, 12);
+
+	int size = 0;
+	if (addr->sa_family == AF_INET) {
+		const sockaddr_in* sin = (const sockaddr_in*)addr;
+		const uint8_t* ip = (const uint8_t*)&sin->sin_addr;
+		v[1] = stun_attribute_mapped_address::IPV4;
+		write16(v + 2, sys::socket::ntoh16(sin->sin_port) ^ (uint16_t)(MAGIC_COOKIE >> 16));
+		for (int i = 0; i < 4; i++) {
+			v[4 + i] = ip[i] ^ mask[i];
+		}
+		size = 8;
+	}
+	else if (addr->sa_family == AF_INET6) {
+		const sockaddr_in6* sin6 = (const sockaddr_in6*)addr;
+		v[1] = stun_attribute_mapped_address::IPV6;
+		write16(v + 2, sys::socket::ntoh16(sin6->sin6_port) ^ (uint16_t)(MAGIC_COOKIE >> 16));
+		for (int i = 0; i < 16; i++) {
+			v[4 + i] = sin6->sin6_addr.s6_addr[i] ^ mask[i];
+		}
+		size = 20;
+	}
+	else {
+		failed_ = true;
+		return;
+	}
+	add_attribute(stun_attribute_type_xor_mapped_address, v, size);
+}
+
+void stun_writer::finish(const stun_integrity_key& key)
+{
+	// The length covers the attribute being added when it is computed.
+	uint8_t* mi = reserve(24);
+	if (!mi) {
+		return;
+	}
+	set_length(size_ - 20);
+	write16(mi, stun_attribute_type_message_integrity);
+	write16(mi + 2, 20);
+	key.sign((const char*)buffer_, (int)(mi - buffer_), mi + 4);
+
+	uint8_t* fp = reserve(8);
+	if (!fp) {
+		return;
+	}
+	set_length(size_ - 20);
+	write16(fp, stun_attribute_type_fingerprint);
+	write16(fp + 2, 4);
+	uint32_t crc = cyg_ether_crc32(buffer_, (int)(fp - buffer_)) ^ 0x5354554e;
+	write32(fp + 4, crc);
+}
+
+void stun_writer::make_transaction_id(uint8_t* transaction_id)
+{
+	// RFC 8489 section 5, transaction ids must be cryptographically random.
+#ifdef LITERTP_SSL
+	if (RAND_bytes(transaction_id, 12) == 1)
+	{
+		return;
+	}
+#endif
+	// random_device reads the system csprng (getrandom, /dev/urandom or RtlGenRandom).
+	thread_local std::random_device rd;
+	for (int i = 0; i < 12; i += 4)
+	{
+		uint32_t v = rd();
+		memcpy(transaction_id + i, &v, 4);
+	}
+}
@@ -0,0 +1,48 @@
+/**
+ * @file stun_writer.h
+ * @brief Write a stun message into a caller buffer, nothing is allocated.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include "stun_message.h"
+
+#include <stdint.h>
+
+struct sockaddr;
+
+//A binding request or response fits in this size.
+#define STUN_WRITER_BUFFER_SIZE 1024
+
+class stun_writer
+{
+public:
+	stun_writer(uint8_t* buffer, int capacity);
+
+	void begin(stun_message_type type, const uint8_t* transaction_id);
+	void add_attribute(stun_attribute_type type, const void* value, int size);
+	void add_uint32(stun_attribute_type type, uint32_t value);
+	void add_uint64(stun_attribute_type type, uint64_t value);
+	void add_xor_mapped_address(const sockaddr* addr);
+	//Add message integrity then fingerprint, nothing can be added after.
+	void finish(const stun_integrity_key& key);
+
+	//Message size, -1 if the buffer is too small.
+	int size()const { return failed_ ? -1 : size_; }
+	const uint8_t* data()const { return buffer_; }
+
+	static void make_transaction_id(uint8_t* transaction_id);
+
+private:
+	uint8_t* reserve(int size);
+	void set_length(int length);
+
+private:
+	uint8_t* buffer_;
+	int capacity_;
+	int size_ = 0;
+	bool failed_ = false;
+};
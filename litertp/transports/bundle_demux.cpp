@@ -0,0 +1,246 @@
+/**
+ * @file bundle_demux.cpp
+ * @brief Dispatch rtp packets of a BUNDLE transport to media streams.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+#include "bundle_demux.h"
+
+#include <algorithm>
+
+namespace litertp {
+
+	//Routes whose handler runs on this thread, innermost last.
+	static thread_local std::vector<const void*> dispatching_routes;
+
+	bundle_demux::bundle_demux()
+	{
+	}
+
+	bundle_demux::~bundle_demux()
+	{
+	}
+
+	void bundle_demux::add_stream(rtp_packet_handler handler, void* ctx)
+	{
+		std::unique_lock<std::shared_mutex> lk(mutex_);
+		for (auto& route : routes_)
+		{
+			if (route->ctx == ctx)
+			{
+				return;
+			}
+		}
+
+		auto route = std::make_shared<route_t>();
+		route->handler = handler;
+		route->ctx = ctx;
+		routes_.push_back(route);
+	}
+
+	void bundle_demux::remove_stream(void* ctx)
+	{
+		std::vector<route_ptr> removed;
+		std::unique_lock<std::shared_mutex> lk(mutex_);
+		routes_.erase(std::remove_if(routes_.begin(), routes_.end(), [ctx, &removed](const route_ptr& route) {
+			if (route->ctx != ctx)
+			{
+				return false;
+			}
+			route->removed = true;
+			removed.push_back(route);
+			return true;
+			}), routes_.end());
+
+		for (auto itr = learned_ssrcs_.begin(); itr != learned_ssrcs_.end();)
+		{
+			if (itr->second->ctx == ctx)
+			{
+				itr = learned_ssrcs_.erase(itr);
+			}
+			else
+			{
+				itr++;
+			}
+		}
+		rebuild();
+		lk.unlock();
+
+		// No new packet finds the route now, wait for those already given to the handler.
+		// Packets the calling thread is dispatching can not finish before this returns, they are not waited for.
+		std::unique_lock<std::mutex> lk_idle(idle_mutex_);
+		for (auto& route : removed)
+		{
+			int own = (int)std::count(dispatching_routes.begin(), dispatching_routes.end(), route.get());
+			idle_cv_.wait(lk_idle, [&route, own] { return route->active == own; });
+		}
+	}
+
+	void bundle_demux::update_stream(void* ctx, const std::string& mid, const std::vector<uint32_t>& ssrcs, const std::vector<int>& pts, uint8_t mid_ext_id)
+	{
+		std::unique_lock<std::shared_mutex> lk(mutex_);
+		for (auto& route : routes_)
+		{
+			if (route->ctx == ctx)
+			{
+				route->mid = mid;
+				route->ssrcs = ssrcs;
+				route->pts = pts;
+				break;
+			}
+		}
+
+		// All streams of a BUNDLE group use the same extension id.
+		if (mid_ext_id > 0)
+		{
+			mid_ext_id_ = mid_ext_id;
+		}
+		rebuild();
+	}
+
+	size_t bundle_demux::stream_count()
+	{
+		std::shared_lock<std::shared_mutex> lk(mutex_);
+		return routes_.size();
+	}
+
+	void bundle_demux::rebuild()
+	{
+		ssrcs_.clear();
+		mids_.clear();
+		pts_.clear();
+
+		std::unordered_map<int, int> pt_users;
+		for (auto& route : routes_)
+		{
+			for (auto ssrc : route->ssrcs)
+			{
+				ssrcs_[ssrc] = route;
+			}
+			if (!route->mid.empty())
+			{
+				mids_[route->mid] = route;
+			}
+			for (auto pt : route->pts)
+			{
+				pt_users[pt]++;
+				pts_[pt] = route;
+			}
+		}
+
+		// A payload type shared by streams can not tell them apart.
+		for (auto& itr : pt_users)
+		{
+			if (itr.second > 1)
+			{
+				pts_.erase(itr.first);
+			}
+		}
+	}
+
+	bundle_demux::route_ptr bundle_demux::find_route(packet_ptr packet, bool& learn)
+	{
+		learn = false;
+		if (routes_.size() == 1)
+		{
+			return routes_[0];
+		}
+
+		const rtp_header* header = packet->handle_->header;
+		uint32_t ssrc = header->ssrc;
+
+		// The mid wins over a stale ssrc mapping, a ssrc may be moved to another m-line.
+		if (mid_ext_id_ > 0 && header->x)
+		{
+			uint8_t buf[32];
+			int len = rtp_header_get_ext_element(header, mid_ext_id_, buf, sizeof(buf));
+			if (len > 0)
+			{
+				auto itr = mids_.find(std::string((const char*)buf, len));
+				if (itr != mids_.end())
+				{
+					auto itr_ssrc = learned_ssrcs_.find(ssrc);
+					learn = itr_ssrc == learned_ssrcs_.end() || itr_ssrc->second != itr->second;
+					return itr->second;
+				}
+			}
+		}
+
+		auto itr = ssrcs_.find(ssrc);
+		if (itr != ssrcs_.end())
+		{
+			return itr->second;
+		}
+		itr = learned_ssrcs_.find(ssrc);
+		if (itr != learned_ssrcs_.end())
+		{
+			return itr->second;
+		}
+
+		auto itr_pt = pts_.find(header->pt);
+		if (itr_pt != pts_.end())
+		{
+			learn = true;
+			return itr_pt->second;
+		}
+		return nullptr;
+	}
+
+	void bundle_demux::learn_ssrc(uint32_t ssrc, route_ptr route)
+	{
+		std::unique_lock<std::shared_mutex> lk(mutex_);
+		// The stream may be removed while the packet is dispatched.
+		if (std::find(routes_.begin(), routes_.end(), route) == routes_.end())
+		{
+			return;
+		}
+
+		learned_ssrcs_[ssrc] = route;
+		route->learned.push_back(ssrc);
+		while (route->learned.size() > BUNDLE_MAX_LEARNED_SSRCS)
+		{
+			// The ssrc may have moved to another stream since.
+			auto itr = learned_ssrcs_.find(route->learned.front());
+			if (itr != learned_ssrcs_.end() && itr->second == route)
+			{
+				learned_ssrcs_.erase(itr);
+			}
+			route->learned.pop_front();
+		}
+	}
+
+	bool bundle_demux::dispatch(std::shared_ptr<sys::socket> skt, packet_ptr packet, const sockaddr* addr, int addr_size)
+	{
+		route_ptr route;
+		bool learn = false;
+		{
+			std::shared_lock<std::shared_mutex> lk(mutex_);
+			route = find_route(packet, learn);
+			if (!route)
+			{
+				return false;
+			}
+			// Counted before mutex_ is released, so remove_stream waits for the handler.
+			route->active++;
+		}
+
+		dispatching_routes.push_back(route.get());
+		route->handler(route->ctx, skt, packet, addr, addr_size);
+		dispatching_routes.pop_back();
+		// remove_stream called from a handler waits for the count of its own thread, not for 0.
+		route->active--;
+		if (route->removed)
+		{
+			std::unique_lock<std::mutex> lk_idle(idle_mutex_);
+			idle_cv_.notify_all();
+		}
+
+		if (learn)
+		{
+			learn_ssrc(packet->handle_->header->ssrc, route);
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,83 @@
+/**
+ * @file bundle_demux.h
+ * @brief Dispatch rtp packets of a BUNDLE transport to media streams.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include "../packet.h"
+
+#include <sys2/socket.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Learned ssrcs kept per stream, the oldest is forgotten first.
+#define BUNDLE_MAX_LEARNED_SSRCS 16
+
+namespace litertp {
+
+	//A packet is given to one stream, found by the mid header extension, then by ssrc, then by an unique payload type.
+	//The mid wins over the ssrc, a ssrc may be moved to another m-line.
+	//ssrc of packets found by mid or payload type are learned, see RFC 8843 section 9.2.
+	class bundle_demux
+	{
+	public:
+		typedef void (*rtp_packet_handler)(void* ctx, std::shared_ptr<sys::socket> skt, packet_ptr packet, const sockaddr* addr, int addr_size);
+
+		bundle_demux();
+		~bundle_demux();
+
+		void add_stream(rtp_packet_handler handler, void* ctx);
+		//Blocks until the packets being dispatched to ctx by other threads are done.
+		//Called from a handler of ctx, the packet of the calling thread finishes after it returns.
+		void remove_stream(void* ctx);
+		//Replace the signaled mid, ssrcs and payload types of a stream, learned ssrcs are kept.
+		void update_stream(void* ctx, const std::string& mid, const std::vector<uint32_t>& ssrcs, const std::vector<int>& pts, uint8_t mid_ext_id);
+		size_t stream_count();
+
+		//Returns false if no stream takes the packet.
+		bool dispatch(std::shared_ptr<sys::socket> skt, packet_ptr packet, const sockaddr* addr, int addr_size);
+
+	private:
+		struct route_t
+		{
+			rtp_packet_handler handler = nullptr;
+			void* ctx = nullptr;
+			std::string mid;
+			std::vector<uint32_t> ssrcs;
+			std::vector<int> pts;
+			//Packets being dispatched to the stream, the handler runs without mutex_ locked.
+			std::atomic<int> active{ 0 };
+			std::atomic<bool> removed{ false };
+			//Learned ssrcs in learning order, guarded by mutex_.
+			std::deque<uint32_t> learned;
+		};
+		typedef std::shared_ptr<route_t> route_ptr;
+
+		void rebuild();
+		route_ptr find_route(packet_ptr packet, bool& learn);
+		void learn_ssrc(uint32_t ssrc, route_ptr route);
+
+	private:
+		std::shared_mutex mutex_;
+		std::mutex idle_mutex_;
+		std::condition_variable idle_cv_;
+		std::vector<route_ptr> routes_;
+		std::unordered_map<uint32_t, route_ptr> ssrcs_;
+		std::unordered_map<uint32_t, route_ptr> learned_ssrcs_;
+		std::unordered_map<std::string, route_ptr> mids_;
+		std::unordered_map<int, route_ptr> pts_;
+		uint8_t mid_ext_id_ = 0;
+	};
+
+}
@@ -15,6 +15,8 @@ namespace litertp {
 
 	transport::transport()
 	{
+		ice_key_local_.store(new stun_integrity_key(""));
+		ice_key_remote_.store(new stun_integrity_key(""));
 	}
 
 	transport::~transport()
@@ -38,6 +40,39 @@ namespace litertp {
 		active_ = false;
 	}
 
+	void transport::set_ice_pwd_local(const std::string& pwd)
+	{
+		ice_key_local_.store(new stun_integrity_key(pwd));
+	}
+
+	void transport::set_ice_pwd_remote(const std::string& pwd)
+	{
+		ice_key_remote_.store(new stun_integrity_key(pwd));
+	}
+
+	published<stun_integrity_key>::reader transport::ice_key_local() const
+	{
+		return published<stun_integrity_key>::reader(ice_key_local_);
+	}
+
+	published<stun_integrity_key>::reader transport::ice_key_remote() const
+	{
+		return published<stun_integrity_key>::reader(ice_key_remote_);
+	}
+
+	bool transport::send_rtp_packets(const std::vector<packet_ptr>& packets, const sockaddr* addr, int addr_size)
+	{
+		bool ret = true;
+		for (auto& packet : packets)
+		{
+			if (!send_rtp_packet(packet, addr, addr_size))
+			{
+				ret = false;
+			}
+		}
+		return ret;
+	}
+
 	bool transport::test_rtcp_packet(const uint8_t* data, int size, int* pt)
 	{
 		rtcp_header hdr = { 0 };
@@ -73,10 +108,16 @@ namespace litertp {
 			return false;
 		}
 
-		rtp_packet_event_.invoke(socket_, pkt, nullptr, 0);
+		dispatch_rtp_packet(pkt, nullptr, 0);
 		return true;
 	}
 
+	void transport::dispatch_rtp_packet(packet_ptr packet, const sockaddr* addr, int addr_size)
+	{
+		demux_.dispatch(socket_, packet, addr, addr_size);
+		rtp_packet_event_.invoke(socket_, packet, addr, addr_size);
+	}
+
 	bool transport::receive_rtcp_packet(const uint8_t* rtcp_packet, int size)
 	{
 		rtcp_header hdr = { 0 };
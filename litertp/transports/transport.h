@@ -10,8 +10,11 @@
 
 #include "../packet.h"
 #include "../litertp_def.h"
-#include "../stun/stun_message.h"
+#include "../stun/stun_view.h"
+#include "bundle_demux.h"
+#include "../util/published.hpp"
 
+#include <atomic>
 #include <memory>
 #include <thread>
 #include <sys2/socket.h>
@@ -36,7 +39,7 @@ namespace litertp {
 	public:
 		typedef void (*transport_rtp_packet)(void* ctx, std::shared_ptr<sys::socket> skt, packet_ptr packet, const sockaddr* addr, int addr_size);
 		typedef void (*transport_rtcp_packet)(void* ctx, std::shared_ptr<sys::socket> skt, uint16_t pt, const uint8_t* buffer, size_t size, const sockaddr* addr, int addr_size);
-		typedef void (*transport_stun_message)(void* ctx, std::shared_ptr<sys::socket> skt, const stun_message& msg, const sockaddr* addr, int addr_size);
+		typedef void (*transport_stun_message)(void* ctx, std::shared_ptr<sys::socket> skt, const stun_view& msg, const sockaddr* addr, int addr_size);
 
 		typedef void (*transport_disconnect)(void* ctx);
 
@@ -48,22 +51,36 @@ namespace litertp {
 		virtual void stop();
 
 		virtual bool send_rtp_packet(packet_ptr packet, const sockaddr* addr, int addr_size) = 0;
-		virtual bool send_rtcp_packet(const uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size) = 0;
+		//Send packets to one address together, return false if any is not sent.
+		virtual bool send_rtp_packets(const std::vector<packet_ptr>& packets, const sockaddr* addr, int addr_size);
+		//rtcp_data is protected in place, RTCP_PACKET_TAILROOM bytes after it must be writable.
+		virtual bool send_rtcp_packet(uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size) = 0;
 		virtual void send_stun_request(const sockaddr* addr, int addr_size, uint32_t priority)=0;
 
 		virtual bool enable_security(bool enabled)=0;
 		virtual std::string fingerprint() const= 0;
 
+		//Set an ice password, its stun integrity key is made here once and published to the stun paths.
+		void set_ice_pwd_local(const std::string& pwd);
+		void set_ice_pwd_remote(const std::string& pwd);
+		//Never null, the key of an empty password until one is set.
+		published<stun_integrity_key>::reader ice_key_local() const;
+		published<stun_integrity_key>::reader ice_key_remote() const;
+
 		bool test_rtcp_packet(const uint8_t* data, int size, int* pt);
 
 		bool receive_rtp_packet(const uint8_t* rtp_packet, int size);
 		bool receive_rtcp_packet(const uint8_t* rtcp_data, int size);
+	protected:
+		void dispatch_rtp_packet(packet_ptr packet, const sockaddr* addr, int addr_size);
 	public:
 
 		std::recursive_mutex mutex_;
 		bool active_ = false;
 		std::shared_ptr<sys::socket> socket_;
 
+		//Media streams receive rtp packets by demux_, rtp_packet_event_ is for other listeners.
+		bundle_demux demux_;
 		sys::mutex_callback<transport_rtp_packet> rtp_packet_event_;
 		sys::mutex_callback<transport_rtcp_packet> rtcp_packet_event_;
 		sys::mutex_callback<transport_stun_message> stun_message_event_;
@@ -71,6 +88,8 @@ namespace litertp {
 
 		sdp_type_t sdp_type_ = sdp_type_offer;
 		srtp_role_t srtp_role_ = srtp_role_server;
+		//ICE-lite, binding requests must be signed with the local password and are only answered.
+		std::atomic<bool> ice_lite_{ false };
 
 
 
@@ -79,12 +98,12 @@ namespace litertp {
 		int port_ = 0;
 
 		std::string ice_ufrag_remote_;
-		std::string ice_pwd_remote_;
 		std::string ice_ufrag_local_;
-		std::string ice_pwd_local_;
 		uint16_t local_ice_network_id_ = 1;
 		uint16_t local_ice_network_cost_ = 10;
-
+	private:
+		published<stun_integrity_key> ice_key_remote_;
+		published<stun_integrity_key> ice_key_local_;
 	};
 
 
@@ -48,18 +48,26 @@ namespace litertp {
 
 	bool transport_custom::send_rtp_packet(packet_ptr packet,const sockaddr* addr,int addr_size)
 	{
-		std::string b;
-		b.reserve(2048);
-		if (!packet->serialize(b))
+		const uint8_t* data = nullptr;
+		int size = packet->serialize_inplace(&data);
+		if (size >= 0)
+		{
+			send_event_.invoke(port_, 0, data, size);
+			return true;
+		}
+
+		uint8_t buf[2048];
+		size = packet->serialize(buf, sizeof(buf));
+		if (size < 0)
 		{
 			return false;
 		}
 
-		send_event_.invoke(port_, 0, (const uint8_t*)b.data(), b.size());
+		send_event_.invoke(port_, 0, buf, size);
 		return true;
 	}
 
-	bool transport_custom::send_rtcp_packet(const uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size)
+	bool transport_custom::send_rtcp_packet(uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size)
 	{
 		send_event_.invoke(port_, 1, rtcp_data, size);
 		return true;
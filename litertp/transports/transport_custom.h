@@ -33,7 +33,7 @@ namespace litertp {
 		virtual std::string fingerprint() const;
 
 		virtual bool send_rtp_packet(packet_ptr packet, const sockaddr* addr, int addr_size);
-		virtual bool send_rtcp_packet(const uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size);
+		virtual bool send_rtcp_packet(uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size);
 		virtual void send_stun_request(const sockaddr* addr, int addr_size, uint32_t priority);
 
 		
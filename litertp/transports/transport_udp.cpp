@@ -9,9 +9,11 @@
 #include "../proto/rtcp_header.h"
 #include "../log.h"
 #include "../global.h"
+#include "../stun/stun_writer.h"
 
 #include <sys2/util.h>
 #include <string.h>
+#include <stdio.h>
 
 namespace litertp {
 
@@ -45,6 +47,13 @@ namespace litertp {
 
 		socket_->set_recvbuf_size(1024 * 1024);
 		socket_->set_sendbuf_size(1024 * 1024);
+#ifdef LITERTP_SSL
+		if (dtls_)
+		{
+			// Wake up to check the handshake retransmission timer.
+			socket_->set_timeout(100);
+		}
+#endif
 
 		receiver_ = new std::thread(&transport_udp::run_recever, this);
 
@@ -55,25 +64,27 @@ namespace litertp {
 	{
 		transport::stop();
 
-		socket_.reset();
-
+		// Wake up the receiver, the socket is released after no thread uses it.
+		if (socket_)
+		{
+			socket_->shutdown(sys::shutdown_how_t::sd_both);
+		}
 
 		if (receiver_) {
 			receiver_->join();
 			delete receiver_;
 			receiver_ = nullptr;
 		}
+#ifdef LITERTP_SSL
+		wait_dtls();
+#endif
+
+		socket_.reset();
 
 
 #ifdef LITERTP_SSL
-		if (srtp_out_) {
-			srtp_dealloc(srtp_out_);
-			srtp_out_ = nullptr;
-		}
-		if (srtp_in_) {
-			srtp_dealloc(srtp_in_);
-			srtp_in_ = nullptr;
-		}
+		srtp_out_.clear();
+		srtp_in_.clear();
 #endif
 	}
 
@@ -85,11 +96,18 @@ namespace litertp {
 			{
 				dtls_ = g_instance.get_dtls();
 			}
+			if (dtls_ && socket_)
+			{
+				socket_->set_timeout(100);
+			}
 			
 			return dtls_ != nullptr;
 		}
 		else
 		{
+#ifdef LITERTP_SSL
+			wait_dtls();
+#endif
 			dtls_.reset();
 			return true;
 		}
@@ -106,39 +124,230 @@ namespace litertp {
 
 	bool transport_udp::send_rtp_packet(packet_ptr packet,const sockaddr* addr,int addr_size)
 	{
-		std::string b;
-		b.reserve(2048); // size for srtp
-		if (!packet->serialize(b))
+		uint8_t buf[2048];
+#ifdef LITERTP_SSL
+		// The keys are read once for the packet.
+		int trailer = 0;
+		uint32_t keys_generation = 0;
+		if (srtp_out_.current_keys(&trailer, &keys_generation))
+		{
+			const uint8_t* data = nullptr;
+			bool protect = false;
+			int size = prepare_srtp_packet(packet, trailer, keys_generation, buf, sizeof(buf), &data, &protect);
+			if (size < 0)
+			{
+				return false;
+			}
+
+			if (protect)
+			{
+				uint32_t generation = 0;
+				auto ret = srtp_out_.protect((void*)data, &size, &generation);
+				if (data != buf)
+				{
+					packet->seal(generation, ret == srtp_err_status_ok ? size : -1);
+				}
+				if (ret != srtp_err_status_ok)
+				{
+					LOGE("srtp_protect err = %d", ret);
+					return false;
+				}
+			}
+			return socket_->sendto((const char*)data, size, addr, addr_size) >= 0;
+		}
+#endif
+
+		// The header is written into the packet headroom, payload is not copied again.
+		// Packets sharing a payload have no headroom of their own and are serialized into buf.
+		packet->mark_sent();
+		const uint8_t* data = nullptr;
+		uint32_t generation = 0;
+		if (packet->sealed(&generation, &data) >= 0)
 		{
 			return false;
 		}
+		int size = packet->serialize_inplace(&data);
+		if (size < 0)
+		{
+			size = packet->serialize(buf, sizeof(buf));
+			if (size < 0)
+			{
+				return false;
+			}
+			data = buf;
+		}
 
-		int size = b.size();
+		int r = socket_->sendto((const char*)data, size, addr,addr_size);
+		return r >= 0;
+	}
 
 #ifdef LITERTP_SSL
-		if (srtp_out_)
+	int transport_udp::prepare_srtp_packet(packet_ptr packet, int trailer, uint32_t keys_generation, uint8_t* slot, size_t slot_size, const uint8_t** data, bool* protect)
+	{
+		// A retransmission sends the wire image again, libsrtp would make the same bytes.
+		uint32_t generation = 0;
+		int size = packet->sealed(&generation, data);
+		if (size >= 0)
 		{
-			std::unique_lock<std::recursive_mutex> lk(mutex_);
-			auto ret = srtp_protect(srtp_out_, (void*)b.data(), &size);
-			if (ret != srtp_err_status_ok)
+			*protect = false;
+			if (generation != keys_generation)
 			{
-				LOGE("srtp_protect err = %d", ret);
-				return false;
+				// The payload is encrypted with old keys, it can not be protected again.
+				return -1;
+			}
+			return size;
+		}
+
+		*protect = true;
+		if (packet->mark_sent() && packet->begin_seal(trailer))
+		{
+			size = packet->serialize_inplace(data);
+			if (size >= 0)
+			{
+				return size;
 			}
+			packet->seal(0, -1);
 		}
+
+		// The packet kept plain for nack is protected on a copy.
+		*data = slot;
+		return packet->serialize(slot, slot_size - SRTP_MAX_TRAILER_LEN);
+	}
 #endif
 
-		int r = socket_->sendto(b.data(), size, addr,addr_size);
-		return r >= 0;
+	bool transport_udp::send_rtp_packets(const std::vector<packet_ptr>& packets, const sockaddr* addr, int addr_size)
+	{
+		if (packets.size() <= 1)
+		{
+			return transport::send_rtp_packets(packets, addr, addr_size);
+		}
+
+		// Slots for packets which are not sent from their own memory, kept by the thread.
+		thread_local std::vector<uint8_t> scratch;
+		if (scratch.size() < packets.size() * 2048)
+		{
+			scratch.resize(packets.size() * 2048);
+		}
+
+		std::vector<const char*> buffers;
+		std::vector<int> sizes;
+		buffers.reserve(packets.size());
+		sizes.reserve(packets.size());
+
+		bool ret = true;
+#ifdef LITERTP_SSL
+		int trailer = 0;
+		uint32_t keys_generation = 0;
+		bool secure = srtp_out_.current_keys(&trailer, &keys_generation);
+		// Index in buffers of packets to protect, and the packet to seal if it is done in place.
+		std::vector<int> protects;
+		std::vector<packet*> seals;
+#else
+		bool secure = false;
+#endif
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			uint8_t* slot = scratch.data() + i * 2048;
+			const uint8_t* data = nullptr;
+			int size = -1;
+			if (secure)
+			{
+#ifdef LITERTP_SSL
+				bool protect = false;
+				size = prepare_srtp_packet(packets[i], trailer, keys_generation, slot, 2048, &data, &protect);
+				if (size >= 0 && protect)
+				{
+					protects.push_back((int)buffers.size());
+					seals.push_back(data != slot ? packets[i].get() : nullptr);
+				}
+#endif
+			}
+			else
+			{
+				packets[i]->mark_sent();
+				uint32_t generation = 0;
+				if (packets[i]->sealed(&generation, &data) < 0)
+				{
+					size = packets[i]->serialize_inplace(&data);
+					if (size < 0)
+					{
+						size = packets[i]->serialize(slot, 2048);
+						data = slot;
+					}
+				}
+			}
+
+			if (size < 0)
+			{
+				ret = false;
+				continue;
+			}
+			buffers.push_back((const char*)data);
+			sizes.push_back(size);
+		}
+
+#ifdef LITERTP_SSL
+		if (protects.size() > 0)
+		{
+			// Packets of a batch are usually of one stream, they are protected back to back.
+			std::vector<void*> rtps(protects.size());
+			std::vector<int> rtp_sizes(protects.size());
+			std::vector<srtp_err_status_t> results(protects.size());
+			std::vector<uint32_t> generations(protects.size());
+			for (size_t i = 0; i < protects.size(); i++)
+			{
+				rtps[i] = (void*)buffers[protects[i]];
+				rtp_sizes[i] = sizes[protects[i]];
+			}
+			srtp_out_.protect(rtps.data(), rtp_sizes.data(), (int)rtps.size(), results.data(), generations.data());
+
+			for (size_t i = 0; i < protects.size(); i++)
+			{
+				bool ok = results[i] == srtp_err_status_ok;
+				if (seals[i])
+				{
+					seals[i]->seal(generations[i], ok ? rtp_sizes[i] : -1);
+				}
+				if (!ok)
+				{
+					LOGE("srtp_protect err = %d", results[i]);
+					ret = false;
+					buffers[protects[i]] = nullptr;
+					continue;
+				}
+				sizes[protects[i]] = rtp_sizes[i];
+			}
+
+			size_t n = 0;
+			for (size_t i = 0; i < buffers.size(); i++)
+			{
+				if (!buffers[i])
+				{
+					continue;
+				}
+				buffers[n] = buffers[i];
+				sizes[n] = sizes[i];
+				n++;
+			}
+			buffers.resize(n);
+			sizes.resize(n);
+		}
+#endif
+
+		if (buffers.empty())
+		{
+			return false;
+		}
+		int sent = socket_->sendto_batch(buffers.data(), sizes.data(), (int)buffers.size(), addr, addr_size);
+		return ret && sent == (int)buffers.size();
 	}
 
-	bool transport_udp::send_rtcp_packet(const uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size)
+	bool transport_udp::send_rtcp_packet(uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size)
 	{
 	#ifdef LITERTP_SSL
-			if (srtp_out_)
+			if (srtp_out_.is_active())
 			{
-				std::unique_lock<std::recursive_mutex> lk(mutex_);
-				auto ret = srtp_protect_rtcp(srtp_out_, (void*)rtcp_data, &size);
+				auto ret = srtp_out_.protect_rtcp(rtcp_data, &size);
 				if (ret != srtp_err_status_ok)
 				{
 					LOGE("srtp_protect err = %d", ret);
@@ -157,15 +366,94 @@ namespace litertp {
 
 	void transport_udp::run_recever()
 	{
+		// Datagrams already queued are received together.
+		const int batch = 16;
+		std::vector<char> storage(batch * 2048);
+		char* buffers[batch];
+		int sizes[batch];
+		sockaddr_storage addrs[batch];
+		socklen_t addr_sizes[batch];
+		for (int i = 0; i < batch; i++)
+		{
+			buffers[i] = storage.data() + i * 2048;
+		}
+
 		while (active_)
 		{
-			char buffer[2048] = { 0 };
-			sockaddr_storage addr = { 0 };
-			socklen_t addr_size = sizeof(addr);
-			int size = socket_->recvfrom(buffer, 2048, (sockaddr*)&addr, &addr_size);
-			if (size >= 0)
+			int count = socket_->recvfrom_batch(buffers, 2048, sizes, addrs, addr_sizes, batch);
+			if (count > 0)
 			{
-				on_data_received_event((const uint8_t*)buffer, size, (sockaddr*)&addr, addr_size);
+				on_data_received_batch(buffers, sizes, addrs, addr_sizes, count);
+			}
+#ifdef LITERTP_SSL
+			check_dtls_timer();
+#endif
+		}
+	}
+
+	void transport_udp::on_data_received_batch(char* const* buffers, int* sizes, const sockaddr_storage* addrs, const socklen_t* addr_sizes, int count)
+	{
+#ifdef LITERTP_SSL
+		if (count > 1 && srtp_in_.is_active())
+		{
+			// Unprotect the srtp packets of the batch back to back, then handle all in order.
+			void* srtps[16];
+			int srtp_sizes[16];
+			int index[16];
+			srtp_err_status_t results[16];
+			int n = 0;
+			for (int i = 0; i < count && n < 16; i++)
+			{
+				int pt = 0;
+				if (sizes[i] > 0 && test_message((uint8_t)buffers[i][0]) == proto_rtp && !test_rtcp_packet((const uint8_t*)buffers[i], sizes[i], &pt))
+				{
+					srtps[n] = buffers[i];
+					srtp_sizes[n] = sizes[i];
+					index[n] = i;
+					n++;
+				}
+			}
+
+			bool plain[16] = { false };
+			if (n > 0)
+			{
+				srtp_in_.unprotect(srtps, srtp_sizes, n, results);
+				for (int j = 0; j < n; j++)
+				{
+					if (results[j] != srtp_err_status_ok)
+					{
+						LOGE("srtp_unprotect failed err=%d\n", results[j]);
+						sizes[index[j]] = -1;
+						continue;
+					}
+					sizes[index[j]] = srtp_sizes[j];
+					plain[index[j]] = true;
+				}
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				if (sizes[i] <= 0)
+				{
+					continue;
+				}
+				if (plain[i])
+				{
+					on_plain_rtp_data((const uint8_t*)buffers[i], sizes[i], (const sockaddr*)&addrs[i], addr_sizes[i]);
+				}
+				else
+				{
+					on_data_received_event((const uint8_t*)buffers[i], sizes[i], (const sockaddr*)&addrs[i], addr_sizes[i]);
+				}
+			}
+			return;
+		}
+#endif
+		for (int i = 0; i < count; i++)
+		{
+			if (sizes[i] > 0)
+			{
+				on_data_received_event((const uint8_t*)buffers[i], sizes[i], (const sockaddr*)&addrs[i], addr_sizes[i]);
 			}
 		}
 	}
@@ -180,7 +468,7 @@ namespace litertp {
 		else if (proto == proto_dtls)
 		{
 #ifdef LITERTP_SSL
-			on_dtls(data, size, (const sockaddr*)addr, addr_size);
+			post_dtls(dtls_task_record, data, size, (const sockaddr*)addr, addr_size);
 #endif
 		}
 		else if (proto == proto_rtp)
@@ -191,6 +479,152 @@ namespace litertp {
 
 
 #ifdef LITERTP_SSL
+	void transport_udp::post_dtls(dtls_task_type_t type, const uint8_t* data, int size, const sockaddr* addr, int addr_size)
+	{
+		if (!dtls_)
+		{
+			return;
+		}
+
+		dtls_task_t task;
+		task.type = type;
+		if (data && size > 0)
+		{
+			task.data.assign((const char*)data, size);
+		}
+		memset(&task.addr, 0, sizeof(task.addr));
+		task.addr_size = 0;
+		if (addr && addr_size > 0 && addr_size <= (int)sizeof(task.addr))
+		{
+			memcpy(&task.addr, addr, addr_size);
+			task.addr_size = addr_size;
+		}
+
+		{
+			std::unique_lock<std::mutex> lk(dtls_mutex_);
+			// The peer retransmits a dropped record, keep a flood from growing the queue.
+			if (!active_ || dtls_tasks_.size() >= 64)
+			{
+				return;
+			}
+			dtls_tasks_.push_back(std::move(task));
+			if (dtls_running_)
+			{
+				return;
+			}
+			dtls_running_ = true;
+		}
+
+		g_instance.post_crypto_task([this]() {
+			run_dtls();
+			});
+	}
+
+	void transport_udp::run_dtls()
+	{
+		for (;;)
+		{
+			dtls_task_t task;
+			{
+				std::unique_lock<std::mutex> lk(dtls_mutex_);
+				if (dtls_tasks_.empty() || !active_)
+				{
+					dtls_tasks_.clear();
+					dtls_running_ = false;
+					dtls_cond_.notify_all();
+					return;
+				}
+				task = std::move(dtls_tasks_.front());
+				dtls_tasks_.pop_front();
+			}
+
+			const sockaddr* addr = (const sockaddr*)&task.addr;
+			if (task.type == dtls_task_record)
+			{
+				on_dtls((const uint8_t*)task.data.data(), (int)task.data.size(), addr, task.addr_size);
+			}
+			else if (task.type == dtls_task_connect)
+			{
+				on_dtls_connect(addr, task.addr_size);
+			}
+			else
+			{
+				on_dtls_timeout((const sockaddr*)&dtls_peer_, dtls_peer_size_);
+			}
+		}
+	}
+
+	void transport_udp::wait_dtls()
+	{
+		// The transport must outlive a running handshake step.
+		std::unique_lock<std::mutex> lk(dtls_mutex_);
+		dtls_tasks_.clear();
+		dtls_cond_.wait(lk, [this]() { return !dtls_running_; });
+		dtls_timer_at_ = 0;
+	}
+
+	void transport_udp::on_dtls_connect(const sockaddr* addr, int addr_size)
+	{
+		if (!dtls_ || handshake)
+		{
+			return;
+		}
+
+		std::string req = dtls_->connect();
+		if (req.size() > 0) {
+			socket_->sendto(req.data(), req.size(), addr, addr_size);
+		}
+		update_dtls_timer(addr, addr_size);
+	}
+
+	void transport_udp::on_dtls_timeout(const sockaddr* addr, int addr_size)
+	{
+		if (!dtls_ || handshake || addr_size <= 0)
+		{
+			return;
+		}
+
+		std::string rsp = dtls_->handle_timeout();
+		if (rsp.size() > 0)
+		{
+			socket_->sendto(rsp.data(), rsp.size(), addr, addr_size);
+		}
+		update_dtls_timer(addr, addr_size);
+	}
+
+	void transport_udp::update_dtls_timer(const sockaddr* addr, int addr_size)
+	{
+		if (addr != (const sockaddr*)&dtls_peer_ && addr_size > 0 && addr_size <= (int)sizeof(dtls_peer_))
+		{
+			memcpy(&dtls_peer_, addr, addr_size);
+			dtls_peer_size_ = addr_size;
+		}
+
+		int ms = handshake ? -1 : dtls_->get_timeout();
+		if (ms < 0)
+		{
+			dtls_timer_at_ = 0;
+			return;
+		}
+		auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		dtls_timer_at_ = now + ms;
+	}
+
+	void transport_udp::check_dtls_timer()
+	{
+		int64_t at = dtls_timer_at_;
+		if (at == 0)
+		{
+			return;
+		}
+		auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		if (now < at || !dtls_timer_at_.compare_exchange_strong(at, 0))
+		{
+			return;
+		}
+		post_dtls(dtls_task_timeout, nullptr, 0, nullptr, 0);
+	}
+
 	void transport_udp::on_dtls(const uint8_t* data, int size, const sockaddr* addr, int addr_size)
 	{
 		if (!dtls_)
@@ -221,106 +655,68 @@ namespace litertp {
 				litertp::dtls_info_t info = { 0 };
 				if (dtls_->export_key_material(&info))
 				{
-					memset(&srtp_in_policy_, 0, sizeof(srtp_in_policy_));
-					memset(&srtp_out_policy_, 0, sizeof(srtp_out_policy_));
-
-					srtp_out_policy_.allow_repeat_tx = 1; // for retransmissions 
-
-					//srtp_crypto_policy_set_aes_gcm_128_8_auth(&srtp_in_policy_.rtp);
-					//srtp_crypto_policy_set_aes_gcm_128_8_auth(&srtp_in_policy_.rtcp);					
-					srtp_crypto_policy_set_from_profile_for_rtp(&srtp_in_policy_.rtp, (srtp_profile_t)info.profile_id);
-					srtp_crypto_policy_set_from_profile_for_rtcp(&srtp_in_policy_.rtcp, (srtp_profile_t)info.profile_id);
-
-					srtp_in_policy_.ssrc.type = ssrc_any_inbound;
-					if (srtp_role_ == srtp_role_client)
-					{
-						srtp_in_policy_.key = info.server_key;
-					}
-					else
-					{
-						srtp_in_policy_.key = info.client_key;
-					}
-
-					//srtp_crypto_policy_set_rtp_default(&srtp_out_policy_.rtp);
-					//srtp_crypto_policy_set_rtcp_default(&srtp_out_policy_.rtcp);
-					srtp_crypto_policy_set_from_profile_for_rtp(&srtp_out_policy_.rtp, (srtp_profile_t)info.profile_id);
-					srtp_crypto_policy_set_from_profile_for_rtcp(&srtp_out_policy_.rtcp, (srtp_profile_t)info.profile_id);
-					srtp_out_policy_.ssrc.type = ssrc_any_outbound;
+					srtp_profile_t profile = (srtp_profile_t)info.profile_id;
 					if (srtp_role_ == srtp_role_client)
 					{
-						srtp_out_policy_.key = info.client_key;
+						srtp_in_.set_keys(profile, info.server_key, info.key_length);
+						srtp_out_.set_keys(profile, info.client_key, info.key_length);
 					}
 					else
 					{
-						srtp_out_policy_.key = info.server_key;
-					}
-
-
-					std::unique_lock<std::recursive_mutex> lk(mutex_);
-
-					if (srtp_in_)
-					{
-						srtp_dealloc(srtp_in_);
-						srtp_in_ = nullptr;
-					}
-					srtp_err_status_t r1 = srtp_create(&srtp_in_, &srtp_in_policy_);
-					
-					if (srtp_out_) 
-					{
-						srtp_dealloc(srtp_out_);
-						srtp_out_ = nullptr;
+						srtp_in_.set_keys(profile, info.client_key, info.key_length);
+						srtp_out_.set_keys(profile, info.server_key, info.key_length);
 					}
-					r1 = srtp_create(&srtp_out_, &srtp_out_policy_);
 
 					handshake = true;
 				}
 			}
 		}
 
+		update_dtls_timer(addr, addr_size);
 	}
 #endif
 
 	void transport_udp::on_stun_message(const uint8_t* data, int size, const sockaddr* addr, int addr_size)
 	{
-		stun_message msg;
-		uint32_t fp = 0;
-		if (!msg.deserialize((const char*)data, size, fp)) {
+		stun_view msg;
+		if (!msg.parse(data, size)) {
 			return;
 		}
 
-		stun_message_event_.invoke(socket_, msg, addr, addr_size);
-
-		if (msg.type_ == stun_message_type_binding_response)
+		bool ice_lite = ice_lite_;
+		if (ice_lite)
 		{
-#ifdef LITERTP_SSL
-			if (msg.type_ == stun_message_type_binding_request)
+			// A lite agent never sends checks, so only signed requests are taken.
+			if (msg.type() != stun_message_type_binding_request || !msg.check_integrity(*ice_key_local()))
 			{
-				if (dtls_ && srtp_role_ == srtp_role_client)
-				{
-					std::string req = dtls_->connect();
-					if (req.size() > 0) {
-						socket_->sendto(req.data(), req.size(), addr, addr_size);
-					}
-				}
+				return;
 			}
-#endif
 		}
-		else if (msg.type_ == stun_message_type_binding_request)
-		{
-			stun_message rsp;
-			rsp.type_ = stun_message_type_binding_response;
-			memcpy(rsp.transaction_id_, msg.transaction_id_, 12);
-
-
-
-			auto attr = stun_attribute_xor_mapped_address::create(addr, (const char*)msg.transaction_id_);
-			rsp.attributes_.emplace_back(stun_attribute_type_xor_mapped_address, attr.serialize());
 
+		stun_message_event_.invoke(socket_, msg, addr, addr_size);
 
-			std::string s = rsp.serialize(ice_pwd_local_);
-			socket_->sendto(s.data(), s.size(), addr, addr_size);
+		if (msg.type() == stun_message_type_binding_request)
+		{
+			uint8_t buf[STUN_WRITER_BUFFER_SIZE];
+			stun_writer rsp(buf, sizeof(buf));
+			rsp.begin(stun_message_type_binding_response, msg.transaction_id());
+			rsp.add_xor_mapped_address(addr);
+			rsp.finish(*ice_key_local());
+			if (rsp.size() > 0) {
+				socket_->sendto((const char*)rsp.data(), rsp.size(), addr, addr_size);
+			}
 
-			this->send_stun_request(addr, addr_size, 1853766911);
+			if (!ice_lite)
+			{
+				this->send_stun_request(addr, addr_size, 1853766911);
+			}
+#ifdef LITERTP_SSL
+			else if (dtls_ && !handshake && srtp_role_ == srtp_role_client)
+			{
+				// No request is sent by a lite agent, so a signed request from the peer starts the handshake.
+				post_dtls(dtls_task_connect, nullptr, 0, addr, addr_size);
+			}
+#endif
 		}
 	}
 
@@ -330,9 +726,9 @@ namespace litertp {
 		if (this->test_rtcp_packet(data, size, &pt))
 		{
 #ifdef LITERTP_SSL
-			if (srtp_in_)
+			if (srtp_in_.is_active())
 			{
-				srtp_err_status_t ret = srtp_unprotect_rtcp(srtp_in_, (void*)data, &size);
+				srtp_err_status_t ret = srtp_in_.unprotect_rtcp((void*)data, &size);
 				if (ret != srtp_err_status_ok)
 				{
 					LOGE("srtp_unprotect failed err=%d\n", ret);
@@ -345,9 +741,9 @@ namespace litertp {
 		else
 		{
 #ifdef LITERTP_SSL
-			if (srtp_in_)
+			if (srtp_in_.is_active())
 			{
-				srtp_err_status_t ret = srtp_unprotect(srtp_in_, (void*)data, &size);
+				srtp_err_status_t ret = srtp_in_.unprotect((void*)data, &size);
 				if (ret != srtp_err_status_ok)
 				{
 					LOGE("srtp_unprotect failed err=%d\n", ret);
@@ -355,10 +751,15 @@ namespace litertp {
 				}
 			}
 #endif
-			auto pkt = std::make_shared<packet>();
-			if (pkt->parse((const uint8_t*)data, size)) {
-				rtp_packet_event_.invoke(socket_, pkt, addr, addr_size);
-			}
+			on_plain_rtp_data(data, size, addr, addr_size);
+		}
+	}
+
+	void transport_udp::on_plain_rtp_data(const uint8_t* data, int size, const sockaddr* addr, int addr_size)
+	{
+		auto pkt = std::make_shared<packet>();
+		if (pkt->parse((const uint8_t*)data, size)) {
+			dispatch_rtp_packet(pkt, addr, addr_size);
 		}
 	}
 
@@ -383,44 +784,41 @@ namespace litertp {
 
 	void transport_udp::send_stun_request(const sockaddr* addr, int addr_size, uint32_t priority)
 	{
-		stun_message req;
-		req.type_ = stun_message_type_binding_request;
-		req.make_transaction_id();
-		req.attributes_.emplace_back(stun_attribute_type_username, ice_ufrag_remote_ + ":" + ice_ufrag_local_);
-
-		std::string net;
-		uint16_t net_id = local_ice_network_id_;
-		net_id = sys::socket::hton16(net_id);
-		net.append((const char*)&net_id, 2);
-		uint16_t net_cost = this->local_ice_network_cost_;
-		net_cost = sys::socket::hton16(net_cost);
-		net.append((const char*)&net_cost, 2);
-		req.attributes_.emplace_back(stun_attribute_type_goog_network_info, net);
+		// username is "remote:local", ufrags are at most 256 characters.
+		char username[513];
+		int username_size = snprintf(username, sizeof(username), "%s:%s", ice_ufrag_remote_.c_str(), ice_ufrag_local_.c_str());
+		if (username_size < 0 || username_size >= (int)sizeof(username)) {
+			return;
+		}
+
+		uint8_t tid[12];
+		stun_writer::make_transaction_id(tid);
+
+		uint8_t buf[STUN_WRITER_BUFFER_SIZE];
+		stun_writer req(buf, sizeof(buf));
+		req.begin(stun_message_type_binding_request, tid);
+		req.add_attribute(stun_attribute_type_username, username, username_size);
+		req.add_uint32(stun_attribute_type_goog_network_info, ((uint32_t)local_ice_network_id_ << 16) | local_ice_network_cost_);
 
 		uint64_t v = sys::util::random_number<uint64_t>(0, 0xFFFFFFFFFFFFFFFF);
-		v = sys::socket::hton64(v);
 		if (sdp_type_ == sdp_type_offer) {
-			req.attributes_.emplace_back(stun_attribute_type_ice_controlling, (const char*)&v, sizeof(v));
+			req.add_uint64(stun_attribute_type_ice_controlling, v);
 		}
 		else {
-			req.attributes_.emplace_back(stun_attribute_type_ice_controlled, (const char*)&v, sizeof(v));
+			req.add_uint64(stun_attribute_type_ice_controlled, v);
 		}
 
-		req.attributes_.emplace_back(stun_attribute_type_use_candidate, "");
-
-		priority = sys::socket::hton32(priority);
-		req.attributes_.emplace_back(stun_attribute_type_priority, (const char*)&priority, sizeof(priority));
-
-		std::string sreq = req.serialize(ice_pwd_remote_);
-		socket_->sendto(sreq.data(), sreq.size(), addr, addr_size);
+		req.add_attribute(stun_attribute_type_use_candidate, nullptr, 0);
+		req.add_uint32(stun_attribute_type_priority, priority);
+		req.finish(*ice_key_remote());
+		if (req.size() > 0) {
+			socket_->sendto((const char*)req.data(), req.size(), addr, addr_size);
+		}
 
 #ifdef LITERTP_SSL
 		if (dtls_ && !handshake && srtp_role_ == srtp_role_client)
 		{
-			std::string req = dtls_->connect();
-			if (req.size() > 0) {
-				socket_->sendto(req.data(), req.size(), addr, addr_size);
-			}
+			post_dtls(dtls_task_connect, nullptr, 0, addr, addr_size);
 		}
 #endif
 	}
@@ -13,8 +13,13 @@
 #ifdef LITERTP_SSL
 #include <srtp2/srtp.h>
 #include "../dtls/dtls.h"
+#include "../dtls/srtp_context.h"
 #endif
 
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+
 
 
 
@@ -23,6 +28,23 @@ namespace litertp {
 
 
 
+#ifdef LITERTP_SSL
+	typedef enum dtls_task_type_t
+	{
+		dtls_task_record,
+		dtls_task_connect,
+		dtls_task_timeout,
+	}dtls_task_type_t;
+
+	typedef struct _dtls_task_t
+	{
+		dtls_task_type_t type;
+		std::string data;
+		sockaddr_storage addr;
+		int addr_size;
+	}dtls_task_t;
+#endif
+
 	class transport_udp:public transport
 	{
 	public:
@@ -37,18 +59,33 @@ namespace litertp {
 		virtual std::string fingerprint() const;
 
 		virtual bool send_rtp_packet(packet_ptr packet, const sockaddr* addr, int addr_size);
-		virtual bool send_rtcp_packet(const uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size);
+		virtual bool send_rtp_packets(const std::vector<packet_ptr>& packets, const sockaddr* addr, int addr_size);
+		virtual bool send_rtcp_packet(uint8_t* rtcp_data, int size, const sockaddr* addr, int addr_size);
 		virtual void send_stun_request(const sockaddr* addr, int addr_size, uint32_t priority);
 
 		
 	private:
 		void run_recever();
 		void on_data_received_event(const uint8_t* data, int size, const sockaddr* addr, int addr_size);
+		void on_data_received_batch(char* const* buffers, int* sizes, const sockaddr_storage* addrs, const socklen_t* addr_sizes, int count);
 #ifdef LITERTP_SSL
+		//Handshake steps are queued in order and run on the crypto workers, one at a time.
+		void post_dtls(dtls_task_type_t type, const uint8_t* data, int size, const sockaddr* addr, int addr_size);
+		void run_dtls();
 		void on_dtls(const uint8_t* data, int size, const sockaddr* addr, int addr_size);
+		void on_dtls_connect(const sockaddr* addr, int addr_size);
+		void on_dtls_timeout(const sockaddr* addr, int addr_size);
+		void update_dtls_timer(const sockaddr* addr, int addr_size);
+		void check_dtls_timer();
+		void wait_dtls();
+		//Point data to the bytes to send, protect is set if they are not protected yet.
+		//A packet sent the first time is serialized in place to be protected on its own buffer,
+		//others are serialized into slot.
+		int prepare_srtp_packet(packet_ptr packet, int trailer, uint32_t keys_generation, uint8_t* slot, size_t slot_size, const uint8_t** data, bool* protect);
 #endif
 		void on_stun_message(const uint8_t* data, int size, const sockaddr* addr, int addr_size);
 		void on_rtp_data(const uint8_t* data, int size, const sockaddr* addr, int addr_size);
+		void on_plain_rtp_data(const uint8_t* data, int size, const sockaddr* addr, int addr_size);
 
 
 
@@ -58,13 +95,22 @@ namespace litertp {
 
 		std::thread* receiver_ = nullptr;
 
-		bool handshake = false;
+		std::atomic<bool> handshake = false;
 #ifdef LITERTP_SSL
 		dtls_ptr dtls_;
-		srtp_t srtp_in_ = nullptr;
-		srtp_policy_t srtp_in_policy_ = { ssrc_undefined };
-		srtp_t srtp_out_ = nullptr;
-		srtp_policy_t srtp_out_policy_ = { ssrc_undefined };
+		//Keys are installed by the dtls worker, senders and the receiver never take the transport lock.
+		srtp_context srtp_in_{ true };
+		srtp_context srtp_out_{ false };
+
+		std::mutex dtls_mutex_;
+		std::condition_variable dtls_cond_;
+		std::deque<dtls_task_t> dtls_tasks_;
+		bool dtls_running_ = false;
+
+		//Steady clock ms to retransmit the handshake, 0 if no timer.
+		std::atomic<int64_t> dtls_timer_at_ = 0;
+		sockaddr_storage dtls_peer_ = { 0 };
+		int dtls_peer_size_ = 0;
 #endif
 	};
 
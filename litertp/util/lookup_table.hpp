@@ -0,0 +1,135 @@
+/**
+ * @file lookup_table.hpp
+ * @brief Read mostly table keyed by ssrc or payload type.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+#include <sys2/epoch.h>
+
+namespace litertp {
+
+    // An open addressed table, it is never modified after built.
+    // Writers build a new one under their own lock and publish it, readers take the
+    // current one by an acquire load in an epoch read section, so packet paths neither
+    // lock the owner's mutex nor touch a reference count of the table.
+    template <class V>
+    class lookup_table
+    {
+        struct table_t
+        {
+            uint32_t mask = 0;
+            std::vector<uint32_t> keys;
+            std::vector<V> values;
+            std::vector<uint8_t> used;
+        };
+
+    public:
+        lookup_table() = default;
+        lookup_table(const lookup_table&) = delete;
+        lookup_table& operator=(const lookup_table&) = delete;
+
+        ~lookup_table()
+        {
+            delete table_.load(std::memory_order_relaxed);
+        }
+
+        bool find(uint32_t key, V& value) const
+        {
+            sys::epoch::guard g(epoch_);
+            const table_t* table = table_.load(std::memory_order_acquire);
+            if (!table)
+            {
+                return false;
+            }
+
+            for (uint32_t i = hash(key) & table->mask;; i = (i + 1) & table->mask)
+            {
+                if (!table->used[i])
+                {
+                    return false;
+                }
+                if (table->keys[i] == key)
+                {
+                    value = table->values[i];
+                    return true;
+                }
+            }
+        }
+
+        bool contains(uint32_t key) const
+        {
+            V value;
+            return find(key, value);
+        }
+
+        // Replace all entries, a later duplicated key wins.
+        void assign(const std::vector<std::pair<uint32_t, V>>& items)
+        {
+            if (items.empty())
+            {
+                publish(nullptr);
+                return;
+            }
+
+            // Keep load factor under 1/2, probes stay short.
+            uint32_t capacity = 8;
+            while (capacity < items.size() * 2)
+            {
+                capacity <<= 1;
+            }
+
+            table_t* table = new table_t();
+            table->mask = capacity - 1;
+            table->keys.resize(capacity);
+            table->values.resize(capacity);
+            table->used.resize(capacity);
+            for (auto& item : items)
+            {
+                uint32_t i = hash(item.first) & table->mask;
+                while (table->used[i] && table->keys[i] != item.first)
+                {
+                    i = (i + 1) & table->mask;
+                }
+                table->used[i] = 1;
+                table->keys[i] = item.first;
+                table->values[i] = item.second;
+            }
+            publish(table);
+        }
+
+        void clear()
+        {
+            publish(nullptr);
+        }
+
+    private:
+        static uint32_t hash(uint32_t key)
+        {
+            // ssrc are random but payload types are small and close, mix the bits.
+            return (key * 0x9E3779B1u) >> 16 ^ key;
+        }
+
+        void publish(const table_t* table)
+        {
+            const table_t* old = table_.exchange(table, std::memory_order_acq_rel);
+            if (old)
+            {
+                epoch_.retire([old]() { delete old; });
+            }
+        }
+
+    private:
+        mutable sys::epoch epoch_;
+        std::atomic<const table_t*> table_{ nullptr };
+    };
+
+}
@@ -0,0 +1,69 @@
+/**
+ * @file published.hpp
+ * @brief Immutable value published to packet paths.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include <atomic>
+
+#include <sys2/epoch.h>
+
+namespace litertp {
+
+    // Writers build a new value under their own lock and store it, readers look at the
+    // current one in place by an acquire load in an epoch read section.
+    // The old value is released when no reader can see it.
+    template <class T>
+    class published
+    {
+    public:
+        // Valid until the reader is destroyed, get returns null if nothing is stored.
+        class reader
+        {
+        public:
+            explicit reader(const published& p)
+                :g_(p.epoch_), value_(p.current_.load(std::memory_order_acquire))
+            {
+            }
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+
+            const T* get() const { return value_; }
+            const T* operator->() const { return value_; }
+            const T& operator*() const { return *value_; }
+            explicit operator bool() const { return value_ != nullptr; }
+        private:
+            sys::epoch::guard g_;
+            const T* value_;
+        };
+
+        published() = default;
+        published(const published&) = delete;
+        published& operator=(const published&) = delete;
+
+        ~published()
+        {
+            delete current_.load(std::memory_order_relaxed);
+        }
+
+        // Takes the ownership of value, null clears.
+        void store(const T* value)
+        {
+            const T* old = current_.exchange(value, std::memory_order_acq_rel);
+            if (old)
+            {
+                epoch_.retire([old]() { delete old; });
+            }
+        }
+
+    private:
+        mutable sys::epoch epoch_;
+        std::atomic<const T*> current_{ nullptr };
+    };
+
+}
@@ -0,0 +1,162 @@
+/**
+ * @file snapshot.hpp
+ * @brief Immutable copy of a value guarded by a shared_mutex.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include <sys2/epoch.h>
+
+namespace litertp {
+
+    // Readers share one immutable copy of the value instead of copying it on each call.
+    // The copy is made on the first read after a change, writers modify the value
+    // with a write_lock which drops the current copy when it is released.
+    // The copy is published by a raw pointer and released through an epoch, a reader
+    // only pays a reference count when it keeps the copy by get.
+    template <class T>
+    class snapshot
+    {
+        struct node_t
+        {
+            std::shared_ptr<const T> value;
+        };
+
+    public:
+        class write_lock
+        {
+        public:
+            explicit write_lock(snapshot& s)
+                :lk_(s.mutex_), s_(s)
+            {
+            }
+
+            // Dropped while still locked, a reader can not publish a copy older than this change.
+            // Released after unlocking, the mutex is not held while waiting for readers.
+            ~write_lock()
+            {
+                const node_t* old = s_.current_.exchange(nullptr, std::memory_order_acq_rel);
+                s_.version_.fetch_add(1, std::memory_order_release);
+                lk_.unlock();
+                if (old)
+                {
+                    s_.epoch_.retire([old]() { delete old; });
+                }
+            }
+
+            write_lock(const write_lock&) = delete;
+            write_lock& operator=(const write_lock&) = delete;
+        private:
+            std::unique_lock<std::shared_mutex> lk_;
+            snapshot& s_;
+        };
+
+        // Reads the current copy in place, valid until the reader is destroyed.
+        class reader
+        {
+        public:
+            explicit reader(snapshot& s)
+                :s_(s)
+            {
+                for (;;)
+                {
+                    index_ = s_.epoch_.enter();
+                    node_ = s_.current_.load(std::memory_order_acquire);
+                    if (node_)
+                    {
+                        break;
+                    }
+                    s_.epoch_.leave(index_);
+                    s_.publish();
+                }
+            }
+
+            ~reader()
+            {
+                s_.epoch_.leave(index_);
+            }
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+
+            const T& operator*() const { return *node_->value; }
+            const T* operator->() const { return node_->value.get(); }
+        private:
+            snapshot& s_;
+            unsigned index_ = 0;
+            const node_t* node_ = nullptr;
+        };
+
+        snapshot(std::shared_mutex& mutex, const T& value)
+            :mutex_(mutex), value_(value)
+        {
+        }
+
+        ~snapshot()
+        {
+            delete current_.load(std::memory_order_relaxed);
+        }
+
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+
+        // Changed by each write_lock, a copy got after reading the version is not older than it.
+        uint64_t version() const
+        {
+            return version_.load(std::memory_order_acquire);
+        }
+
+        std::shared_ptr<const T> get()
+        {
+            for (;;)
+            {
+                {
+                    sys::epoch::guard g(epoch_);
+                    const node_t* node = current_.load(std::memory_order_acquire);
+                    if (node)
+                    {
+                        return node->value;
+                    }
+                }
+                publish();
+            }
+        }
+
+    private:
+        // Outside of a read section, a writer may hold the mutex while it waits for readers.
+        void publish()
+        {
+            std::shared_lock<std::shared_mutex> lk(mutex_);
+            if (current_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            node_t* node = new node_t();
+            node->value = std::make_shared<const T>(value_);
+            const node_t* expected = nullptr;
+            if (!current_.compare_exchange_strong(expected, node, std::memory_order_acq_rel))
+            {
+                // Another reader published the same copy.
+                delete node;
+            }
+        }
+
+    private:
+        std::shared_mutex& mutex_;
+        const T& value_;
+        sys::epoch epoch_;
+        std::atomic<const node_t*> current_{ nullptr };
+        std::atomic<uint64_t> version_{ 0 };
+    };
+
+}
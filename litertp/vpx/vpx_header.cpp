@@ -87,7 +87,7 @@ int vp8_header_deserialize(vp8_header* hdr, int* header_size, const uint8_t* buf
 		}
 
 		//=====
-		if (hdr->key_idx_present != 0)
+		if (hdr->tid_present != 0 || hdr->key_idx_present != 0)
 		{
 			CHECK_SIZE(size, pos + 1);
 			v = buffer[pos++];
@@ -96,6 +96,8 @@ int vp8_header_deserialize(vp8_header* hdr, int* header_size, const uint8_t* buf
 			hdr->key_idx = (v & 0x1F);
 		}
 
+		*header_size = pos;
+
 		if (hdr->startof_vp8_partition == 1 && hdr->part_index == 0)
 		{
 			CHECK_SIZE(size, pos + 3);
@@ -116,47 +118,26 @@ int vp8_header_deserialize(vp8_header* hdr, int* header_size, const uint8_t* buf
 int vp8_header_serialize(const vp8_header* hdr, int* header_size, uint8_t* buffer, int size)
 {
 	int pos = 0;
-	*header_size = 1;
+	*header_size = 0;
 	//======================
 	uint8_t v = 0;
-	v |= hdr->extended_present << 7;
-	//v |= (hdr->reserved&0x01) << 6;
+	v |= (hdr->extended_present & 0x01) << 7;
 	v |= (hdr->non_reference & 0x01) << 5;
 	v |= (hdr->startof_vp8_partition & 0x01) << 4;
-	v |= (hdr->startof_vp8_partition & 0x0F);
+	v |= (hdr->part_index & 0x0F);
 
 	CHECK_SIZE(size, pos + 1);
 	buffer[pos++] = v;
 
-	if (hdr->extended_present == 0)
+	if (hdr->extended_present != 0)
 	{
-		if (hdr->startof_vp8_partition == 1)
-		{
-			CHECK_SIZE(size, pos + 3);
-			uint8_t v0 = 0, v1 = 0, v2 = 0;
-			v0 |= hdr->h << 4;
-			v0 |= hdr->version << 1;
-			v0 |= hdr->p;
-			v0 |= (uint8_t)((hdr->first_partition_size & 0x00070000) >> 11);
-			buffer[pos++] = v0;
-
-			v1 = (uint8_t)((hdr->first_partition_size & 0x0000FF00) >> 8);
-			v2 = (uint8_t)(hdr->first_partition_size & 0x000000FF);
-			buffer[pos++] = v1;
-			buffer[pos++] = v2;
-		}
-		return pos;
-	}
-	else
-	{
-		*header_size = 2;
 		//======================
 		v = 0;
-		v |= hdr->pic_idx_present << 7;
+		v |= (hdr->pic_idx_present & 0x01) << 7;
 		v |= (hdr->tl0_pic_idx_present & 0x01) << 6;
 		v |= (hdr->tid_present & 0x01) << 5;
 		v |= (hdr->key_idx_present & 0x01) << 4;
-		//v |= (hdr->reserved2 & 0x0F);
+		CHECK_SIZE(size, pos + 1);
 		buffer[pos++] = v;
 
 		//======================
@@ -164,60 +145,370 @@ int vp8_header_serialize(const vp8_header* hdr, int* header_size, uint8_t* buffe
 		{
 			if (hdr->pic_idx_len == 0)
 			{
-				*header_size = 3;
 				CHECK_SIZE(size, pos + 1);
-
-				buffer[pos] |= hdr->pic_idx_len << 7;
-				buffer[pos] |= ((uint8_t)hdr->pic_idx) & 0x7F;
-				pos++;
+				buffer[pos++] = (uint8_t)(hdr->pic_idx & 0x7F);
 			}
 			else
 			{
-				*header_size = 4;
 				CHECK_SIZE(size, pos + 2);
-
-				buffer[pos] |= hdr->pic_idx_len << 7;
-				buffer[pos] |= (hdr->pic_idx & 0x7FFF) >> 8;
-				pos++;
-				buffer[pos++] = (hdr->pic_idx & 0x00FF);
+				buffer[pos++] = 0x80 | (uint8_t)((hdr->pic_idx & 0x7FFF) >> 8);
+				buffer[pos++] = (uint8_t)(hdr->pic_idx & 0x00FF);
 			}
 		}
 
 		//======================
-		if (hdr->tl0_pic_idx_present != 0) 
+		if (hdr->tl0_pic_idx_present != 0)
 		{
 			CHECK_SIZE(size, pos + 1);
 			buffer[pos++] = hdr->tl0_pic_idx;
 		}
+
 		//======================
-		if (hdr->key_idx_present != 0)
+		if (hdr->tid_present != 0 || hdr->key_idx_present != 0)
 		{
+			CHECK_SIZE(size, pos + 1);
 			v = 0;
-			v |= hdr->tid << 6;
+			v |= (hdr->tid & 0x03) << 6;
 			v |= (hdr->layer & 0x01) << 5;
-			v |= (hdr->key_idx & 0x0F);
+			v |= (hdr->key_idx & 0x1F);
 			buffer[pos++] = v;
 		}
-		//======================
+	}
 
-		if (hdr->startof_vp8_partition == 1)
+	// The vp8 payload header is the start of frame data, it is not written here.
+	*header_size = pos;
+	return pos;
+}
+
+int vp9_header_deserialize(vp9_header* hdr, int* header_size, const uint8_t* buffer, int size)
+{
+	memset((void*)hdr, 0, sizeof(vp9_header));
+	CHECK_SIZE(size, 1);
+
+	int pos = 0;
+	uint8_t v = buffer[pos++];
+	hdr->pic_idx_present = (v & 0x80) >> 7;
+	hdr->inter_picture = (v & 0x40) >> 6;
+	hdr->layer_idx_present = (v & 0x20) >> 5;
+	hdr->flexible_mode = (v & 0x10) >> 4;
+	hdr->start_of_frame = (v & 0x08) >> 3;
+	hdr->end_of_frame = (v & 0x04) >> 2;
+	hdr->ss_present = (v & 0x02) >> 1;
+	hdr->not_reference = (v & 0x01);
+
+	if (hdr->pic_idx_present)
+	{
+		CHECK_SIZE(size, pos + 1);
+		uint8_t v0 = buffer[pos++];
+		hdr->pic_idx_len = (v0 & 0x80) >> 7;
+		if (hdr->pic_idx_len == 0)
 		{
-			CHECK_SIZE(size, pos + 3);
-			uint8_t v0 = 0, v1 = 0, v2 = 0;
-			v0 |= hdr->h << 4;
-			v0 |= hdr->version << 1;
-			v0 |= hdr->p;
-			v0 |= (uint8_t)((hdr->first_partition_size & 0x00070000) >> 11);
+			hdr->pic_idx = (v0 & 0x7F);
+		}
+		else
+		{
+			CHECK_SIZE(size, pos + 1);
+			uint8_t v1 = buffer[pos++];
+			hdr->pic_idx = (((uint16_t)(v0 & 0x7F)) << 8) | v1;
+		}
+	}
+
+	if (hdr->layer_idx_present)
+	{
+		CHECK_SIZE(size, pos + 1);
+		v = buffer[pos++];
+		hdr->tid = (v & 0xE0) >> 5;
+		hdr->switching_up = (v & 0x10) >> 4;
+		hdr->sid = (v & 0x0E) >> 1;
+		hdr->inter_layer = (v & 0x01);
+
+		if (!hdr->flexible_mode)
+		{
+			CHECK_SIZE(size, pos + 1);
+			hdr->tl0_pic_idx = buffer[pos++];
+		}
+	}
 
-			v1 = (uint8_t)((hdr->first_partition_size & 0x0000FF00) >> 8);
-			v2 = (uint8_t)(hdr->first_partition_size & 0x000000FF);
-			buffer[pos++] = v1;
-			buffer[pos++] = v2;
+	if (hdr->flexible_mode && hdr->inter_picture)
+	{
+		bool more = true;
+		while (more)
+		{
+			if (hdr->num_ref_pics >= 3)
+			{
+				return -1;
+			}
+			CHECK_SIZE(size, pos + 1);
+			v = buffer[pos++];
+			hdr->p_diff[hdr->num_ref_pics++] = (v & 0xFE) >> 1;
+			more = (v & 0x01) != 0;
 		}
-		return pos;
 	}
-	
 
+	if (hdr->ss_present)
+	{
+		CHECK_SIZE(size, pos + 1);
+		v = buffer[pos++];
+		hdr->num_spatial_layers = ((v & 0xE0) >> 5) + 1;
+		hdr->resolution_present = (v & 0x10) >> 4;
+		hdr->gof_present = (v & 0x08) >> 3;
+
+		if (hdr->resolution_present)
+		{
+			CHECK_SIZE(size, pos + 4 * hdr->num_spatial_layers);
+			for (int i = 0; i < hdr->num_spatial_layers; i++)
+			{
+				hdr->width[i] = (buffer[pos] << 8) | buffer[pos + 1];
+				hdr->height[i] = (buffer[pos + 2] << 8) | buffer[pos + 3];
+				pos += 4;
+			}
+		}
 
+		if (hdr->gof_present)
+		{
+			CHECK_SIZE(size, pos + 1);
+			hdr->gof_size = buffer[pos++];
+			if (hdr->gof_size > VP9_MAX_GOF_SIZE)
+			{
+				return -1;
+			}
+			for (int i = 0; i < hdr->gof_size; i++)
+			{
+				CHECK_SIZE(size, pos + 1);
+				v = buffer[pos++];
+				hdr->gof_tid[i] = (v & 0xE0) >> 5;
+				hdr->gof_switching_up[i] = (v & 0x10) >> 4;
+				hdr->gof_num_ref_pics[i] = (v & 0x0C) >> 2;
+				CHECK_SIZE(size, pos + hdr->gof_num_ref_pics[i]);
+				for (int j = 0; j < hdr->gof_num_ref_pics[i]; j++)
+				{
+					hdr->gof_p_diff[i][j] = buffer[pos++];
+				}
+			}
+		}
+	}
+
+	*header_size = pos;
+	return pos;
 }
 
+int vp9_header_serialize(const vp9_header* hdr, int* header_size, uint8_t* buffer, int size)
+{
+	int pos = 0;
+	CHECK_SIZE(size, pos + 1);
+	uint8_t v = 0;
+	v |= hdr->pic_idx_present << 7;
+	v |= hdr->inter_picture << 6;
+	v |= hdr->layer_idx_present << 5;
+	v |= hdr->flexible_mode << 4;
+	v |= hdr->start_of_frame << 3;
+	v |= hdr->end_of_frame << 2;
+	v |= hdr->ss_present << 1;
+	v |= hdr->not_reference;
+	buffer[pos++] = v;
+
+	if (hdr->pic_idx_present)
+	{
+		if (hdr->pic_idx_len == 0)
+		{
+			CHECK_SIZE(size, pos + 1);
+			buffer[pos++] = hdr->pic_idx & 0x7F;
+		}
+		else
+		{
+			CHECK_SIZE(size, pos + 2);
+			buffer[pos++] = 0x80 | ((hdr->pic_idx & 0x7FFF) >> 8);
+			buffer[pos++] = hdr->pic_idx & 0xFF;
+		}
+	}
+
+	if (hdr->layer_idx_present)
+	{
+		CHECK_SIZE(size, pos + 1);
+		v = 0;
+		v |= (hdr->tid & 0x07) << 5;
+		v |= hdr->switching_up << 4;
+		v |= (hdr->sid & 0x07) << 1;
+		v |= hdr->inter_layer;
+		buffer[pos++] = v;
+
+		if (!hdr->flexible_mode)
+		{
+			CHECK_SIZE(size, pos + 1);
+			buffer[pos++] = hdr->tl0_pic_idx;
+		}
+	}
+
+	if (hdr->flexible_mode && hdr->inter_picture)
+	{
+		CHECK_SIZE(size, pos + hdr->num_ref_pics);
+		for (int i = 0; i < hdr->num_ref_pics && i < 3; i++)
+		{
+			bool more = i + 1 < hdr->num_ref_pics;
+			buffer[pos++] = (hdr->p_diff[i] << 1) | (more ? 1 : 0);
+		}
+	}
+
+	if (hdr->ss_present)
+	{
+		int layers = hdr->num_spatial_layers > 0 ? hdr->num_spatial_layers : 1;
+		CHECK_SIZE(size, pos + 1);
+		v = 0;
+		v |= ((layers - 1) & 0x07) << 5;
+		v |= hdr->resolution_present << 4;
+		v |= hdr->gof_present << 3;
+		buffer[pos++] = v;
+
+		if (hdr->resolution_present)
+		{
+			CHECK_SIZE(size, pos + 4 * layers);
+			for (int i = 0; i < layers; i++)
+			{
+				buffer[pos++] = hdr->width[i] >> 8;
+				buffer[pos++] = hdr->width[i] & 0xFF;
+				buffer[pos++] = hdr->height[i] >> 8;
+				buffer[pos++] = hdr->height[i] & 0xFF;
+			}
+		}
+
+		if (hdr->gof_present)
+		{
+			CHECK_SIZE(size, pos + 1);
+			buffer[pos++] = hdr->gof_size;
+			for (int i = 0; i < hdr->gof_size && i < VP9_MAX_GOF_SIZE; i++)
+			{
+				CHECK_SIZE(size, pos + 1 + hdr->gof_num_ref_pics[i]);
+				v = 0;
+				v |= (hdr->gof_tid[i] & 0x07) << 5;
+				v |= (hdr->gof_switching_up[i] & 0x01) << 4;
+				v |= (hdr->gof_num_ref_pics[i] & 0x03) << 2;
+				buffer[pos++] = v;
+				for (int j = 0; j < hdr->gof_num_ref_pics[i]; j++)
+				{
+					buffer[pos++] = hdr->gof_p_diff[i][j];
+				}
+			}
+		}
+	}
+
+	*header_size = pos;
+	return pos;
+}
+
+typedef struct _vp9_bit_reader
+{
+	const uint8_t* buf;
+	int size;
+	int bit;
+}vp9_bit_reader;
+
+static int vp9_read_bits(vp9_bit_reader* r, int n)
+{
+	int v = 0;
+	for (int i = 0; i < n; i++)
+	{
+		int byte = r->bit >> 3;
+		if (byte >= r->size)
+		{
+			return -1;
+		}
+		v = (v << 1) | ((r->buf[byte] >> (7 - (r->bit & 7))) & 0x01);
+		r->bit++;
+	}
+	return v;
+}
+
+int vp9_frame_info(const uint8_t* frame, int size, int* keyframe, int* width, int* height)
+{
+	*keyframe = 0;
+	*width = 0;
+	*height = 0;
+
+	vp9_bit_reader r = { frame,size,0 };
+	if (vp9_read_bits(&r, 2) != 2) //frame_marker
+	{
+		return 0;
+	}
+	int profile = vp9_read_bits(&r, 1);
+	profile |= vp9_read_bits(&r, 1) << 1;
+	if (profile == 3)
+	{
+		vp9_read_bits(&r, 1); //reserved_zero
+	}
+	if (vp9_read_bits(&r, 1) == 1) //show_existing_frame
+	{
+		return 1;
+	}
+	int frame_type = vp9_read_bits(&r, 1);
+	if (frame_type != 0)
+	{
+		return frame_type < 0 ? 0 : 1;
+	}
+
+	*keyframe = 1;
+	vp9_read_bits(&r, 2); //show_frame, error_resilient_mode
+	if (vp9_read_bits(&r, 24) != 0x498342) //frame_sync_code
+	{
+		return 1;
+	}
+
+	//color_config
+	if (profile >= 2)
+	{
+		vp9_read_bits(&r, 1); //ten_or_twelve_bit
+	}
+	int color_space = vp9_read_bits(&r, 3);
+	if (color_space != 7) //CS_RGB
+	{
+		vp9_read_bits(&r, 1); //color_range
+		if (profile == 1 || profile == 3)
+		{
+			vp9_read_bits(&r, 3); //subsampling_x, subsampling_y, reserved_zero
+		}
+	}
+	else if (profile == 1 || profile == 3)
+	{
+		vp9_read_bits(&r, 1); //reserved_zero
+	}
+
+	int w = vp9_read_bits(&r, 16);
+	int h = vp9_read_bits(&r, 16);
+	if (w >= 0 && h >= 0)
+	{
+		*width = w + 1;
+		*height = h + 1;
+	}
+	return 1;
+}
+
+int vp9_superframe_index(const int* sizes, int count, uint8_t* index)
+{
+	if (count <= 1 || count > 8)
+	{
+		return 0;
+	}
+
+	// superframe_index: marker, frame sizes, marker. marker is 0b110mmmff.
+	int max_size = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (sizes[i] > max_size)
+		{
+			max_size = sizes[i];
+		}
+	}
+	int mag = max_size < (1 << 8) ? 1 : max_size < (1 << 16) ? 2 : max_size < (1 << 24) ? 3 : 4;
+	uint8_t marker = 0xC0 | ((mag - 1) << 3) | (count - 1);
+
+	int pos = 0;
+	index[pos++] = marker;
+	for (int i = 0; i < count; i++)
+	{
+		for (int j = 0; j < mag; j++)
+		{
+			index[pos++] = (sizes[i] >> (j * 8)) & 0xFF;
+		}
+	}
+	index[pos++] = marker;
+	return pos;
+}
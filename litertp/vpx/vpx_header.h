@@ -81,4 +81,96 @@ typedef struct _vp8_header
 
 
 int vp8_header_deserialize(vp8_header* hdr,int* header_size, const uint8_t* buffer,int size);
+/// <summary>
+/// Write the payload descriptor only, the payload header is a part of frame data.
+/// </summary>
 int vp8_header_serialize(const vp8_header* hdr, int* header_size, uint8_t* buffer, int size);
+
+
+#define VP9_MAX_SPATIAL_LAYERS 8
+#define VP9_MAX_GOF_SIZE 64
+
+/// <summary>
+/// 
+///      0 1 2 3 4 5 6 7
+///     +-+-+-+-+-+-+-+-+
+///     |I|P|L|F|B|E|V|Z| (REQUIRED)
+///     +-+-+-+-+-+-+-+-+
+/// I:  |M| PICTURE ID  | (RECOMMENDED)
+///     +-+-+-+-+-+-+-+-+
+/// M:  | EXTENDED PID  | (RECOMMENDED)
+///     +-+-+-+-+-+-+-+-+
+/// L:  | TID |U| SID |D| (Conditionally RECOMMENDED)
+///     +-+-+-+-+-+-+-+-+
+///     |   TL0PICIDX   | (Conditionally REQUIRED, non-flexible mode)
+///     +-+-+-+-+-+-+-+-+
+/// P,F:| P_DIFF      |N| (Conditionally REQUIRED, flexible mode, up to 3 times)
+///     +-+-+-+-+-+-+-+-+
+/// V:  | SS            |
+///     | ..            |
+///     +-+-+-+-+-+-+-+-+
+/// 
+/// SS:
+///     +-+-+-+-+-+-+-+-+
+///     | N_S |Y|G|-|-|-|
+///     +-+-+-+-+-+-+-+-+
+/// Y:  |     WIDTH     | (OPTIONAL, 16 bits, N_S+1 times)
+///     |     HEIGHT    | (OPTIONAL, 16 bits)
+///     +-+-+-+-+-+-+-+-+
+/// G:  |      N_G      | (OPTIONAL)
+///     +-+-+-+-+-+-+-+-+
+/// N_G:| TID |U| R |-|-| (OPTIONAL, N_G times)
+///     |    P_DIFF     | (OPTIONAL, R times)
+///     +-+-+-+-+-+-+-+-+
+/// </summary>
+typedef struct _vp9_header
+{
+	uint8_t pic_idx_present : 1;		//I
+	uint8_t inter_picture : 1;			//P, 0 for key frame of the layer
+	uint8_t layer_idx_present : 1;		//L
+	uint8_t flexible_mode : 1;			//F
+	uint8_t start_of_frame : 1;			//B
+	uint8_t end_of_frame : 1;			//E
+	uint8_t ss_present : 1;				//V
+	uint8_t not_reference : 1;			//Z
+
+	uint8_t pic_idx_len : 1;			//0-7b; 1-15b;
+	uint16_t pic_idx : 15;
+
+	uint8_t tid : 3;
+	uint8_t switching_up : 1;			//U
+	uint8_t sid : 3;
+	uint8_t inter_layer : 1;			//D
+	uint8_t tl0_pic_idx;
+
+	uint8_t num_ref_pics;
+	uint8_t p_diff[3];
+
+	//scalability structure
+	uint8_t num_spatial_layers;			//N_S + 1
+	uint8_t resolution_present : 1;		//Y
+	uint8_t gof_present : 1;			//G
+	uint16_t width[VP9_MAX_SPATIAL_LAYERS];
+	uint16_t height[VP9_MAX_SPATIAL_LAYERS];
+	uint8_t gof_size;					//N_G
+	uint8_t gof_tid[VP9_MAX_GOF_SIZE];
+	uint8_t gof_switching_up[VP9_MAX_GOF_SIZE];
+	uint8_t gof_num_ref_pics[VP9_MAX_GOF_SIZE];
+	uint8_t gof_p_diff[VP9_MAX_GOF_SIZE][3];
+}vp9_header;
+
+
+int vp9_header_deserialize(vp9_header* hdr, int* header_size, const uint8_t* buffer, int size);
+int vp9_header_serialize(const vp9_header* hdr, int* header_size, uint8_t* buffer, int size);
+
+/// <summary>
+/// Read the uncompressed header of a vp9 frame.
+/// Returns 0 if it is not a vp9 frame, width and height are 0 if it is not a key frame.
+/// </summary>
+int vp9_frame_info(const uint8_t* frame, int size, int* keyframe, int* width, int* height);
+
+/// <summary>
+/// Build the superframe index for count frames, index needs 34 bytes at most.
+/// Returns the size of index, 0 if count is less than 2.
+/// </summary>
+int vp9_superframe_index(const int* sizes, int count, uint8_t* index);
@@ -0,0 +1,150 @@
+/**
+ * @file epoch.cpp
+ * @brief Epoch based reclamation for read mostly data.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "epoch.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sys {
+
+namespace {
+
+const unsigned k_stripes = 8;
+
+// One cache line per stripe, threads on different stripes do not share a write.
+struct alignas(64) reader_stripe
+{
+	std::atomic<int64_t> readers[2];
+};
+
+std::atomic<unsigned> g_next_stripe{ 0 };
+
+struct local_state
+{
+	unsigned stripe = g_next_stripe.fetch_add(1, std::memory_order_relaxed) % k_stripes;
+	// Read sections of all domains, retirements wait for the outermost one.
+	int depth = 0;
+	std::vector<std::function<void()>> retired;
+};
+
+thread_local local_state t_local;
+
+}
+
+struct epoch::state
+{
+	std::atomic<unsigned> index{ 0 };
+	reader_stripe stripes[k_stripes];
+	std::mutex sync_mutex;
+
+	state()
+	{
+		for (auto& stripe : stripes)
+		{
+			stripe.readers[0] = 0;
+			stripe.readers[1] = 0;
+		}
+	}
+
+	bool drained(unsigned index)
+	{
+		for (auto& stripe : stripes)
+		{
+			if (stripe.readers[index].load(std::memory_order_acquire) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+epoch::epoch()
+	: state_(std::make_shared<state>())
+{
+}
+
+epoch::~epoch()
+{
+}
+
+unsigned epoch::enter()
+{
+	local_state& local = t_local;
+	local.depth++;
+	unsigned index = state_->index.load(std::memory_order_relaxed) & 1;
+	// seq_cst, the count must be visible before the protected pointer is read.
+	state_->stripes[local.stripe].readers[index].fetch_add(1, std::memory_order_seq_cst);
+	return index;
+}
+
+void epoch::leave(unsigned index)
+{
+	local_state& local = t_local;
+	state_->stripes[local.stripe].readers[index].fetch_sub(1, std::memory_order_release);
+	if (--local.depth > 0 || local.retired.empty())
+	{
+		return;
+	}
+
+	std::vector<std::function<void()>> retired;
+	retired.swap(local.retired);
+	for (auto& fn : retired)
+	{
+		fn();
+	}
+}
+
+void epoch::synchronize()
+{
+	synchronize(*state_);
+}
+
+void epoch::synchronize(state& s)
+{
+	std::lock_guard<std::mutex> lk(s.sync_mutex);
+	// The new pointer must be visible before counters are read.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// Readers which loaded the index before the last flip may still count on the other side.
+	unsigned current = s.index.load(std::memory_order_relaxed) & 1;
+	while (!s.drained(current ^ 1))
+	{
+		std::this_thread::yield();
+	}
+
+	s.index.store(current ^ 1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while (!s.drained(current))
+	{
+		std::this_thread::yield();
+	}
+}
+
+void epoch::retire(std::function<void()> fn)
+{
+	local_state& local = t_local;
+	if (local.depth > 0)
+	{
+		// Waiting here could wait for a reader which is itself waiting to retire.
+		std::shared_ptr<state> s = state_;
+		local.retired.push_back([s, fn]() {
+			synchronize(*s);
+			fn();
+			});
+		return;
+	}
+
+	synchronize();
+	fn();
+}
+
+}
@@ -0,0 +1,70 @@
+/**
+ * @file epoch.h
+ * @brief Epoch based reclamation for read mostly data.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+
+#pragma once
+#include <functional>
+#include <memory>
+
+namespace sys {
+
+/// <summary>
+/// A reclamation domain, readers of one domain never hold back writers of another.
+/// Readers enter a read section and only count themselves in a striped counter of the
+/// current epoch. Writers publish new data, then retire the old one, it is released after
+/// all readers that may still see it have left.
+/// Read sections can be nested.
+/// </summary>
+class epoch
+{
+public:
+	epoch();
+	~epoch();
+	epoch(const epoch&) = delete;
+	epoch& operator=(const epoch&) = delete;
+
+	/// <summary>
+	/// Returns the epoch index, which must be given to leave.
+	/// </summary>
+	unsigned enter();
+	void leave(unsigned index);
+
+	/// <summary>
+	/// Wait until readers which entered before have left.
+	/// Must not be called inside a read section of any domain.
+	/// </summary>
+	void synchronize();
+
+	/// <summary>
+	/// Synchronize and call fn. Inside a read section of any domain, both are deferred until
+	/// the outermost section of the thread is left, so writers called from readers never wait
+	/// on each other.
+	/// </summary>
+	void retire(std::function<void()> fn);
+
+	class guard
+	{
+	public:
+		explicit guard(epoch& e) : epoch_(e), index_(e.enter()) {}
+		~guard() { epoch_.leave(index_); }
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+	private:
+		epoch& epoch_;
+		unsigned index_;
+	};
+
+private:
+	struct state;
+	static void synchronize(state& s);
+
+	// Shared with retirements deferred on other threads, which may outlive the domain.
+	std::shared_ptr<state> state_;
+};
+
+}
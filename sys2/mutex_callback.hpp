@@ -1,4 +1,3 @@
-
 /**
  * @file mutex_callback.hpp
  * @brief
@@ -9,12 +8,21 @@
 
 #pragma once
 #include <mutex>
-#include <shared_mutex>
+#include <atomic>
 #include <vector>
 #include <algorithm>
 
+#include "epoch.h"
+
 namespace sys {
 
+/// <summary>
+/// Callbacks invoked on hot paths and modified rarely.
+/// invoke reads the current list in a read section of the instance's own epoch without locking,
+/// add, remove and clear publish a new list and release the old one when no reader uses it.
+/// After remove returned, the removed callback is not running on other threads, unless remove
+/// was called from a callback, then the old list is released once that callback returns.
+/// </summary>
 template <class TFun>
 class mutex_callback
 {
@@ -25,17 +33,28 @@ public:
 		void* ctx;
 	};
 private:
-	std::shared_mutex mutex_;
-	std::vector<callback_item_st> items_;
+	typedef std::vector<callback_item_st> items_t;
+
+	std::mutex mutex_;
+	epoch epoch_;
+	std::atomic<const items_t*> items_{ new items_t() };
 public:
+	mutex_callback() = default;
+	mutex_callback(const mutex_callback&) = delete;
+	mutex_callback& operator=(const mutex_callback&) = delete;
+
+	~mutex_callback() {
+		delete items_.load(std::memory_order_relaxed);
+	}
 
 	bool add(TFun fun, void* ctx) {
-		std::unique_lock<std::shared_mutex> g(mutex_);
-		auto iter = std::find_if(items_.begin(), items_.end(), [fun, ctx](const callback_item_st& it) {
+		std::unique_lock<std::mutex> g(mutex_);
+		const items_t* old = items_.load(std::memory_order_relaxed);
+		auto iter = std::find_if(old->begin(), old->end(), [fun, ctx](const callback_item_st& it) {
 			return it.fun == fun && it.ctx == ctx;
 			});
 
-		if (iter != items_.end()) {
+		if (iter != old->end()) {
 			return false;
 		}
 
@@ -43,40 +62,54 @@ public:
 		it.fun = fun;
 		it.ctx = ctx;
 
-
-		items_.push_back(it);
+		items_t* items = new items_t(*old);
+		items->push_back(it);
+		publish(items, g);
 		return true;
 	}
 
 	void remove(TFun fun, void* ctx) {
-		std::unique_lock<std::shared_mutex> g(mutex_);
-		auto iter = std::find_if(items_.begin(), items_.end(), [fun, ctx](const callback_item_st& it) {
+		std::unique_lock<std::mutex> g(mutex_);
+		const items_t* old = items_.load(std::memory_order_relaxed);
+		auto iter = std::find_if(old->begin(), old->end(), [fun, ctx](const callback_item_st& it) {
 			return it.fun == fun && it.ctx == ctx;
 			});
 
-		if (iter != items_.end()) {
-			items_.erase(iter);
+		if (iter == old->end()) {
+			return;
 		}
+
+		items_t* items = new items_t(*old);
+		items->erase(items->begin() + (iter - old->begin()));
+		publish(items, g);
 	}
 
 	void clear() {
-		std::unique_lock<std::shared_mutex> g(mutex_);
-		items_.clear();
+		std::unique_lock<std::mutex> g(mutex_);
+		publish(new items_t(), g);
 	}
 
 	void clone(std::vector<callback_item_st>& items) {
-		std::shared_lock<std::shared_mutex> g(mutex_);
-		items = items_;
+		epoch::guard g(epoch_);
+		items = *items_.load(std::memory_order_acquire);
 	}
 
 	template<class ...Args>
 	void invoke(Args... args) {
-		std::shared_lock<std::shared_mutex> g(mutex_);
-		
-		for (auto itr = items_.begin(); itr != items_.end(); itr++) {
+		epoch::guard g(epoch_);
+		const items_t* items = items_.load(std::memory_order_acquire);
+
+		for (auto itr = items->begin(); itr != items->end(); itr++) {
 			itr->fun(itr->ctx, args...);
 		}
 	}
+private:
+	// Wait for readers without holding mutex_, a callback may add or remove.
+	void publish(items_t* items, std::unique_lock<std::mutex>& g) {
+		const items_t* old = items_.exchange(items, std::memory_order_acq_rel);
+		g.unlock();
+		epoch_.retire([old]() { delete old; });
+	}
 };
 
 }
@@ -77,12 +77,10 @@ static const unsigned int crc32_tab[] = { 0x00000000L, 0x77073096L, 0xee0e612cL,
  */
 unsigned int cyg_crc32_accumulate(unsigned int crc32val, const unsigned char* s,
     int len) {
-    int i;
+    if (len <= 0)
+        return crc32val;
 
-    for (i = 0; i < len; i++) {
-        crc32val = crc32_tab[(crc32val ^ s[i]) & 0xff] ^ (crc32val >> 8);
-    }
-    return crc32val;
+    return crc32_update(crc32val, s, (size_t)len);
 }
 
 /**
@@ -99,15 +97,12 @@ unsigned int cyg_crc32(const unsigned char* s, int len) {
  */
 unsigned int cyg_ether_crc32_accumulate(unsigned int crc32val, const unsigned char* s,
     int len) {
-    int i;
-
     if (s == 0)
         return 0L;
 
     crc32val = crc32val ^ 0xffffffff;
-    for (i = 0; i < len; i++) {
-        crc32val = crc32_tab[(crc32val ^ s[i]) & 0xff] ^ (crc32val >> 8);
-    }
+    if (len > 0)
+        crc32val = crc32_update(crc32val, s, (size_t)len);
     return crc32val ^ 0xffffffff;
 }
 
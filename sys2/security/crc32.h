@@ -2,12 +2,29 @@
 #define __CRC32_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+	/**
+	 * Update the reflected crc32 register with s, no inversion is done before or after.
+	 * It uses PCLMULQDQ or ARMv8 crc instructions if the cpu has them, or slicing-by-8 tables.
+	 */
+	unsigned int crc32_update(unsigned int crc32val, const unsigned char* s, size_t len);
+
+	/**
+	 * Same as crc32_update but always on slicing-by-8 tables.
+	 */
+	unsigned int crc32_update_slice8(unsigned int crc32val, const unsigned char* s, size_t len);
+
+	/**
+	 * Name of the implementation crc32_update runs on this cpu.
+	 */
+	const char* crc32_implementation(void);
+
 	/**
 	 * This is the standard Gary S. Brown's 32 bit CRC algorithm, but
 	 * accumulate the CRC into the result of a previous CRC.
@@ -32,12 +49,6 @@ extern "C"
 	 */
 	unsigned int cyg_ether_crc32(const unsigned char* s, int len);
 
-	/**
-		* cyg_crc32_in_table - src32_tab[i] = value;  return i
-		* @return: return i, or -1 for no such value in tabale
-		*/
-	static int cyg_crc32_in_table(unsigned int value);
-
 	/**
 	 * add 4 bytes num[4] to change crc32 value from crc_src to crc_dst
 	 * @return: 0 on success, -1 on error.
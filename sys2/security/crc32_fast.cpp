@@ -0,0 +1,238 @@
+/**
+ * @file crc32_fast.cpp
+ * @brief Slicing-by-8 crc32, with PCLMULQDQ or ARMv8 crc instructions when the cpu has them.
+ * @author Shijie Zhou
+ * @copyright 2024 Shijie Zhou
+ */
+
+
+#include "crc32.h"
+
+#include <array>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CRC32_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32_ARM
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+    // Reflected polynomial of the ethernet crc32
+    constexpr uint32_t CRC32_POLY = 0xEDB88320u;
+
+    typedef std::array<std::array<uint32_t, 256>, 8> slice_tables_t;
+
+    // tables[k][b] is the crc of byte b followed by k zero bytes
+    constexpr slice_tables_t make_tables()
+    {
+        slice_tables_t t{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int j = 0; j < 8; j++)
+            {
+                c = (c & 1) ? (c >> 1) ^ CRC32_POLY : c >> 1;
+            }
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            for (int k = 1; k < 8; k++)
+            {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+        return t;
+    }
+
+    constexpr slice_tables_t g_tables = make_tables();
+
+    inline uint32_t load_le32(const unsigned char* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    uint32_t update_slice8(uint32_t crc, const unsigned char* s, size_t len)
+    {
+        const auto& t = g_tables;
+        while (len >= 8)
+        {
+            uint32_t lo = load_le32(s) ^ crc;
+            uint32_t hi = load_le32(s + 4);
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+                ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+            s += 8;
+            len -= 8;
+        }
+        while (len--)
+        {
+            crc = t[0][(crc ^ *s++) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#ifdef CRC32_X86
+#if defined(__GNUC__) || defined(__clang__)
+#define CRC32_TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+#else
+#define CRC32_TARGET_CLMUL
+#endif
+
+    // Fold 64 bytes at a time with carry-less multiplies and Barrett reduce to 32 bits,
+    // constants are those of Intel's "Fast CRC Computation Using PCLMULQDQ" for the reflected polynomial.
+    // len must be at least 64 and a multiple of 16.
+    CRC32_TARGET_CLMUL uint32_t update_clmul(uint32_t crc, const unsigned char* buf, size_t len)
+    {
+        const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+        const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+        const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+        const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+        const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+        __m128i x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        __m128i x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        __m128i x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        __m128i x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+        buf += 64;
+        len -= 64;
+
+        while (len >= 64)
+        {
+            __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+            __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+            __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+            __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+            x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+            x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+            x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buf + 0x00)));
+            x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buf + 0x10)));
+            x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buf + 0x20)));
+            x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buf + 0x30)));
+            buf += 64;
+            len -= 64;
+        }
+
+        // Fold the four lanes into one
+        __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+        while (len >= 16)
+        {
+            x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)buf)), x5);
+            buf += 16;
+            len -= 16;
+        }
+
+        // 128 bits to 64 bits
+        x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, mask32);
+        x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        // Barrett reduction to 32 bits
+        x2 = _mm_and_si128(x1, mask32);
+        x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+        x2 = _mm_and_si128(x2, mask32);
+        x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+        return (uint32_t)_mm_extract_epi32(x1, 1);
+    }
+
+    bool has_clmul()
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#elif defined(_MSC_VER)
+        int info[4] = { 0 };
+        __cpuid(info, 1);
+        return (info[2] & (1 << 1)) && (info[2] & (1 << 19));
+#else
+        return false;
+#endif
+    }
+
+    const bool g_clmul = has_clmul();
+#endif
+
+#ifdef CRC32_ARM
+    uint32_t update_arm(uint32_t crc, const unsigned char* s, size_t len)
+    {
+        while (len >= 8)
+        {
+            uint64_t v;
+            memcpy(&v, s, 8);
+            crc = __crc32d(crc, v);
+            s += 8;
+            len -= 8;
+        }
+        while (len--)
+        {
+            crc = __crc32b(crc, *s++);
+        }
+        return crc;
+    }
+#endif
+}
+
+unsigned int crc32_update_slice8(unsigned int crc32val, const unsigned char* s, size_t len)
+{
+    return update_slice8(crc32val, s, len);
+}
+
+unsigned int crc32_update(unsigned int crc32val, const unsigned char* s, size_t len)
+{
+#if defined(CRC32_ARM)
+    return update_arm(crc32val, s, len);
+#else
+#if defined(CRC32_X86)
+    // Short messages stay on the tables, folding needs 64 bytes to pay off
+    if (g_clmul && len >= 64)
+    {
+        size_t chunk = len & ~(size_t)15;
+        crc32val = update_clmul(crc32val, s, chunk);
+        s += chunk;
+        len -= chunk;
+    }
+#endif
+    return update_slice8(crc32val, s, len);
+#endif
+}
+
+const char* crc32_implementation(void)
+{
+#if defined(CRC32_ARM)
+    return "armv8 crc";
+#else
+#if defined(CRC32_X86)
+    if (g_clmul)
+    {
+        return "pclmulqdq";
+    }
+#endif
+    return "slice8";
+#endif
+}
@@ -72,6 +72,62 @@ void hmac_sha1::make_bytes(const BYTE* text, int text_len, const BYTE* key, int
 
 }
 
+hmac_sha1_key::hmac_sha1_key()
+{
+    set_key(nullptr, 0);
+}
+
+hmac_sha1_key::hmac_sha1_key(const BYTE* key, int key_len)
+{
+    set_key(key, key_len);
+}
+
+void hmac_sha1_key::set_key(const BYTE* key, int key_len)
+{
+    BYTE block[hmac_sha1::SHA1_BLOCK_SIZE] = { 0 };
+    if (key_len > hmac_sha1::SHA1_BLOCK_SIZE)
+    {
+        sha1 h;
+        h.update((UINT_8*)key, key_len);
+        h.final();
+        h.get_hash(block);
+    }
+    else if (key_len > 0)
+    {
+        memcpy(block, key, key_len);
+    }
+
+    BYTE pad[hmac_sha1::SHA1_BLOCK_SIZE];
+    for (int i = 0; i < hmac_sha1::SHA1_BLOCK_SIZE; i++)
+    {
+        pad[i] = block[i] ^ 0x36;
+    }
+    m_inner.reset();
+    m_inner.update(pad, sizeof(pad));
+
+    for (int i = 0; i < hmac_sha1::SHA1_BLOCK_SIZE; i++)
+    {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    m_outer.reset();
+    m_outer.update(pad, sizeof(pad));
+}
+
+void hmac_sha1_key::make_bytes(const BYTE* text, int text_len, BYTE* digest) const
+{
+    BYTE inner_hash[hmac_sha1::SHA1_DIGEST_LENGTH];
+
+    sha1 h = m_inner;
+    h.update((UINT_8*)text, text_len);
+    h.final();
+    h.get_hash(inner_hash);
+
+    h = m_outer;
+    h.update(inner_hash, sizeof(inner_hash));
+    h.final();
+    h.get_hash(digest);
+}
+
 std::string hmac_sha1::make_string(const std::string& text, const std::string& key)
 {
     BYTE ret[20] = { 0 };
@@ -57,5 +57,24 @@ public:
     static std::string hex_string(BYTE* hex, int size);
 };
 
+/// <summary>
+/// Hmac sha1 of one key, the inner and outer hash states of the padded key are made once
+/// and copied for each message, so a message costs only the hash of its own bytes.
+/// make_bytes is const and may be called by many threads.
+/// </summary>
+class hmac_sha1_key
+{
+public:
+    hmac_sha1_key();
+    hmac_sha1_key(const BYTE* key, int key_len);
+
+    void set_key(const BYTE* key, int key_len);
+    void make_bytes(const BYTE* text, int text_len, BYTE* digest) const;
+
+private:
+    sha1 m_inner;
+    sha1 m_outer;
+};
+
 
 #endif /* __HMAC_SHA1_H__ */
\ No newline at end of file
@@ -53,6 +53,23 @@ sha1::~sha1()
     reset();
 }
 
+sha1::sha1(const sha1& other)
+{
+    m_block = (SHA1_WORKSPACE_BLOCK*)m_workspace;
+
+    *this = other;
+}
+
+sha1& sha1::operator=(const sha1& other)
+{
+    // m_block points to our own workspace, it is not copied
+    memcpy(m_state, other.m_state, sizeof(m_state));
+    memcpy(m_count, other.m_count, sizeof(m_count));
+    memcpy(m_buffer, other.m_buffer, sizeof(m_buffer));
+    memcpy(m_digest, other.m_digest, sizeof(m_digest));
+    return *this;
+}
+
 void sha1::reset()
 {
     // SHA1 initialization constants
@@ -189,10 +206,10 @@ void sha1::final()
         finalcount[i] = (UINT_8)((m_count[((i >= 4) ? 0 : 1)]
             >> ((3 - (i & 3)) * 8)) & 255); // Endian independent
 
-    update((UINT_8*)"\200", 1);
-
-    while ((m_count[0] & 504) != 448)
-        update((UINT_8*)"\0", 1);
+    // Pad to 56 bytes mod 64 in one update
+    UINT_8 padding[64] = { 0x80 };
+    UINT_32 used = (m_count[0] >> 3) & 63;
+    update(padding, used < 56 ? 56 - used : 120 - used);
 
     update(finalcount, 8); // Cause a SHA1Transform()
 
@@ -92,6 +92,10 @@ public:
     sha1();
     ~sha1();
 
+    // A copy keeps the hash state, so a common prefix is hashed only once
+    sha1(const sha1& other);
+    sha1& operator=(const sha1& other);
+
     UINT_32 m_state[5];
     UINT_32 m_count[2];
     UINT_32 __reserved1[1];
@@ -8,6 +8,7 @@
 
 #include "socket.h"
 #include <string.h>
+#include <algorithm>
 
 
 namespace sys{
@@ -273,12 +274,8 @@ bool socket::get_addresses_byhost(const char* host, std::vector<sockaddr_storage
 
 bool socket::shutdown(shutdown_how_t how)
 {
-#ifdef _WIN32
 	int r=::shutdown(socket_, (int)how);
 	return r >= 0;
-#else
-
-#endif
 }
 
 void socket::close()
@@ -366,6 +363,95 @@ int socket::recvfrom(char* buffer, int size, sockaddr* addr, socklen_t* addrSize
 	return ::recvfrom(socket_, buffer, size, 0, addr, addrSize);
 }
 
+int socket::sendto_batch(const char* const* buffers, const int* sizes, int count, const sockaddr* addr, socklen_t addr_size)
+{
+	if (count <= 0)
+	{
+		return 0;
+	}
+#if defined(__linux__)
+	const int max_batch = 64;
+	int done = 0;
+	int sent = 0;
+	while (done < count)
+	{
+		int n = std::min(count - done, max_batch);
+		mmsghdr msgs[max_batch];
+		iovec iovs[max_batch];
+		memset(msgs, 0, sizeof(mmsghdr) * n);
+		for (int i = 0; i < n; i++)
+		{
+			iovs[i].iov_base = (void*)buffers[done + i];
+			iovs[i].iov_len = sizes[done + i];
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = (void*)addr;
+			msgs[i].msg_hdr.msg_namelen = addr_size;
+		}
+		int r = ::sendmmsg(socket_, msgs, n, 0);
+		if (r <= 0)
+		{
+			// sendmmsg stops at the first datagram that fails, skip it and send the rest.
+			done++;
+			continue;
+		}
+		done += r;
+		sent += r;
+	}
+	return sent > 0 ? sent : -1;
+#else
+	int sent = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (sendto(buffers[i], sizes[i], addr, addr_size) >= 0)
+		{
+			sent++;
+		}
+	}
+	return sent > 0 ? sent : -1;
+#endif
+}
+
+int socket::recvfrom_batch(char* const* buffers, int size, int* sizes, sockaddr_storage* addrs, socklen_t* addr_sizes, int count)
+{
+	if (count <= 0)
+	{
+		return 0;
+	}
+#if defined(__linux__)
+	const int max_batch = 64;
+	int n = std::min(count, max_batch);
+	mmsghdr msgs[max_batch];
+	iovec iovs[max_batch];
+	memset(msgs, 0, sizeof(mmsghdr) * n);
+	for (int i = 0; i < n; i++)
+	{
+		iovs[i].iov_base = buffers[i];
+		iovs[i].iov_len = size;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+	}
+	int r = ::recvmmsg(socket_, msgs, n, MSG_WAITFORONE, nullptr);
+	for (int i = 0; i < r; i++)
+	{
+		sizes[i] = (int)msgs[i].msg_len;
+		addr_sizes[i] = msgs[i].msg_hdr.msg_namelen;
+	}
+	return r;
+#else
+	addr_sizes[0] = sizeof(sockaddr_storage);
+	int r = recvfrom(buffers[0], size, (sockaddr*)&addrs[0], &addr_sizes[0]);
+	if (r < 0)
+	{
+		return -1;
+	}
+	sizes[0] = r;
+	return 1;
+#endif
+}
+
 const sockaddr* socket::remote_addr()const
 {
 	return (const sockaddr*)&remote_addr_;
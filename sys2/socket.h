@@ -115,6 +115,20 @@ public:
 	int recv(char* buffer, int size);
 	int recvfrom(char* buffer, int size, sockaddr* addr, socklen_t* addrSize);
 
+	/// <summary>
+	/// Send datagrams to one address, in one call on linux.
+	/// A datagram that fails is skipped, the rest of the batch is still sent.
+	/// </summary>
+	/// <returns>Count of datagrams sent, or -1 if none is sent.</returns>
+	int sendto_batch(const char* const* buffers, const int* sizes, int count, const sockaddr* addr, socklen_t addr_size);
+
+	/// <summary>
+	/// Wait for a datagram and receive the ones already queued, up to count, in one call on linux.
+	/// All buffers have size bytes, sizes and addresses are set for each received datagram.
+	/// </summary>
+	/// <returns>Count of datagrams received, or -1 on error or timeout.</returns>
+	int recvfrom_batch(char* const* buffers, int size, int* sizes, sockaddr_storage* addrs, socklen_t* addr_sizes, int count);
+
 	const sockaddr* remote_addr()const;
 	socklen_t remote_addr_size()const;
 	void remote_addr(std::string& addr, int& port);
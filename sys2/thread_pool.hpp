@@ -26,7 +26,7 @@ namespace sys {
         std::mutex m_mutex;
     public:
         safe_queue() {}
-        safe_queue(safe_queue&& other) {}
+        safe_queue(safe_queue&&) {}
         ~safe_queue() {}
         bool empty()
         {
@@ -69,7 +69,7 @@ namespace sys {
             thread_pool* m_pool;
         public:
             thread_worker(thread_pool* pool, const int id) 
-                : m_pool(pool), m_id(id)
+                : m_id(id), m_pool(pool)
             {
             }
 
@@ -81,7 +81,7 @@ namespace sys {
                 {
                     {
                         std::unique_lock<std::mutex> lock(m_pool->m_conditional_mutex);
-                        if (m_pool->m_queue.empty())
+                        if (m_pool->m_queue.empty() && !m_pool->m_shutdown)
                         {
                             m_pool->m_conditional_lock.wait(lock);
                         }
@@ -100,7 +100,7 @@ namespace sys {
 
     public:
         thread_pool(const int n_threads = 4)
-            : m_threads(std::vector<std::thread>(n_threads)), m_shutdown(false)
+            : m_shutdown(false), m_threads(std::vector<std::thread>(n_threads))
         {
         }
         thread_pool(const thread_pool&) = delete;
@@ -110,23 +110,33 @@ namespace sys {
         // Inits thread pool
         void init()
         {
-            for (int i = 0; i < m_threads.size(); ++i)
+            for (size_t i = 0; i < m_threads.size(); ++i)
             {
-                m_threads.at(i) = std::thread(thread_worker(this, i));
+                m_threads.at(i) = std::thread(thread_worker(this, (int)i));
             }
         }
         // Waits until threads finish their current task and shutdowns the pool
+        // Tasks still queued run on the calling thread, a submitter may wait for them.
         void shutdown()
         {
-            m_shutdown = true;
+            {
+                std::unique_lock<std::mutex> lock(m_conditional_mutex);
+                m_shutdown = true;
+            }
             m_conditional_lock.notify_all();
-            for (int i = 0; i < m_threads.size(); ++i)
+            for (size_t i = 0; i < m_threads.size(); ++i)
             {
                 if (m_threads.at(i).joinable())
                 {
                     m_threads.at(i).join();
                 }
             }
+
+            std::function<void()> func;
+            while (m_queue.dequeue(func))
+            {
+                func();
+            }
         }
 
         // Submit a function to be executed asynchronously by the pool
@@ -142,8 +152,18 @@ namespace sys {
             {
                 (*task_ptr)();
             };
-            m_queue.enqueue(warpper_func);
-            m_conditional_lock.notify_one();
+            {
+                // Queued under the lock of the workers, or a worker about to wait misses the notify.
+                std::unique_lock<std::mutex> lock(m_conditional_mutex);
+                if (!m_shutdown)
+                {
+                    m_queue.enqueue(warpper_func);
+                    m_conditional_lock.notify_one();
+                    return task_ptr->get_future();
+                }
+            }
+            // No worker is left to take it.
+            warpper_func();
             return task_ptr->get_future();
         }
     };